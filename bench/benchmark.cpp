@@ -0,0 +1,947 @@
+#include "vulkanSetup.hpp"
+#include "frameAllocator.hpp"
+#include "shaderInterface.hpp"
+#include "queueTimeline.hpp"
+#include "deviceHandle.hpp"
+#include "commandEncoder.hpp"
+#include "memoryHeap.hpp"
+#include "hazardTracker.hpp"
+#include "meshLoader.hpp"
+#include "meshPacker.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef EMBED_SHADERS
+#include <embeddedShaders.hpp> //generated at build time from src/shaders
+#endif
+
+//times every startup stage of main() and renders parameterized draw loads, the result is printed as JSON
+//usage: MetalOverVulkanBench [--runs N] [--frames N] [--draws 1,100] [--vertices 3,300] [--frames-in-flight 1,2]
+//                            [--submit-threads 1,2,4] [--submits N] [--encoder-draws 100,1000] [--hazard-resources N]
+//                            [--mesh-rings N] [--windowed] [--out file.json]
+//runs headless by default (GLFW null platform) so it works on lavapipe without a display
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedUs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+static double median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+//frame allocator regions, scenarios with more frames in flight are clamped
+constexpr uint32_t maxBenchFramesInFlight = 4;
+
+//everything main() creates before its render loop
+struct BenchContext
+{
+    VkInstance instance = VK_NULL_HANDLE;
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    QueueFamily queueFamily;
+    VkDevice device = VK_NULL_HANDLE;
+    std::unique_ptr<QueuePool> queuePool;
+    QueuePool::Queue* graphicsQueue = nullptr;
+    QueuePool::Queue* presentQueue = nullptr;
+    SwapChainProfile profile{};
+    VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+    std::vector<VkImage> images;
+    std::vector<VkImageView> views;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    std::vector<VkFramebuffer> framebuffers;
+    std::unique_ptr<FrameAllocator> frameData;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+};
+
+//stages in the order main() runs them
+enum Stage
+{
+    StageInstance,
+    StageSurface,
+    StagePickDevice,
+    StageDevice,
+    StageSwapchain,
+    StageShaders,
+    StagePipeline,
+    StageCount
+};
+
+static const char* stageNames[StageCount] = { "instance", "surface", "pickPhysicalDevice", "device", "swapchain", "createShader", "pipeline" };
+
+static void createShaders(VkDevice device, VkShaderModule& vertex, VkShaderModule& fragment)
+{
+#ifdef EMBED_SHADERS
+    for (auto [module, name] : { std::pair{&vertex, "shader.vert"}, std::pair{&fragment, "shader.frag"} })
+    {
+        const EmbeddedShader* embedded = findEmbeddedShader(name);
+        if (embedded == nullptr)
+            exitWithError((std::string("shader not embedded: ") + name).c_str());
+        *module = createShader(device, embedded->code, embedded->size, name);
+    }
+#else
+    std::string path = SPIRV_FOLDER_LOCATION;
+    vertex = createShader(device, path + "/vert.spv");
+    fragment = createShader(device, path + "/frag.spv");
+#endif
+}
+
+static BenchContext startUp(GLFWwindow* window, const QueueConfig& queueConfig, double (&stageUs)[StageCount])
+{
+    BenchContext ctx;
+
+    auto start = Clock::now();
+    ctx.instance = createInstance(false); //validation would dominate every other stage
+    stageUs[StageInstance] = elapsedUs(start);
+
+    start = Clock::now();
+    if (glfwCreateWindowSurface(ctx.instance, window, nullptr, &ctx.surface) != VK_SUCCESS)
+        exitWithError("Error in creating surface");
+    stageUs[StageSurface] = elapsedUs(start);
+
+    start = Clock::now();
+    ctx.physicalDevice = pickPhysicalDevice(ctx.instance, ctx.surface);
+    if (ctx.physicalDevice == VK_NULL_HANDLE)
+        exitWithError("No suitable GPU device found");
+    ctx.queueFamily = getQueueFamily(ctx.physicalDevice, ctx.surface);
+    if (ctx.queueFamily.graphics < 0 || ctx.queueFamily.presentation < 0)
+        exitWithError("no graphics or presentation queue family");
+    stageUs[StagePickDevice] = elapsedUs(start);
+
+    start = Clock::now();
+    const QueuePlan queuePlan = planQueues(ctx.physicalDevice, ctx.queueFamily, queueConfig);
+    ctx.device = createLogicalDevice(ctx.physicalDevice, queuePlan);
+    ctx.queuePool = std::make_unique<QueuePool>(ctx.device, queuePlan);
+    ctx.graphicsQueue = ctx.queuePool->acquire(ctx.queueFamily.graphics);
+    ctx.presentQueue = ctx.queueFamily.presentation == ctx.queueFamily.graphics ?
+        ctx.graphicsQueue : ctx.queuePool->acquire(ctx.queueFamily.presentation);
+    stageUs[StageDevice] = elapsedUs(start);
+
+    start = Clock::now();
+    ctx.profile = getSwapChainProfile(ctx.physicalDevice, ctx.surface, window);
+    ctx.swapchain = createSwapchain(ctx.device, ctx.surface, ctx.profile, ctx.queueFamily, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+    uint32_t imageCount;
+    vkGetSwapchainImagesKHR(ctx.device, ctx.swapchain, &imageCount, nullptr);
+    ctx.images.resize(imageCount);
+    vkGetSwapchainImagesKHR(ctx.device, ctx.swapchain, &imageCount, ctx.images.data());
+    ctx.views = createSwapchainImageViews(ctx.device, ctx.images, ctx.profile.format.format);
+    stageUs[StageSwapchain] = elapsedUs(start);
+
+    start = Clock::now();
+    VkShaderModule vertexShader, fragmentShader;
+    createShaders(ctx.device, vertexShader, fragmentShader);
+    stageUs[StageShaders] = elapsedUs(start);
+
+    start = Clock::now();
+    //room for one uniform block per draw at the largest default draw count
+    ctx.frameData = std::make_unique<FrameAllocator>(ctx.physicalDevice, ctx.device, maxBenchFramesInFlight, 1024 * 1024);
+    if (!ctx.frameData->valid())
+        exitWithError("cant create frame allocator");
+    ctx.pipelineLayout = createPipelineLayout(ctx.device, ctx.frameData->setLayout());
+    ctx.renderPass = createRenderPass(ctx.device, ctx.profile.format.format);
+    ctx.pipeline = createGraphicsPipeline(ctx.device, ctx.renderPass, ctx.pipelineLayout, vertexShader, fragmentShader);
+    if (ctx.pipeline == VK_NULL_HANDLE)
+        exitWithError("failed to create graphics pipeline!");
+    ctx.framebuffers = createFramebuffers(ctx.device, ctx.renderPass, ctx.views, ctx.profile.extent);
+    stageUs[StagePipeline] = elapsedUs(start);
+
+    vkDestroyShaderModule(ctx.device, vertexShader, nullptr);
+    vkDestroyShaderModule(ctx.device, fragmentShader, nullptr);
+    return ctx;
+}
+
+static void tearDown(BenchContext& ctx)
+{
+    vkDeviceWaitIdle(ctx.device);
+    for (VkFramebuffer framebuffer : ctx.framebuffers)
+        vkDestroyFramebuffer(ctx.device, framebuffer, nullptr);
+    destroyPipeline(ctx.device, ctx.pipeline, nullptr);
+    vkDestroyPipelineLayout(ctx.device, ctx.pipelineLayout, nullptr);
+    ctx.frameData.reset();
+    vkDestroyRenderPass(ctx.device, ctx.renderPass, nullptr);
+    for (VkImageView view : ctx.views)
+        vkDestroyImageView(ctx.device, view, nullptr);
+    vkDestroySwapchainKHR(ctx.device, ctx.swapchain, nullptr);
+    ctx.queuePool.reset();
+    vkDestroyDevice(ctx.device, nullptr);
+    vkDestroySurfaceKHR(ctx.instance, ctx.surface, nullptr);
+    vkDestroyInstance(ctx.instance, nullptr);
+    ctx = BenchContext{};
+}
+
+struct DrawScenario
+{
+    uint32_t draws;
+    uint32_t verticesPerDraw;
+    uint32_t framesInFlight;
+    //records through RenderCommandEncoder, setting every piece of state before each draw the way Metal code does
+    bool encoder = false;
+};
+
+struct DrawResult
+{
+    double avgFrameMs = 0.0;
+    double p95FrameMs = 0.0;
+    double avgRecordUs = 0.0; //CPU time to record one frame's command buffer, including the per draw data
+    uint32_t framesInFlight = 0; //after clamping
+    double drawsPerSecond = 0.0;
+    double elidedPerFrame = 0.0; //encoder only, state commands it dropped
+};
+
+static DrawResult runDrawScenario(const BenchContext& ctx, const DrawScenario& scenario, uint32_t frames)
+{
+    //same triangle as main(), vertices beyond the first three are issued as instances of it
+    //so the vertex shader never indexes past its position table
+    const uint32_t instances = std::max(1u, scenario.verticesPerDraw / 3);
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = ctx.queueFamily.graphics;
+    VkCommandPool pool;
+    if (vkCreateCommandPool(ctx.device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+        exitWithError("failed to create command pool!");
+
+    const uint32_t inFlight = std::min(scenario.framesInFlight, maxBenchFramesInFlight);
+    std::vector<VkCommandBuffer> cmdBuffers(inFlight);
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = pool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = inFlight;
+    if (vkAllocateCommandBuffers(ctx.device, &allocInfo, cmdBuffers.data()) != VK_SUCCESS)
+        exitWithError("failed to allocate command buffers!");
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    //same synchronization as main(): frames retire through the graphics timeline
+    QueueTimeline timeline(ctx.device, *ctx.graphicsQueue);
+    if (!timeline.valid())
+        exitWithError("cant create timeline semaphore");
+    std::vector<VkSemaphore> imageAvailable(inFlight);
+    std::vector<uint64_t> frameValues(inFlight, 0);
+    std::vector<VkSemaphore> renderFinished(ctx.images.size()); //per image, reused only after that image is acquired again
+    for (uint32_t i = 0; i < inFlight; ++i)
+        if (vkCreateSemaphore(ctx.device, &semaphoreInfo, nullptr, &imageAvailable[i]) != VK_SUCCESS)
+            exitWithError("failed to create synchronisation objects!");
+    for (VkSemaphore& semaphore : renderFinished)
+        if (vkCreateSemaphore(ctx.device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+            exitWithError("failed to create semaphore!");
+
+    CommandQueue commandQueue(ctx.device, timeline, inFlight);
+    if (!commandQueue.valid())
+        exitWithError("failed to create command queue!");
+    uint64_t elided = 0;
+
+    VkViewport viewport{ 0.0f, 0.0f, float(ctx.profile.extent.width), float(ctx.profile.extent.height), 0.0f, 1.0f };
+    VkRect2D scissor{ { 0, 0 }, ctx.profile.extent };
+
+    constexpr uint32_t warmupFrames = 10;
+    std::vector<double> frameMs;
+    frameMs.reserve(frames);
+    double recordUs = 0.0;
+    auto lastFrame = Clock::now();
+
+    for (uint32_t frame = 0; frame < warmupFrames + frames; ++frame)
+    {
+        const uint32_t slot = frame % inFlight;
+        if (!timeline.wait(frameValues[slot]))
+            exitWithError("device lost while waiting for a frame");
+
+        uint32_t imageIndex;
+        vkAcquireNextImageKHR(ctx.device, ctx.swapchain, UINT64_MAX, imageAvailable[slot], VK_NULL_HANDLE, &imageIndex);
+
+        const auto recordStart = Clock::now();
+        ctx.frameData->beginFrame(slot);
+        if (scenario.encoder)
+        {
+            CommandBuffer* commandBuffer = commandQueue.commandBuffer();
+            if (commandBuffer == nullptr)
+                exitWithError("failed to begin recording command buffer!");
+            const uint64_t elidedBefore = commandBuffer->stats().elided;
+            RenderPassDescriptor pass;
+            pass.renderPass = ctx.renderPass;
+            pass.framebuffer = ctx.framebuffers[imageIndex];
+            pass.renderArea = scissor;
+            RenderCommandEncoder* encoder = commandBuffer->renderCommandEncoder(pass);
+            if (encoder == nullptr)
+                exitWithError("failed to begin recording command buffer!");
+            const VkDescriptorSet frameSet = ctx.frameData->descriptorSet();
+            for (uint32_t draw = 0; draw < scenario.draws; ++draw)
+            {
+                encoder->setRenderPipelineState({ ctx.pipeline, ctx.pipelineLayout });
+                encoder->setViewport(viewport);
+                encoder->setScissorRect(scissor);
+
+                FrameUniforms uniforms;
+                uniforms.tint[1] = float(draw % 256) / 255.0f;
+                uint32_t dynamicOffsets[2] = { 0, 0 };
+                if (!ctx.frameData->push(uniforms, dynamicOffsets[0]))
+                    dynamicOffsets[0] = 0;
+                encoder->setDescriptorSet(0, frameSet, dynamicOffsets, 2);
+
+                DrawPushConstants drawData;
+                drawData.scale = 1.0f - float(draw % 8) * 0.1f;
+                encoder->setBytes(&drawData, sizeof(drawData), drawPushConstantStages);
+                encoder->drawPrimitives(0, 3, instances);
+            }
+            encoder->endEncoding();
+            if (frame >= warmupFrames)
+            {
+                recordUs += elapsedUs(recordStart);
+                elided += commandBuffer->stats().elided - elidedBefore;
+            }
+            commandBuffer->waitForSemaphore(imageAvailable[slot], VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+            commandBuffer->signalSemaphore(renderFinished[imageIndex]);
+            frameValues[slot] = commandBuffer->commit();
+            if (frameValues[slot] == 0)
+                exitWithError("cmd buffer failed to submit");
+        }
+        else
+        {
+            VkCommandBuffer cmd = cmdBuffers[slot];
+            vkResetCommandBuffer(cmd, 0);
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkBeginCommandBuffer(cmd, &beginInfo);
+
+            VkClearValue clearColor = { { {0.0f, 0.0f, 0.0f, 1.0f} } };
+            VkRenderPassBeginInfo renderPassInfo{};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassInfo.renderPass = ctx.renderPass;
+            renderPassInfo.framebuffer = ctx.framebuffers[imageIndex];
+            renderPassInfo.renderArea = scissor;
+            renderPassInfo.clearValueCount = 1;
+            renderPassInfo.pClearValues = &clearColor;
+            vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx.pipeline);
+            vkCmdSetViewport(cmd, 0, 1, &viewport);
+            vkCmdSetScissor(cmd, 0, 1, &scissor);
+            //per draw data the way an application would feed transforms: a uniform block through the frame allocator
+            //selected with a dynamic offset, plus the push constants
+            const VkDescriptorSet frameSet = ctx.frameData->descriptorSet();
+            for (uint32_t draw = 0; draw < scenario.draws; ++draw)
+            {
+                FrameUniforms uniforms;
+                uniforms.tint[1] = float(draw % 256) / 255.0f;
+                uint32_t dynamicOffsets[2] = { 0, 0 };
+                if (!ctx.frameData->push(uniforms, dynamicOffsets[0]))
+                    dynamicOffsets[0] = 0; //region full, reuse the first block rather than abort the measurement
+                vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx.pipelineLayout, 0, 1, &frameSet, 2, dynamicOffsets);
+
+                DrawPushConstants drawData;
+                drawData.scale = 1.0f - float(draw % 8) * 0.1f;
+                vkCmdPushConstants(cmd, ctx.pipelineLayout, drawPushConstantStages, 0, sizeof(drawData), &drawData);
+                vkCmdDraw(cmd, 3, instances, 0, 0);
+            }
+            vkCmdEndRenderPass(cmd);
+            if (vkEndCommandBuffer(cmd) != VK_SUCCESS)
+                exitWithError("Failed to create command buffer");
+            if (frame >= warmupFrames)
+                recordUs += elapsedUs(recordStart);
+
+            frameValues[slot] = timeline.submit(&cmd, 1, { { imageAvailable[slot], 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT } },
+                { renderFinished[imageIndex] });
+            if (frameValues[slot] == 0)
+                exitWithError("cmd buffer failed to submit");
+        }
+
+        VkPresentInfoKHR presentInfo{};
+        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        presentInfo.waitSemaphoreCount = 1;
+        presentInfo.pWaitSemaphores = &renderFinished[imageIndex];
+        presentInfo.swapchainCount = 1;
+        presentInfo.pSwapchains = &ctx.swapchain;
+        presentInfo.pImageIndices = &imageIndex;
+        ctx.presentQueue->present(&presentInfo);
+
+        const auto now = Clock::now();
+        if (frame >= warmupFrames)
+            frameMs.push_back(std::chrono::duration<double, std::milli>(now - lastFrame).count());
+        lastFrame = now;
+    }
+    vkDeviceWaitIdle(ctx.device);
+
+    for (VkSemaphore semaphore : renderFinished)
+        vkDestroySemaphore(ctx.device, semaphore, nullptr);
+    for (VkSemaphore semaphore : imageAvailable)
+        vkDestroySemaphore(ctx.device, semaphore, nullptr);
+    timeline.destroy();
+    vkDestroyCommandPool(ctx.device, pool, nullptr);
+
+    DrawResult result;
+    result.framesInFlight = inFlight;
+    if (frameMs.empty())
+        return result;
+    double total = 0.0;
+    for (double ms : frameMs)
+        total += ms;
+    result.avgFrameMs = total / frameMs.size();
+    result.avgRecordUs = recordUs / frameMs.size();
+    result.drawsPerSecond = result.avgFrameMs > 0.0 ? scenario.draws * 1000.0 / result.avgFrameMs : 0.0;
+    result.elidedPerFrame = double(elided) / frameMs.size();
+    std::sort(frameMs.begin(), frameMs.end());
+    result.p95FrameMs = frameMs[frameMs.size() * 95 / 100];
+    return result;
+}
+
+struct HeapResult
+{
+    uint32_t images = 0;
+    uint32_t aliased = 0;
+    VkDeviceSize separateBytes = 0; //one allocation per image
+    VkDeviceSize heapBytes = 0;     //transient heap with aliasing
+};
+
+//render targets of a typical deferred frame at the swapchain extent, with the passes they live through:
+//0 gbuffer, 1 lighting, 2 bloom down, 3 bloom up, 4 tonemap into the swapchain
+static HeapResult runHeapScenario(const BenchContext& ctx)
+{
+    const VkExtent2D extent = ctx.profile.extent;
+    auto target = [](VkFormat format, VkExtent2D size, VkImageUsageFlags usage, uint32_t firstPass, uint32_t lastPass) {
+        TransientImages::Desc desc;
+        desc.info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        desc.info.imageType = VK_IMAGE_TYPE_2D;
+        desc.info.format = format;
+        desc.info.extent = { std::max(1u, size.width), std::max(1u, size.height), 1 };
+        desc.info.mipLevels = 1;
+        desc.info.arrayLayers = 1;
+        desc.info.samples = VK_SAMPLE_COUNT_1_BIT;
+        desc.info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        desc.info.usage = usage;
+        desc.info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        desc.info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        desc.firstPass = firstPass;
+        desc.lastPass = lastPass;
+        return desc;
+    };
+    const VkImageUsageFlags color = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    const VkExtent2D half = { extent.width / 2, extent.height / 2 };
+    const VkExtent2D quarter = { extent.width / 4, extent.height / 4 };
+
+    TransientImages transient(ctx.physicalDevice, ctx.device);
+    transient.add(target(VK_FORMAT_R8G8B8A8_UNORM, extent, color, 0, 1));      //albedo
+    transient.add(target(VK_FORMAT_R16G16B16A16_SFLOAT, extent, color, 0, 1)); //normals
+    TransientImages::Desc depth = target(VK_FORMAT_D16_UNORM, extent, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 0, 1);
+    depth.firstLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depth.firstStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    depth.firstAccess = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    depth.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+    transient.add(depth);
+    transient.add(target(VK_FORMAT_R16G16B16A16_SFLOAT, extent, color, 1, 4));  //lit HDR
+    transient.add(target(VK_FORMAT_R16G16B16A16_SFLOAT, half, color, 2, 3));    //bloom half
+    transient.add(target(VK_FORMAT_R16G16B16A16_SFLOAT, quarter, color, 2, 3)); //bloom quarter
+    transient.add(target(VK_FORMAT_R16G16B16A16_SFLOAT, half, color, 3, 4));    //bloom upsampled
+    constexpr uint32_t passCount = 5;
+    if (!transient.build())
+        exitWithError("cant build the transient heap");
+
+    //run the aliasing barriers of a frame once so a validation run sees them
+    QueueTimeline timeline(ctx.device, *ctx.graphicsQueue);
+    CommandQueue commandQueue(ctx.device, timeline, 1);
+    CommandBuffer* commandBuffer = commandQueue.commandBuffer();
+    if (!timeline.valid() || commandBuffer == nullptr)
+        exitWithError("cant record the transient heap barriers");
+    for (uint32_t pass = 0; pass < passCount; ++pass)
+        transient.beginPass(commandBuffer->handle(), pass);
+    if (commandBuffer->commit() == 0 || !commandBuffer->waitUntilCompleted())
+        exitWithError("transient heap barriers failed to submit");
+
+    HeapResult result;
+    result.images = transient.count();
+    result.aliased = transient.aliasedCount();
+    result.separateBytes = transient.separateBytes();
+    result.heapBytes = transient.heapBytes();
+    return result;
+}
+
+struct HazardResult
+{
+    double trackedUsPerFrame = 0.0;
+    double untrackedUsPerFrame = 0.0;
+    double nsPerUse = 0.0;
+    double barriersPerFrame = 0.0;
+    double barrierCallsPerFrame = 0.0;
+    uint64_t usesPerFrame = 0;
+};
+
+//CPU cost of hazard tracking alone, nothing is recorded so the handles are never dereferenced
+//half buffers, half images (every eighth with a mip chain); each resource is written by one encoder and read by the next,
+//images switch between GENERAL and SHADER_READ_ONLY_OPTIMAL so every frame has layout transitions
+static HazardResult runHazardScenario(uint32_t resources, uint32_t frames)
+{
+    constexpr uint32_t encoders = 8;
+    HazardTracker tracker;
+    for (uint32_t i = 0; i < resources; ++i)
+    {
+        const uint64_t fakeHandle = i + 1;
+        if (i % 2 == 0)
+            tracker.addBuffer((VkBuffer)(uintptr_t)fakeHandle);
+        else
+            tracker.addImage((VkImage)(uintptr_t)fakeHandle, VK_IMAGE_ASPECT_COLOR_BIT, i % 16 == 1 ? 4 : 1, 1, VK_IMAGE_LAYOUT_UNDEFINED);
+    }
+
+    auto runFrame = [&tracker, resources]() {
+        for (uint32_t encoder = 0; encoder < encoders; ++encoder)
+        {
+            for (uint32_t i = encoder; i < resources; i += encoders)
+            {
+                if (i % 2 == 0)
+                    tracker.useBuffer(i, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+                else
+                    tracker.useImage(i, VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+            }
+            for (uint32_t i = (encoder + encoders - 1) % encoders; i < resources; i += encoders)
+            {
+                if (i % 2 == 0)
+                    tracker.useBuffer(i, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+                else
+                    tracker.useImage(i, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+            }
+            tracker.resolve();
+        }
+    };
+
+    HazardResult result;
+    runFrame(); //first frame transitions out of UNDEFINED
+    const HazardTracker::Stats before = tracker.stats();
+    auto start = Clock::now();
+    for (uint32_t frame = 0; frame < frames; ++frame)
+        runFrame();
+    result.trackedUsPerFrame = elapsedUs(start) / frames;
+    const HazardTracker::Stats& after = tracker.stats();
+    result.usesPerFrame = (after.uses - before.uses) / frames;
+    result.barriersPerFrame = double(after.bufferBarriers + after.imageBarriers - before.bufferBarriers - before.imageBarriers) / frames;
+    result.barrierCallsPerFrame = double(after.barrierCalls - before.barrierCalls) / frames;
+    result.nsPerUse = result.usesPerFrame > 0 ? result.trackedUsPerFrame * 1000.0 / result.usesPerFrame : 0.0;
+
+    for (uint32_t i = 0; i < resources; ++i)
+        tracker.setTracking(i, HazardTracking::Untracked);
+    start = Clock::now();
+    for (uint32_t frame = 0; frame < frames; ++frame)
+        runFrame();
+    result.untrackedUsPerFrame = elapsedUs(start) / frames;
+    return result;
+}
+
+struct MeshResult
+{
+    uint32_t vertices = 0;
+    uint32_t triangles = 0;
+    uint64_t naiveBytes = 0;
+    uint64_t packedBytes = 0;
+    double naiveLoadUs = 0.0;  //read into vectors, then upload
+    double packedLoadUs = 0.0; //loadMesh: map and upload
+    double naiveAcmr = 0.0;
+    double packedAcmr = 0.0;
+    //bytes the vertex fetch reads per draw: one vertex per post transform cache miss plus the indices
+    double naiveFetchBytes = 0.0;
+    double packedFetchBytes = 0.0;
+};
+
+//UV sphere of rings x 2 rings quads as the float32 layout a loader without a packer would use (32 byte vertices,
+//32 bit indices, generation order) against the packed file; both go through a file so the load includes the disk cache read
+static MeshResult runMeshScenario(const BenchContext& ctx, uint32_t rings)
+{
+    const uint32_t segments = rings * 2;
+    MeshData mesh;
+    for (uint32_t i = 0; i <= rings; ++i)
+        for (uint32_t j = 0; j <= segments; ++j)
+        {
+            const float theta = 3.14159265f * i / rings;
+            const float phi = 2.0f * 3.14159265f * j / segments;
+            const float n[3] = { std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) };
+            mesh.vertices.push_back({ { n[0], n[1], n[2] }, { n[0], n[1], n[2] }, { float(j) / segments, float(i) / rings } });
+        }
+    for (uint32_t i = 0; i < rings; ++i)
+        for (uint32_t j = 0; j < segments; ++j)
+        {
+            const uint32_t a = i * (segments + 1) + j;
+            const uint32_t c = a + segments + 1;
+            mesh.indices.insert(mesh.indices.end(), { a, c, c + 1, a, c + 1, a + 1 });
+        }
+
+    MeshResult result;
+    result.vertices = static_cast<uint32_t>(mesh.vertices.size());
+    result.triangles = static_cast<uint32_t>(mesh.indices.size() / 3);
+    result.naiveAcmr = averageCacheMissRatio(mesh.indices, result.vertices);
+    result.naiveBytes = sizeof(uint32_t) * 2 + uint64_t(mesh.vertices.size()) * sizeof(FloatVertex) + mesh.indices.size() * sizeof(uint32_t);
+    result.naiveFetchBytes = result.naiveAcmr * result.triangles * sizeof(FloatVertex) + mesh.indices.size() * sizeof(uint32_t);
+
+    const std::filesystem::path folder = std::filesystem::temp_directory_path();
+    const std::string naivePath = (folder / "metalOverVulkanBench_naive.bin").string();
+    const std::string packedPath = (folder / "metalOverVulkanBench_packed.mesh").string();
+    {
+        std::ofstream file(naivePath, std::ios::binary);
+        const uint32_t counts[2] = { result.vertices, static_cast<uint32_t>(mesh.indices.size()) };
+        file.write(reinterpret_cast<const char*>(counts), sizeof(counts));
+        file.write(reinterpret_cast<const char*>(mesh.vertices.data()), mesh.vertices.size() * sizeof(FloatVertex));
+        file.write(reinterpret_cast<const char*>(mesh.indices.data()), mesh.indices.size() * sizeof(uint32_t));
+        if (!file)
+            exitWithError("cant write the naive mesh file");
+    }
+
+    optimizeVertexCache(mesh.indices, result.vertices);
+    optimizeVertexFetch(mesh);
+    const PackedMesh packed = packMesh(mesh);
+    if (!writePackedMesh(packedPath, packed))
+        exitWithError("cant write the packed mesh file");
+    result.packedAcmr = averageCacheMissRatio(packed.indices, packed.header.vertexCount);
+    result.packedBytes = packed.header.indexOffset + uint64_t(packed.header.indexCount) * packed.header.indexSize;
+    result.packedFetchBytes = result.packedAcmr * result.triangles * sizeof(MeshVertex) + double(packed.header.indexCount) * packed.header.indexSize;
+
+    QueueTimeline timeline(ctx.device, *ctx.graphicsQueue);
+    if (!timeline.valid())
+        exitWithError("cant create the mesh upload timeline");
+    constexpr int loads = 5;
+    std::vector<double> naiveUs, packedUs;
+    for (int run = 0; run < loads; ++run)
+    {
+        auto start = Clock::now();
+        {
+            std::ifstream file(naivePath, std::ios::binary);
+            uint32_t counts[2] = {};
+            file.read(reinterpret_cast<char*>(counts), sizeof(counts));
+            std::vector<FloatVertex> vertices(counts[0]);
+            std::vector<uint32_t> indices(counts[1]);
+            file.read(reinterpret_cast<char*>(vertices.data()), vertices.size() * sizeof(FloatVertex));
+            file.read(reinterpret_cast<char*>(indices.data()), indices.size() * sizeof(uint32_t));
+            Mesh naive;
+            if (!file || !uploadMesh(ctx.physicalDevice, ctx.device, timeline, vertices.data(), vertices.size() * sizeof(FloatVertex),
+                indices.data(), indices.size() * sizeof(uint32_t), naive))
+                exitWithError("naive mesh load failed");
+            naiveUs.push_back(elapsedUs(start));
+            destroyMesh(ctx.device, naive);
+        }
+
+        start = Clock::now();
+        Mesh mapped;
+        if (!loadMesh(ctx.physicalDevice, ctx.device, timeline, packedPath, mapped))
+            exitWithError("packed mesh load failed");
+        packedUs.push_back(elapsedUs(start));
+        destroyMesh(ctx.device, mapped);
+    }
+    result.naiveLoadUs = median(naiveUs);
+    result.packedLoadUs = median(packedUs);
+
+    std::remove(naivePath.c_str());
+    std::remove(packedPath.c_str());
+    return result;
+}
+
+struct SubmitResult
+{
+    double submitsPerSecond = 0.0;
+    uint32_t distinctQueues = 0;
+};
+
+//CPU side submit throughput: every thread submits the same empty command buffer submits times
+//pooled threads lease their own graphics family queue, otherwise all of them share the render queue and its lock
+static SubmitResult runSubmitScenario(const BenchContext& ctx, uint32_t threads, uint32_t submits, bool pooled)
+{
+    struct Submitter
+    {
+        QueuePool::Queue* queue;
+        VkCommandPool pool;
+        VkCommandBuffer cmd;
+    };
+    std::vector<Submitter> submitters(threads);
+    for (Submitter& submitter : submitters)
+    {
+        submitter.queue = pooled ? ctx.queuePool->acquire(ctx.queueFamily.graphics) : ctx.graphicsQueue;
+
+        //command pools are externally synchronized too, one per thread
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = ctx.queueFamily.graphics;
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT; //resubmitted while still pending
+        if (vkCreateCommandPool(ctx.device, &poolInfo, nullptr, &submitter.pool) != VK_SUCCESS)
+            exitWithError("failed to create command pool!");
+        allocInfo.commandPool = submitter.pool;
+        if (vkAllocateCommandBuffers(ctx.device, &allocInfo, &submitter.cmd) != VK_SUCCESS ||
+            vkBeginCommandBuffer(submitter.cmd, &beginInfo) != VK_SUCCESS || vkEndCommandBuffer(submitter.cmd) != VK_SUCCESS)
+            exitWithError("failed to record submit benchmark command buffer");
+    }
+
+    std::atomic<uint32_t> ready{ 0 };
+    std::atomic<bool> go{ false };
+    std::vector<std::thread> workers;
+    for (Submitter& submitter : submitters)
+    {
+        workers.emplace_back([&submitter, &ready, &go, submits] {
+            VkSubmitInfo submitInfo{};
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &submitter.cmd;
+            ++ready;
+            while (!go)
+                std::this_thread::yield();
+            for (uint32_t i = 0; i < submits; ++i)
+                if (submitter.queue->submit(1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+                    exitWithError("cmd buffer failed to submit");
+            });
+    }
+    while (ready < threads)
+        std::this_thread::yield();
+    const auto start = Clock::now();
+    go = true;
+    for (std::thread& worker : workers)
+        worker.join();
+    const double seconds = elapsedUs(start) / 1e6;
+    vkDeviceWaitIdle(ctx.device);
+
+    SubmitResult result;
+    std::vector<VkQueue> queues;
+    for (Submitter& submitter : submitters)
+    {
+        if (std::find(queues.begin(), queues.end(), submitter.queue->handle()) == queues.end())
+            queues.push_back(submitter.queue->handle());
+        if (pooled)
+            ctx.queuePool->release(submitter.queue);
+        vkDestroyCommandPool(ctx.device, submitter.pool, nullptr);
+    }
+    result.distinctQueues = static_cast<uint32_t>(queues.size());
+    result.submitsPerSecond = seconds > 0.0 ? double(threads) * submits / seconds : 0.0;
+    return result;
+}
+
+static std::vector<uint32_t> parseList(const char* text)
+{
+    std::vector<uint32_t> values;
+    std::istringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        const unsigned long value = std::strtoul(item.c_str(), nullptr, 10);
+        if (value > 0)
+            values.push_back(uint32_t(value));
+    }
+    return values;
+}
+
+static std::string jsonString(const char* text)
+{
+    std::string out = "\"";
+    for (const char* c = text; *c; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+            out += '\\';
+        out += *c;
+    }
+    return out + "\"";
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t startupRuns = 5;
+    uint32_t frames = 200;
+    std::vector<uint32_t> drawCounts = { 1, 100, 1000 };
+    std::vector<uint32_t> vertexCounts = { 3, 300 };
+    std::vector<uint32_t> framesInFlight = { 1, 2, 3 };
+    std::vector<uint32_t> submitThreads = { 1, 2, 4 };
+    uint32_t submits = 2000;
+    std::vector<uint32_t> encoderDraws = { 100, 1000 };
+    uint32_t hazardResources = 10000;
+    uint32_t meshRings = 256;
+    bool headless = true;
+    std::string outPath;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--runs" && i + 1 < argc)
+            startupRuns = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--frames" && i + 1 < argc)
+            frames = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--draws" && i + 1 < argc)
+            drawCounts = parseList(argv[++i]);
+        else if (arg == "--vertices" && i + 1 < argc)
+            vertexCounts = parseList(argv[++i]);
+        else if (arg == "--frames-in-flight" && i + 1 < argc)
+            framesInFlight = parseList(argv[++i]);
+        else if (arg == "--submit-threads" && i + 1 < argc)
+            submitThreads = parseList(argv[++i]);
+        else if (arg == "--submits" && i + 1 < argc)
+            submits = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--encoder-draws" && i + 1 < argc)
+            encoderDraws = parseList(argv[++i]);
+        else if (arg == "--hazard-resources" && i + 1 < argc)
+            hazardResources = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--mesh-rings" && i + 1 < argc)
+            meshRings = std::max(2ul, std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--windowed")
+            headless = false;
+        else if (arg == "--out" && i + 1 < argc)
+            outPath = argv[++i];
+        else
+            std::cerr << "Unknown argument \"" << arg << "\" ignored\n";
+    }
+
+    GLFWwindow* window = initGLFW(headless);
+    if (window == nullptr)
+        exitWithError("glfw cant initialize");
+
+    //one graphics queue per submit thread if the family has them, the render queue keeps the highest priority
+    QueueConfig queueConfig;
+    const uint32_t maxSubmitThreads = submitThreads.empty() ? 1 : *std::max_element(submitThreads.begin(), submitThreads.end());
+    queueConfig.graphics.resize(maxSubmitThreads + 1, 0.5f);
+
+    //every run but the last tears down again, the last context is reused for the draw scenarios
+    std::vector<double> stageSamples[StageCount];
+    BenchContext ctx;
+    for (uint32_t run = 0; run < startupRuns; ++run)
+    {
+        if (run > 0)
+            tearDown(ctx);
+        double stageUs[StageCount];
+        ctx = startUp(window, queueConfig, stageUs);
+        for (int stage = 0; stage < StageCount; ++stage)
+            stageSamples[stage].push_back(stageUs[stage]);
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(ctx.physicalDevice, &properties);
+
+    std::ostringstream json;
+    json << "{\n";
+    json << "  \"device\": " << jsonString(properties.deviceName) << ",\n";
+    json << "  \"driver_version\": " << properties.driverVersion << ",\n";
+    json << "  \"extent\": [" << ctx.profile.extent.width << ", " << ctx.profile.extent.height << "],\n";
+    json << "  \"headless\": " << (headless ? "true" : "false") << ",\n";
+    json << "  \"startup\": {\n    \"runs\": " << startupRuns << ",\n    \"stages\": [\n";
+    double totalMedian = 0.0;
+    for (int stage = 0; stage < StageCount; ++stage)
+    {
+        const double med = median(stageSamples[stage]);
+        totalMedian += med;
+        json << "      { \"name\": \"" << stageNames[stage] << "\", \"median_us\": " << med
+            << ", \"min_us\": " << *std::min_element(stageSamples[stage].begin(), stageSamples[stage].end()) << " }"
+            << (stage + 1 < StageCount ? ",\n" : "\n");
+    }
+    json << "    ],\n    \"total_median_us\": " << totalMedian << "\n  },\n";
+
+    json << "  \"draw_scenarios\": [\n";
+    bool first = true;
+    for (uint32_t inFlight : framesInFlight)
+        for (uint32_t draws : drawCounts)
+            for (uint32_t vertices : vertexCounts)
+            {
+                const DrawScenario scenario{ draws, vertices, inFlight };
+                const DrawResult result = runDrawScenario(ctx, scenario, frames);
+                std::cerr << "draws " << draws << ", vertices " << vertices << ", frames in flight " << inFlight
+                    << ": " << result.avgFrameMs << " ms/frame\n";
+                json << (first ? "" : ",\n") << "    { \"draws\": " << draws << ", \"vertices_per_draw\": " << vertices
+                    << ", \"frames_in_flight\": " << result.framesInFlight << ", \"frames\": " << frames
+                    << ", \"avg_frame_ms\": " << result.avgFrameMs << ", \"p95_frame_ms\": " << result.p95FrameMs
+                    << ", \"avg_record_us\": " << result.avgRecordUs << ", \"draws_per_second\": " << result.drawsPerSecond << " }";
+                first = false;
+            }
+    json << "\n  ],\n";
+
+    {
+        const HeapResult heap = runHeapScenario(ctx);
+        const double saved = heap.separateBytes > 0 ? 100.0 * (1.0 - double(heap.heapBytes) / heap.separateBytes) : 0.0;
+        std::cerr << "transient heap: " << heap.separateBytes / 1024 << " KiB separate, " << heap.heapBytes / 1024 << " KiB aliased ("
+            << saved << "% saved)\n";
+        json << "  \"transient_heap\": { \"images\": " << heap.images << ", \"aliased_images\": " << heap.aliased
+            << ", \"separate_bytes\": " << heap.separateBytes << ", \"heap_bytes\": " << heap.heapBytes
+            << ", \"saved_percent\": " << saved << " },\n";
+    }
+
+    {
+        const HazardResult hazard = runHazardScenario(hazardResources, frames);
+        std::cerr << "hazard tracking, " << hazardResources << " resources: " << hazard.trackedUsPerFrame << " us/frame tracked, "
+            << hazard.untrackedUsPerFrame << " us/frame untracked, " << hazard.nsPerUse << " ns/use\n";
+        json << "  \"hazard_tracking\": { \"resources\": " << hazardResources << ", \"uses_per_frame\": " << hazard.usesPerFrame
+            << ", \"tracked_us_per_frame\": " << hazard.trackedUsPerFrame << ", \"untracked_us_per_frame\": " << hazard.untrackedUsPerFrame
+            << ", \"ns_per_use\": " << hazard.nsPerUse << ", \"barriers_per_frame\": " << hazard.barriersPerFrame
+            << ", \"barrier_calls_per_frame\": " << hazard.barrierCallsPerFrame << " },\n";
+    }
+
+    {
+        const MeshResult mesh = runMeshScenario(ctx, meshRings);
+        std::cerr << "mesh, " << mesh.vertices << " vertices: load " << mesh.packedLoadUs << " us packed vs " << mesh.naiveLoadUs
+            << " us float32, fetch " << mesh.packedFetchBytes / 1024 << " KiB vs " << mesh.naiveFetchBytes / 1024 << " KiB per draw\n";
+        json << "  \"mesh_loading\": { \"vertices\": " << mesh.vertices << ", \"triangles\": " << mesh.triangles
+            << ", \"float32_file_bytes\": " << mesh.naiveBytes << ", \"packed_file_bytes\": " << mesh.packedBytes
+            << ", \"float32_load_us\": " << mesh.naiveLoadUs << ", \"packed_load_us\": " << mesh.packedLoadUs
+            << ", \"float32_acmr\": " << mesh.naiveAcmr << ", \"packed_acmr\": " << mesh.packedAcmr
+            << ", \"float32_fetch_bytes_per_draw\": " << mesh.naiveFetchBytes << ", \"packed_fetch_bytes_per_draw\": " << mesh.packedFetchBytes
+            << " },\n";
+    }
+
+    json << "  \"submit_scenarios\": [\n";
+    first = true;
+    for (uint32_t threads : submitThreads)
+        for (bool pooled : { false, true })
+        {
+            const SubmitResult result = runSubmitScenario(ctx, threads, submits, pooled);
+            std::cerr << "submit threads " << threads << (pooled ? ", queue pool" : ", shared queue") << ": "
+                << result.submitsPerSecond << " submits/s on " << result.distinctQueues << " queues\n";
+            json << (first ? "" : ",\n") << "    { \"threads\": " << threads << ", \"mode\": \"" << (pooled ? "pool" : "shared")
+                << "\", \"submits_per_thread\": " << submits << ", \"queues\": " << result.distinctQueues
+                << ", \"submits_per_second\": " << result.submitsPerSecond << " }";
+            first = false;
+        }
+    json << "\n  ],\n";
+
+    //same draws recorded with raw Vulkan (state set once) and through the encoder (state set before every draw, elided)
+    json << "  \"encoder_scenarios\": [\n";
+    first = true;
+    for (uint32_t draws : encoderDraws)
+    {
+        const DrawResult raw = runDrawScenario(ctx, { draws, 3, 2 }, frames);
+        const DrawResult encoded = runDrawScenario(ctx, { draws, 3, 2, true }, frames);
+        const double rawPerDrawUs = raw.avgRecordUs / draws;
+        const double encoderPerDrawUs = encoded.avgRecordUs / draws;
+        std::cerr << "encoder, draws " << draws << ": " << encoderPerDrawUs << " us/draw vs raw " << rawPerDrawUs << " us/draw, "
+            << encoded.elidedPerFrame << " commands elided per frame\n";
+        json << (first ? "" : ",\n") << "    { \"draws\": " << draws << ", \"raw_record_us\": " << raw.avgRecordUs
+            << ", \"encoder_record_us\": " << encoded.avgRecordUs << ", \"raw_us_per_draw\": " << rawPerDrawUs
+            << ", \"encoder_us_per_draw\": " << encoderPerDrawUs << ", \"overhead_us_per_draw\": " << encoderPerDrawUs - rawPerDrawUs
+            << ", \"elided_per_frame\": " << encoded.elidedPerFrame << " }";
+        first = false;
+    }
+    json << "\n  ]\n}\n";
+
+    tearDown(ctx);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+
+    if (outPath.empty())
+        std::cout << json.str();
+    else
+    {
+        std::ofstream file(outPath);
+        file << json.str();
+        if (!file)
+            exitWithError("cant write benchmark output");
+    }
+    return 0;
+}
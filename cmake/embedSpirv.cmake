@@ -0,0 +1,25 @@
+# Turns a SPIR-V binary into a header with an aligned constexpr uint32_t array.
+# usage: cmake -DINPUT=<file.spv> -DOUTPUT=<file.h> -DSYMBOL=<name> -P embedSpirv.cmake
+
+file(READ "${INPUT}" hex HEX)
+string(LENGTH "${hex}" hexLength)
+math(EXPR remainder "${hexLength} % 8")
+if (hexLength EQUAL 0 OR NOT remainder EQUAL 0)
+    message(FATAL_ERROR "${INPUT} is not a valid SPIR-V binary")
+endif()
+
+# SPIR-V words are little endian
+string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1u, " words "${hex}")
+# cmake regex has no {n} quantifier, eight words per line
+set(word "0x........u, ")
+string(REGEX REPLACE "(${word}${word}${word}${word}${word}${word}${word}${word})" "\\1\n    " words "${words}")
+
+file(WRITE "${OUTPUT}"
+"// generated from ${INPUT}, do not edit
+#pragma once
+#include <cstdint>
+
+alignas(16) inline constexpr uint32_t ${SYMBOL}[] = {
+    ${words}
+};
+")
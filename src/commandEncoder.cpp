@@ -0,0 +1,339 @@
+#include "commandEncoder.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+void RenderCommandEncoder::reset(VkCommandBuffer cmd)
+{
+    _cmd = cmd;
+    _encoding = false;
+    invalidate();
+}
+
+void RenderCommandEncoder::invalidate()
+{
+    _pipeline = VK_NULL_HANDLE;
+    _layout = VK_NULL_HANDLE;
+    _hasViewport = false;
+    _hasScissor = false;
+    for (BoundSet& bound : _sets)
+        bound = {};
+    for (uint32_t i = 0; i < maxVertexBuffers; ++i)
+        _vertexBuffers[i] = VK_NULL_HANDLE;
+    _indexBuffer = VK_NULL_HANDLE;
+    _pushStages = 0;
+    _pushSize = 0;
+}
+
+void RenderCommandEncoder::begin(VkCommandBuffer cmd, const RenderPassDescriptor& descriptor)
+{
+    _cmd = cmd;
+    _encoding = true;
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = descriptor.renderPass;
+    renderPassInfo.framebuffer = descriptor.framebuffer;
+    renderPassInfo.renderArea = descriptor.renderArea;
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &descriptor.clearColor;
+    vkCmdBeginRenderPass(_cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    if (_trace != nullptr)
+        _trace->beginRenderPass(descriptor.renderArea, descriptor.clearColor);
+}
+
+void RenderCommandEncoder::setRenderPipelineState(const RenderPipelineState& state)
+{
+    if (state.layout != _layout)
+    {//sets and push constants are only kept for compatible layouts, dont try to tell them apart
+        for (BoundSet& bound : _sets)
+            bound = {};
+        _pushStages = 0;
+        _pushSize = 0;
+        _layout = state.layout;
+    }
+    if (state.pipeline == _pipeline)
+    {
+        ++_stats.elided;
+        return;
+    }
+    //viewport and scissor survive, every pipeline of the renderer declares them dynamic
+    vkCmdBindPipeline(_cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, state.pipeline);
+    _pipeline = state.pipeline;
+    ++_stats.issued;
+    if (_trace != nullptr)
+        _trace->bindPipeline(state.pipeline);
+}
+
+void RenderCommandEncoder::setViewport(const VkViewport& viewport)
+{
+    if (_hasViewport && std::memcmp(&viewport, &_viewport, sizeof(VkViewport)) == 0)
+    {
+        ++_stats.elided;
+        return;
+    }
+    vkCmdSetViewport(_cmd, 0, 1, &viewport);
+    _viewport = viewport;
+    _hasViewport = true;
+    ++_stats.issued;
+    if (_trace != nullptr)
+        _trace->setViewport(viewport);
+}
+
+void RenderCommandEncoder::setScissorRect(const VkRect2D& scissor)
+{
+    if (_hasScissor && std::memcmp(&scissor, &_scissor, sizeof(VkRect2D)) == 0)
+    {
+        ++_stats.elided;
+        return;
+    }
+    vkCmdSetScissor(_cmd, 0, 1, &scissor);
+    _scissor = scissor;
+    _hasScissor = true;
+    ++_stats.issued;
+    if (_trace != nullptr)
+        _trace->setScissor(scissor);
+}
+
+void RenderCommandEncoder::setDescriptorSet(uint32_t index, VkDescriptorSet set, const uint32_t* dynamicOffsets, uint32_t dynamicOffsetCount)
+{
+    if (index >= maxDescriptorSets || dynamicOffsetCount > maxDynamicOffsets)
+    {//not shadowed, always recorded
+        vkCmdBindDescriptorSets(_cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _layout, index, 1, &set, dynamicOffsetCount, dynamicOffsets);
+        ++_stats.issued;
+        if (_trace != nullptr)
+            _trace->bindDescriptorSet(index, set, dynamicOffsets, dynamicOffsetCount);
+        return;
+    }
+
+    BoundSet& bound = _sets[index];
+    //dynamicOffsets may be null without offsets, memcmp must not see it even with a zero length
+    if (bound.set == set && bound.offsetCount == dynamicOffsetCount &&
+        (dynamicOffsetCount == 0 || std::memcmp(bound.offsets, dynamicOffsets, dynamicOffsetCount * sizeof(uint32_t)) == 0))
+    {
+        ++_stats.elided;
+        return;
+    }
+    vkCmdBindDescriptorSets(_cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _layout, index, 1, &set, dynamicOffsetCount, dynamicOffsets);
+    bound.set = set;
+    bound.offsetCount = dynamicOffsetCount;
+    if (dynamicOffsetCount > 0)
+        std::memcpy(bound.offsets, dynamicOffsets, dynamicOffsetCount * sizeof(uint32_t));
+    ++_stats.issued;
+    if (_trace != nullptr)
+        _trace->bindDescriptorSet(index, set, dynamicOffsets, dynamicOffsetCount);
+}
+
+void RenderCommandEncoder::setVertexBuffer(VkBuffer buffer, VkDeviceSize offset, uint32_t index)
+{
+    if (index < maxVertexBuffers && _vertexBuffers[index] == buffer && _vertexOffsets[index] == offset)
+    {
+        ++_stats.elided;
+        return;
+    }
+    vkCmdBindVertexBuffers(_cmd, index, 1, &buffer, &offset);
+    if (index < maxVertexBuffers)
+    {
+        _vertexBuffers[index] = buffer;
+        _vertexOffsets[index] = offset;
+    }
+    ++_stats.issued;
+    if (_trace != nullptr)
+        _trace->bindVertexBuffer(buffer, offset, index);
+}
+
+void RenderCommandEncoder::setBytes(const void* data, uint32_t size, VkShaderStageFlags stages)
+{
+    if (size > maxPushBytes)
+    {
+        std::cout << "RenderCommandEncoder: setBytes of " << size << " bytes is over the push constant limit\n";
+        return;
+    }
+    if (stages == _pushStages && size == _pushSize && std::memcmp(data, _pushData, size) == 0)
+    {
+        ++_stats.elided;
+        return;
+    }
+    vkCmdPushConstants(_cmd, _layout, stages, 0, size, data);
+    std::memcpy(_pushData, data, size);
+    _pushStages = stages;
+    _pushSize = size;
+    ++_stats.issued;
+    if (_trace != nullptr)
+        _trace->pushConstants(stages, data, size);
+}
+
+void RenderCommandEncoder::drawPrimitives(uint32_t vertexStart, uint32_t vertexCount, uint32_t instanceCount, uint32_t baseInstance)
+{
+    vkCmdDraw(_cmd, vertexCount, instanceCount, vertexStart, baseInstance);
+    ++_stats.issued;
+    if (_trace != nullptr)
+        _trace->draw(vertexCount, instanceCount, vertexStart, baseInstance);
+}
+
+void RenderCommandEncoder::drawIndexedPrimitives(uint32_t indexCount, VkIndexType indexType, VkBuffer indexBuffer,
+    VkDeviceSize indexBufferOffset, uint32_t instanceCount, int32_t baseVertex)
+{
+    if (indexBuffer == _indexBuffer && indexBufferOffset == _indexOffset && indexType == _indexType)
+        ++_stats.elided;
+    else
+    {
+        vkCmdBindIndexBuffer(_cmd, indexBuffer, indexBufferOffset, indexType);
+        _indexBuffer = indexBuffer;
+        _indexOffset = indexBufferOffset;
+        _indexType = indexType;
+        ++_stats.issued;
+        if (_trace != nullptr)
+            _trace->bindIndexBuffer(indexBuffer, indexBufferOffset, indexType);
+    }
+    vkCmdDrawIndexed(_cmd, indexCount, instanceCount, 0, baseVertex, 0);
+    ++_stats.issued;
+    if (_trace != nullptr)
+        _trace->drawIndexed(indexCount, instanceCount, baseVertex);
+}
+
+void RenderCommandEncoder::endEncoding()
+{
+    if (!_encoding)
+        return;
+    vkCmdEndRenderPass(_cmd);
+    _encoding = false;
+    if (_trace != nullptr)
+        _trace->endRenderPass();
+}
+
+CommandBuffer::CommandBuffer(CommandQueue& queue, VkCommandBuffer cmd)
+    : _queue(queue), _cmd(cmd)
+{
+}
+
+bool CommandBuffer::begin()
+{
+    vkResetCommandBuffer(_cmd, 0);
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(_cmd, &beginInfo) != VK_SUCCESS)
+    {
+        std::cout << "CommandBuffer: failed to begin recording\n";
+        return false;
+    }
+    //nothing is bound in a fresh command buffer
+    _encoder.reset(_cmd);
+    _encoder._trace = _queue.commandTrace();
+    if (_encoder._trace != nullptr)
+        _encoder._trace->beginFrame();
+    _waits.clear();
+    _signals.clear();
+    _recording = true;
+    return true;
+}
+
+RenderCommandEncoder* CommandBuffer::renderCommandEncoder(const RenderPassDescriptor& descriptor)
+{
+    if (!_recording || _encoder._encoding)
+        return nullptr;
+    if (_queue.hazardTracker() != nullptr)
+        _queue.hazardTracker()->flush(_cmd); //barriers are not allowed inside the render pass without a self dependency
+    _encoder.begin(_cmd, descriptor);
+    return &_encoder;
+}
+
+void CommandBuffer::waitForSemaphore(VkSemaphore semaphore, VkPipelineStageFlags stage)
+{
+    _waits.push_back({ semaphore, 0, stage });
+}
+
+void CommandBuffer::signalSemaphore(VkSemaphore semaphore)
+{
+    _signals.push_back(semaphore);
+}
+
+void CommandBuffer::waitForTimeline(const QueueTimeline::Wait& wait)
+{
+    _waits.push_back(wait);
+}
+
+uint64_t CommandBuffer::commit()
+{
+    if (!_recording)
+        return 0;
+    _encoder.endEncoding();
+    if (_queue.hazardTracker() != nullptr)
+        _queue.hazardTracker()->flush(_cmd);
+    _recording = false;
+    if (_encoder._trace != nullptr)
+        _encoder._trace->endFrame();
+    if (vkEndCommandBuffer(_cmd) != VK_SUCCESS)
+    {
+        std::cout << "CommandBuffer: failed to end recording\n";
+        return 0;
+    }
+    _value = _queue.timeline().submit(&_cmd, 1, _waits, _signals);
+    return _value;
+}
+
+bool CommandBuffer::isCompleted() const
+{
+    return _queue.timeline().isComplete(_value);
+}
+
+bool CommandBuffer::waitUntilCompleted()
+{
+    return _queue.timeline().wait(_value);
+}
+
+CommandQueue::CommandQueue(VkDevice device, QueueTimeline& timeline, uint32_t maxCommandBuffersInFlight)
+    : _device(device), _timeline(timeline)
+{
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = timeline.family();
+    if (vkCreateCommandPool(_device, &poolInfo, nullptr, &_pool) != VK_SUCCESS)
+    {
+        std::cout << "CommandQueue: cant create command pool for family " << timeline.family() << "\n";
+        _pool = VK_NULL_HANDLE;
+        return;
+    }
+
+    std::vector<VkCommandBuffer> cmdBuffers(std::max(1u, maxCommandBuffersInFlight));
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = _pool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = static_cast<uint32_t>(cmdBuffers.size());
+    if (vkAllocateCommandBuffers(_device, &allocInfo, cmdBuffers.data()) != VK_SUCCESS)
+    {
+        std::cout << "CommandQueue: cant allocate command buffers\n";
+        vkDestroyCommandPool(_device, _pool, nullptr);
+        _pool = VK_NULL_HANDLE;
+        return;
+    }
+    for (VkCommandBuffer cmd : cmdBuffers)
+        _buffers.push_back(std::unique_ptr<CommandBuffer>(new CommandBuffer(*this, cmd)));
+}
+
+CommandQueue::~CommandQueue()
+{
+    //frees the command buffers, the GPU must be done with them
+    if (_pool != VK_NULL_HANDLE)
+        vkDestroyCommandPool(_device, _pool, nullptr);
+}
+
+CommandBuffer* CommandQueue::commandBuffer()
+{
+    if (_pool == VK_NULL_HANDLE)
+        return nullptr;
+    CommandBuffer& buffer = *_buffers[_next];
+    if (!buffer.waitUntilCompleted() || !buffer.begin())
+        return nullptr;
+    _next = (_next + 1) % _buffers.size();
+    return &buffer;
+}
+
+std::unique_ptr<CommandQueue> Device::newCommandQueue(QueueTimeline& timeline, uint32_t maxCommandBuffersInFlight) const
+{
+    return std::make_unique<CommandQueue>(_device, timeline, maxCommandBuffersInFlight);
+}
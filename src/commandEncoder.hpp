@@ -0,0 +1,205 @@
+#pragma once
+
+#include "commandTrace.hpp"
+#include "hazardTracker.hpp"
+#include "queueTimeline.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+//Metal style encoding on top of Vulkan: Device -> CommandQueue -> CommandBuffer -> RenderCommandEncoder
+//the encoder shadows the state Vulkan keeps per command buffer and drops vkCmd* calls that would not change it,
+//so callers can set everything before each draw the way Metal code does without paying for it
+
+class CommandQueue;
+class CommandBuffer;
+
+//pipeline plus the layout its descriptor sets and push constants are bound through (MTLRenderPipelineState)
+//pipelines must declare viewport and scissor dynamic like createGraphicsPipeline does, otherwise binding one resets them
+struct RenderPipelineState
+{
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+};
+
+//MTLRenderPassDescriptor reduced to what this renderer uses, one color attachment
+struct RenderPassDescriptor
+{
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    VkRect2D renderArea{};
+    VkClearValue clearColor{ { { 0.0f, 0.0f, 0.0f, 1.0f } } };
+};
+
+struct EncoderStats
+{
+    uint64_t issued = 0; //state and draw commands recorded
+    uint64_t elided = 0; //state commands dropped because the state was already set
+};
+
+class RenderCommandEncoder
+{
+public:
+    static constexpr uint32_t maxDescriptorSets = 4;
+    static constexpr uint32_t maxDynamicOffsets = 4;
+    static constexpr uint32_t maxPushBytes = 128; //guaranteed minimum maxPushConstantsSize
+
+    void setRenderPipelineState(const RenderPipelineState& state);
+    void setViewport(const VkViewport& viewport);
+    void setScissorRect(const VkRect2D& scissor);
+    //binds set at index of the current pipeline layout (setVertexBuffer/setFragmentBuffer of a whole argument table)
+    void setDescriptorSet(uint32_t index, VkDescriptorSet set, const uint32_t* dynamicOffsets = nullptr, uint32_t dynamicOffsetCount = 0);
+    void setVertexBuffer(VkBuffer buffer, VkDeviceSize offset, uint32_t index);
+    //small inline data (setVertexBytes/setFragmentBytes), recorded as push constants at offset 0
+    void setBytes(const void* data, uint32_t size, VkShaderStageFlags stages);
+
+    void drawPrimitives(uint32_t vertexStart, uint32_t vertexCount, uint32_t instanceCount = 1, uint32_t baseInstance = 0);
+    //binds indexBuffer unless it already is, then draws indexCount indices from indexBufferOffset
+    void drawIndexedPrimitives(uint32_t indexCount, VkIndexType indexType, VkBuffer indexBuffer, VkDeviceSize indexBufferOffset,
+        uint32_t instanceCount = 1, int32_t baseVertex = 0);
+
+    //ends the render pass, the bound state stays valid for the next encoder of the same command buffer
+    void endEncoding();
+
+    //for recording what the encoder does not cover; state changed behind its back must be followed by invalidate()
+    VkCommandBuffer handle() const { return _cmd; }
+    //forgets all shadowed state so the next set* calls are recorded
+    void invalidate();
+
+    const EncoderStats& stats() const { return _stats; }
+
+private:
+    friend class CommandBuffer;
+
+    void begin(VkCommandBuffer cmd, const RenderPassDescriptor& descriptor);
+    void reset(VkCommandBuffer cmd);
+
+    struct BoundSet
+    {
+        VkDescriptorSet set = VK_NULL_HANDLE;
+        uint32_t offsetCount = 0;
+        uint32_t offsets[maxDynamicOffsets]{};
+    };
+
+    VkCommandBuffer _cmd = VK_NULL_HANDLE;
+    bool _encoding = false;
+    CommandTraceWriter* _trace = nullptr; //sees the commands that survive elision
+
+    //shadowed Vulkan state, valid for the whole command buffer
+    VkPipeline _pipeline = VK_NULL_HANDLE;
+    VkPipelineLayout _layout = VK_NULL_HANDLE;
+    bool _hasViewport = false;
+    VkViewport _viewport{};
+    bool _hasScissor = false;
+    VkRect2D _scissor{};
+    BoundSet _sets[maxDescriptorSets];
+    static constexpr uint32_t maxVertexBuffers = 4;
+    VkBuffer _vertexBuffers[maxVertexBuffers]{};
+    VkDeviceSize _vertexOffsets[maxVertexBuffers]{};
+    VkBuffer _indexBuffer = VK_NULL_HANDLE;
+    VkDeviceSize _indexOffset = 0;
+    VkIndexType _indexType = VK_INDEX_TYPE_UINT32;
+    VkShaderStageFlags _pushStages = 0;
+    uint32_t _pushSize = 0;
+    uint8_t _pushData[maxPushBytes]{};
+
+    EncoderStats _stats;
+};
+
+class CommandBuffer
+{
+public:
+    CommandBuffer(const CommandBuffer&) = delete;
+    CommandBuffer& operator=(const CommandBuffer&) = delete;
+
+    //begins a render pass, nullptr if recording cant begin; only one encoder may be open at a time
+    //with a hazard tracker the barriers for the uses declared since the last encoder are recorded first
+    RenderCommandEncoder* renderCommandEncoder(const RenderPassDescriptor& descriptor);
+
+    //binary semaphores for the swapchain (encodeWait/encodeSignalEvent), applied on commit
+    void waitForSemaphore(VkSemaphore semaphore, VkPipelineStageFlags stage);
+    void signalSemaphore(VkSemaphore semaphore);
+    //waits on a value of another queue's timeline
+    void waitForTimeline(const QueueTimeline::Wait& wait);
+
+    //flushes the hazard tracker, ends recording and submits; returns the timeline value signaled on completion, 0 on failure
+    uint64_t commit();
+
+    bool isCompleted() const;
+    bool waitUntilCompleted();
+
+    //raw access for recording outside an encoder, e.g. copies after the render pass
+    VkCommandBuffer handle() const { return _cmd; }
+    uint64_t timelineValue() const { return _value; }
+    const EncoderStats& stats() const { return _encoder.stats(); }
+
+private:
+    friend class CommandQueue;
+    CommandBuffer(CommandQueue& queue, VkCommandBuffer cmd);
+
+    bool begin();
+
+    CommandQueue& _queue;
+    VkCommandBuffer _cmd;
+    RenderCommandEncoder _encoder;
+    std::vector<QueueTimeline::Wait> _waits;
+    std::vector<VkSemaphore> _signals;
+    uint64_t _value = 0; //of the last commit, 0 before the first
+    bool _recording = false;
+};
+
+//owns a command pool and a ring of command buffers submitted through one queue timeline
+class CommandQueue
+{
+public:
+    //at most maxCommandBuffersInFlight buffers are pending on the GPU, commandBuffer() waits for the oldest beyond that
+    CommandQueue(VkDevice device, QueueTimeline& timeline, uint32_t maxCommandBuffersInFlight);
+    ~CommandQueue();
+
+    CommandQueue(const CommandQueue&) = delete;
+    CommandQueue& operator=(const CommandQueue&) = delete;
+
+    bool valid() const { return _pool != VK_NULL_HANDLE; }
+
+    //next command buffer of the ring, reset and ready to record; nullptr on device loss
+    CommandBuffer* commandBuffer();
+
+    QueueTimeline& timeline() { return _timeline; }
+    VkDevice device() const { return _device; }
+
+    //resources used by this queue's command buffers; nullptr (the default) leaves every barrier to the caller
+    void setHazardTracker(HazardTracker* tracker) { _hazardTracker = tracker; }
+    HazardTracker* hazardTracker() const { return _hazardTracker; }
+    //records the encoder commands of the frames it captures; nullptr (the default) traces nothing
+    void setCommandTrace(CommandTraceWriter* trace) { _trace = trace; }
+    CommandTraceWriter* commandTrace() const { return _trace; }
+
+private:
+    VkDevice _device;
+    QueueTimeline& _timeline;
+    VkCommandPool _pool = VK_NULL_HANDLE;
+    std::vector<std::unique_ptr<CommandBuffer>> _buffers;
+    uint32_t _next = 0;
+    HazardTracker* _hazardTracker = nullptr;
+    CommandTraceWriter* _trace = nullptr;
+};
+
+//entry point of the layer, does not own the Vulkan device
+class Device
+{
+public:
+    Device(VkPhysicalDevice physicalDevice, VkDevice device) : _physicalDevice(physicalDevice), _device(device) {}
+
+    //commands go to the queue behind timeline, see DeviceTimelines
+    std::unique_ptr<CommandQueue> newCommandQueue(QueueTimeline& timeline, uint32_t maxCommandBuffersInFlight = 2) const;
+
+    VkPhysicalDevice physicalDevice() const { return _physicalDevice; }
+    VkDevice handle() const { return _device; }
+
+private:
+    VkPhysicalDevice _physicalDevice;
+    VkDevice _device;
+};
@@ -0,0 +1,385 @@
+#include "commandTrace.hpp"
+
+#include "frameAllocator.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+
+CommandTraceWriter::CommandTraceWriter(std::string path, VkFormat colorFormat, VkExtent2D extent, uint64_t firstFrame, uint32_t frameCount)
+    : _path(std::move(path)), _firstFrame(firstFrame), _frameCount(frameCount)
+{
+    _header.colorFormat = static_cast<uint32_t>(colorFormat);
+    _header.width = extent.width;
+    _header.height = extent.height;
+}
+
+CommandTraceWriter::~CommandTraceWriter()
+{
+    finish();
+}
+
+void CommandTraceWriter::addPipeline(VkPipeline pipeline, TracePipelineDesc desc)
+{
+    //a handle value can come back for a new pipeline after the old one was destroyed, it gets a new id then
+    _pipelines[pipeline] = Pipeline{ _nextId++, std::move(desc) };
+}
+
+void CommandTraceWriter::addBuffer(VkBuffer buffer, const void* data, VkDeviceSize size)
+{
+    _buffers[buffer] = Buffer{ _nextId++, data, size };
+}
+
+void CommandTraceWriter::beginFrame()
+{
+    if (_finished)
+        return;
+    _capturing = _frame >= _firstFrame && _captured < _frameCount;
+    ++_frame;
+    if (_capturing)
+        record(TraceOp::BeginFrame);
+}
+
+void CommandTraceWriter::endFrame()
+{
+    if (!_capturing)
+        return;
+    record(TraceOp::EndFrame);
+    _capturing = false;
+    ++_captured;
+    _capturedBytes = _data.size();
+    if (_captured == _frameCount)
+        finish(); //one file write on the recording thread, after the last captured frame only
+}
+
+void CommandTraceWriter::beginRenderPass(const VkRect2D& renderArea, const VkClearValue& clearColor)
+{
+    if (_capturing)
+        record(TraceOp::BeginRenderPass, TraceBeginRenderPass{ renderArea, clearColor });
+}
+
+void CommandTraceWriter::endRenderPass()
+{
+    if (_capturing)
+        record(TraceOp::EndRenderPass);
+}
+
+void CommandTraceWriter::bindPipeline(VkPipeline pipeline)
+{
+    if (!_capturing)
+        return;
+    uint32_t id = UINT32_MAX;
+    auto found = _pipelines.find(pipeline);
+    if (found == _pipelines.end())
+        warnOnce(_warnedPipeline, "Trace: a pipeline without description was bound, replay skips its draws (hot reloaded?)");
+    else
+    {
+        Pipeline& entry = found->second;
+        if (!entry.defined)
+        {
+            const TracePipelineDesc& desc = entry.desc;
+            const uint32_t counts[5] = { entry.id, static_cast<uint32_t>(desc.vertexSpirv.size()), static_cast<uint32_t>(desc.fragmentSpirv.size()),
+                static_cast<uint32_t>(desc.bindings.size()), static_cast<uint32_t>(desc.attributes.size()) };
+            const size_t start = beginRecord(TraceOp::DefinePipeline);
+            append(counts, sizeof(counts));
+            append(desc.vertexSpirv.data(), desc.vertexSpirv.size() * sizeof(uint32_t));
+            append(desc.fragmentSpirv.data(), desc.fragmentSpirv.size() * sizeof(uint32_t));
+            append(desc.bindings.data(), desc.bindings.size() * sizeof(VkVertexInputBindingDescription));
+            append(desc.attributes.data(), desc.attributes.size() * sizeof(VkVertexInputAttributeDescription));
+            endRecord(start);
+            entry.defined = true;
+        }
+        id = entry.id;
+    }
+    record(TraceOp::BindPipeline, id);
+}
+
+void CommandTraceWriter::setViewport(const VkViewport& viewport)
+{
+    if (_capturing)
+        record(TraceOp::SetViewport, viewport);
+}
+
+void CommandTraceWriter::setScissor(const VkRect2D& scissor)
+{
+    if (_capturing)
+        record(TraceOp::SetScissor, scissor);
+}
+
+void CommandTraceWriter::bindDescriptorSet(uint32_t index, VkDescriptorSet set, const uint32_t* dynamicOffsets, uint32_t dynamicOffsetCount)
+{
+    if (!_capturing)
+        return;
+    if (_frameData == nullptr || set != _frameData->descriptorSet() || dynamicOffsetCount > 2)
+    {
+        warnOnce(_warnedSet, "Trace: a descriptor set other than the frame allocator's was bound, it is not recorded");
+        return;
+    }
+
+    //only bytes written this frame are meaningful, placeholder offsets (like the unused storage binding) record nothing
+    const VkDeviceSize head = _frameData->headOffset();
+    const VkDeviceSize frameBegin = head - _frameData->usedBytes();
+    const uint32_t header[2] = { index, dynamicOffsetCount };
+    const size_t start = beginRecord(TraceOp::BindFrameData);
+    append(header, sizeof(header));
+    for (uint32_t i = 0; i < dynamicOffsetCount; ++i)
+    {
+        const VkDeviceSize offset = dynamicOffsets[i];
+        const uint32_t size = offset >= frameBegin && offset < head ?
+            static_cast<uint32_t>(std::min(_frameData->bindingRange(i), head - offset)) : 0;
+        append(&size, sizeof(size));
+        append(_frameData->mappedData() + offset, size);
+    }
+    endRecord(start);
+}
+
+void CommandTraceWriter::bindVertexBuffer(VkBuffer buffer, VkDeviceSize offset, uint32_t binding)
+{
+    if (_capturing)
+        record(TraceOp::BindVertexBuffer, TraceBindBuffer{ bufferId(buffer), binding, offset });
+}
+
+void CommandTraceWriter::bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType)
+{
+    if (_capturing)
+        record(TraceOp::BindIndexBuffer, TraceBindBuffer{ bufferId(buffer), static_cast<uint32_t>(indexType), offset });
+}
+
+void CommandTraceWriter::pushConstants(VkShaderStageFlags stages, const void* data, uint32_t size)
+{
+    if (!_capturing)
+        return;
+    const uint32_t header[2] = { stages, size };
+    const size_t start = beginRecord(TraceOp::PushConstants);
+    append(header, sizeof(header));
+    append(data, size);
+    endRecord(start);
+}
+
+void CommandTraceWriter::draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance)
+{
+    if (_capturing)
+        record(TraceOp::Draw, TraceDraw{ vertexCount, instanceCount, firstVertex, firstInstance });
+}
+
+void CommandTraceWriter::drawIndexed(uint32_t indexCount, uint32_t instanceCount, int32_t baseVertex)
+{
+    if (_capturing)
+        record(TraceOp::DrawIndexed, TraceDrawIndexed{ indexCount, instanceCount, baseVertex });
+}
+
+bool CommandTraceWriter::finish()
+{
+    if (_finished)
+        return true;
+    _finished = true;
+    _capturing = false;
+    if (_captured == 0)
+    {
+        std::cout << "Trace: no frame was captured, nothing written to " << _path << "\n";
+        return false;
+    }
+    _data.resize(_capturedBytes); //drops a frame cut short by shutdown
+    _header.frameCount = _captured;
+
+    std::ofstream file(_path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&_header), sizeof(_header));
+    file.write(reinterpret_cast<const char*>(_data.data()), static_cast<std::streamsize>(_data.size()));
+    if (!file)
+    {
+        std::cout << "Trace: cant write " << _path << "\n";
+        return false;
+    }
+    std::cout << "Trace: " << _captured << " frames, " << sizeof(_header) + _data.size() << " bytes written to " << _path << "\n";
+    _data = {};
+    return true;
+}
+
+void CommandTraceWriter::record(TraceOp op, const void* payload, uint32_t size)
+{
+    const size_t start = beginRecord(op);
+    append(payload, size);
+    endRecord(start);
+}
+
+size_t CommandTraceWriter::beginRecord(TraceOp op)
+{
+    const size_t start = _data.size();
+    const TraceRecordHeader header{ op, 0 };
+    append(&header, sizeof(header));
+    return start;
+}
+
+void CommandTraceWriter::append(const void* data, size_t size)
+{
+    if (size == 0)
+        return;
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    _data.insert(_data.end(), bytes, bytes + size);
+}
+
+void CommandTraceWriter::endRecord(size_t start)
+{
+    _data.resize((_data.size() + 3) & ~size_t(3));
+    const uint32_t size = static_cast<uint32_t>(_data.size() - start - sizeof(TraceRecordHeader));
+    std::memcpy(_data.data() + start + offsetof(TraceRecordHeader, size), &size, sizeof(size));
+}
+
+uint32_t CommandTraceWriter::bufferId(VkBuffer buffer)
+{
+    auto found = _buffers.find(buffer);
+    if (found == _buffers.end())
+    {
+        warnOnce(_warnedBuffer, "Trace: a buffer without contents was bound, replay skips the draws using it");
+        return UINT32_MAX;
+    }
+    Buffer& entry = found->second;
+    if (!entry.defined)
+    {
+        const uint64_t size = entry.size;
+        const size_t start = beginRecord(TraceOp::DefineBuffer);
+        append(&entry.id, sizeof(entry.id));
+        append(&size, sizeof(size));
+        append(entry.data, static_cast<size_t>(size));
+        endRecord(start);
+        entry.defined = true;
+    }
+    return entry.id;
+}
+
+void CommandTraceWriter::warnOnce(bool& warned, const char* message)
+{
+    if (!warned)
+        std::cout << message << "\n";
+    warned = true;
+}
+
+//reads front to back through a record's payload
+struct PayloadCursor
+{
+    const uint8_t* data;
+    uint32_t left;
+
+    const uint8_t* take(uint64_t size)
+    {
+        if (size > left)
+            return nullptr;
+        const uint8_t* taken = data;
+        data += size;
+        left -= static_cast<uint32_t>(size);
+        return taken;
+    }
+
+    template<typename T>
+    bool read(T* values, uint64_t count = 1)
+    {
+        const uint8_t* bytes = take(count * sizeof(T));
+        if (bytes != nullptr && count > 0)
+            std::memcpy(values, bytes, static_cast<size_t>(count * sizeof(T)));
+        return bytes != nullptr;
+    }
+};
+
+bool CommandTraceReader::load(const std::string& path)
+{
+    _records.clear();
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        std::cout << "Trace: cant open " << path << "\n";
+        return false;
+    }
+    _data.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(_data.data()), static_cast<std::streamsize>(_data.size()));
+    if (!file || _data.size() < sizeof(TraceFileHeader))
+    {
+        std::cout << "Trace: cant read " << path << "\n";
+        return false;
+    }
+    std::memcpy(&_header, _data.data(), sizeof(_header));
+    if (_header.magic != traceFileMagic || _header.version != traceFileVersion)
+    {
+        std::cout << "Trace: " << path << " is not a version " << traceFileVersion << " command trace\n";
+        return false;
+    }
+
+    size_t offset = sizeof(TraceFileHeader);
+    while (offset < _data.size())
+    {
+        TraceRecordHeader header;
+        if (_data.size() - offset < sizeof(header))
+            break;
+        std::memcpy(&header, _data.data() + offset, sizeof(header));
+        offset += sizeof(header);
+        if (_data.size() - offset < header.size)
+            break;
+        _records.push_back({ header.op, _data.data() + offset, header.size });
+        offset += header.size;
+    }
+    if (offset != _data.size())
+    {
+        std::cout << "Trace: " << path << " is cut short\n";
+        return false;
+    }
+    return true;
+}
+
+bool CommandTraceReader::readPipeline(const Record& record, uint32_t& id, TracePipelineDesc& desc)
+{
+    PayloadCursor cursor{ record.data, record.size };
+    uint32_t counts[5];
+    if (!cursor.read(counts, 5))
+        return false;
+    id = counts[0];
+    //counts come from the file, check them against the payload before allocating anything
+    const uint64_t bytes = (uint64_t(counts[1]) + counts[2]) * sizeof(uint32_t) + uint64_t(counts[3]) * sizeof(VkVertexInputBindingDescription) +
+        uint64_t(counts[4]) * sizeof(VkVertexInputAttributeDescription);
+    if (bytes > cursor.left)
+        return false;
+    desc.vertexSpirv.resize(counts[1]);
+    desc.fragmentSpirv.resize(counts[2]);
+    desc.bindings.resize(counts[3]);
+    desc.attributes.resize(counts[4]);
+    return cursor.read(desc.vertexSpirv.data(), counts[1]) && cursor.read(desc.fragmentSpirv.data(), counts[2]) &&
+        cursor.read(desc.bindings.data(), counts[3]) && cursor.read(desc.attributes.data(), counts[4]);
+}
+
+bool CommandTraceReader::readBuffer(const Record& record, uint32_t& id, const uint8_t*& contents, uint64_t& size)
+{
+    PayloadCursor cursor{ record.data, record.size };
+    if (!cursor.read(&id) || !cursor.read(&size))
+        return false;
+    contents = cursor.take(size);
+    return contents != nullptr;
+}
+
+bool CommandTraceReader::readFrameData(const Record& record, uint32_t& setIndex, uint32_t& bindingCount,
+    const uint8_t* (&bytes)[2], uint32_t (&sizes)[2])
+{
+    PayloadCursor cursor{ record.data, record.size };
+    if (!cursor.read(&setIndex) || !cursor.read(&bindingCount) || bindingCount > 2)
+        return false;
+    for (uint32_t i = 0; i < bindingCount; ++i)
+    {
+        if (!cursor.read(&sizes[i]))
+            return false;
+        bytes[i] = cursor.take(sizes[i]);
+        if (bytes[i] == nullptr)
+            return false;
+    }
+    return true;
+}
+
+bool CommandTraceReader::readPushConstants(const Record& record, VkShaderStageFlags& stages, const uint8_t*& bytes, uint32_t& size)
+{
+    PayloadCursor cursor{ record.data, record.size };
+    uint32_t header[2];
+    if (!cursor.read(header, 2))
+        return false;
+    stages = header[0];
+    size = header[1];
+    bytes = cursor.take(size);
+    return bytes != nullptr;
+}
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class FrameAllocator;
+
+//command stream capture for deterministic replay (tools/traceReplay.cpp), the MTLCaptureManager of the encoder layer
+//the trace holds what RenderCommandEncoder issued after state elision plus everything needed to issue it again on
+//another device: pipeline SPIR-V and vertex input, buffer contents and the frame allocator bytes behind dynamic offsets
+//resources are defined right before the first command that uses them, so a trace only holds what its frames reference
+
+constexpr uint32_t traceFileMagic = 0x5254564d; //"MVTR" little endian
+constexpr uint32_t traceFileVersion = 1;
+
+struct TraceFileHeader
+{
+    uint32_t magic = traceFileMagic;
+    uint32_t version = traceFileVersion;
+    uint32_t colorFormat = 0; //VkFormat of the captured color attachment
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t frameCount = 0;
+};
+
+//every record is a TraceRecordHeader followed by size payload bytes, payloads are padded to 4 bytes
+enum class TraceOp : uint32_t
+{
+    DefinePipeline,   //id, vertex words, fragment words, binding count, attribute count, then the arrays
+    DefineBuffer,     //id, size (uint64), contents
+    BeginFrame,
+    EndFrame,
+    BeginRenderPass,  //TraceBeginRenderPass
+    EndRenderPass,
+    BindPipeline,     //pipeline id, UINT32_MAX for pipelines the writer was not told about
+    SetViewport,      //VkViewport
+    SetScissor,       //VkRect2D
+    BindFrameData,    //set index, binding count, then per dynamic binding its byte count and bytes
+    BindVertexBuffer, //TraceBindBuffer
+    BindIndexBuffer,  //TraceBindBuffer
+    PushConstants,    //stages, size, bytes
+    Draw,             //TraceDraw
+    DrawIndexed,      //TraceDrawIndexed
+};
+
+struct TraceRecordHeader
+{
+    TraceOp op;
+    uint32_t size;
+};
+
+struct TraceBeginRenderPass
+{
+    VkRect2D renderArea;
+    VkClearValue clearColor;
+};
+
+struct TraceBindBuffer
+{
+    uint32_t buffer;
+    uint32_t slot; //vertex binding or VkIndexType
+    uint64_t offset;
+};
+
+struct TraceDraw
+{
+    uint32_t vertexCount;
+    uint32_t instanceCount;
+    uint32_t firstVertex;
+    uint32_t firstInstance;
+};
+
+struct TraceDrawIndexed
+{
+    uint32_t indexCount;
+    uint32_t instanceCount;
+    int32_t baseVertex;
+};
+
+//what the replayer needs to build a pipeline again; the layout is always createPipelineLayout over a FrameAllocator
+struct TracePipelineDesc
+{
+    std::vector<uint32_t> vertexSpirv;
+    std::vector<uint32_t> fragmentSpirv;
+    std::vector<VkVertexInputBindingDescription> bindings;
+    std::vector<VkVertexInputAttributeDescription> attributes;
+};
+
+//used from the recording thread only; records into memory and writes the file once the last frame ended
+class CommandTraceWriter
+{
+public:
+    //captures frameCount frames starting with the command buffer begun as frame firstFrame (counting from 0)
+    CommandTraceWriter(std::string path, VkFormat colorFormat, VkExtent2D extent, uint64_t firstFrame, uint32_t frameCount);
+    //writes what was captured if the application stopped early
+    ~CommandTraceWriter();
+
+    CommandTraceWriter(const CommandTraceWriter&) = delete;
+    CommandTraceWriter& operator=(const CommandTraceWriter&) = delete;
+
+    //pipelines and buffers commands may reference; contents are copied when first used in a captured frame,
+    //so data must stay valid until then
+    void addPipeline(VkPipeline pipeline, TracePipelineDesc desc);
+    void addBuffer(VkBuffer buffer, const void* data, VkDeviceSize size);
+    //descriptor set binds of the allocator's set are recorded with the bytes at their offsets, other sets are dropped
+    void setFrameData(const FrameAllocator* frameData) { _frameData = frameData; }
+
+    bool capturing() const { return _capturing; }
+    bool finished() const { return _finished; }
+    uint32_t capturedFrames() const { return _captured; }
+    const std::string& path() const { return _path; }
+
+    //called by CommandBuffer and RenderCommandEncoder, no-ops outside the captured frames
+    void beginFrame();
+    void endFrame();
+    void beginRenderPass(const VkRect2D& renderArea, const VkClearValue& clearColor);
+    void endRenderPass();
+    void bindPipeline(VkPipeline pipeline);
+    void setViewport(const VkViewport& viewport);
+    void setScissor(const VkRect2D& scissor);
+    void bindDescriptorSet(uint32_t index, VkDescriptorSet set, const uint32_t* dynamicOffsets, uint32_t dynamicOffsetCount);
+    void bindVertexBuffer(VkBuffer buffer, VkDeviceSize offset, uint32_t binding);
+    void bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType);
+    void pushConstants(VkShaderStageFlags stages, const void* data, uint32_t size);
+    void draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance);
+    void drawIndexed(uint32_t indexCount, uint32_t instanceCount, int32_t baseVertex);
+
+    //writes the file, false with a message on std::cout on failure; later calls do nothing
+    bool finish();
+
+private:
+    struct Pipeline
+    {
+        uint32_t id;
+        TracePipelineDesc desc;
+        bool defined = false;
+    };
+    struct Buffer
+    {
+        uint32_t id;
+        const void* data;
+        VkDeviceSize size;
+        bool defined = false;
+    };
+
+    template<typename T>
+    void record(TraceOp op, const T& payload) { record(op, &payload, sizeof(T)); }
+    void record(TraceOp op, const void* payload = nullptr, uint32_t size = 0);
+    //variable sized payloads: beginRecord, any number of append, endRecord patches the size and pads
+    size_t beginRecord(TraceOp op);
+    void append(const void* data, size_t size);
+    void endRecord(size_t start);
+    uint32_t bufferId(VkBuffer buffer);
+    void warnOnce(bool& warned, const char* message);
+
+    std::string _path;
+    TraceFileHeader _header;
+    uint64_t _firstFrame;
+    uint32_t _frameCount;
+    uint64_t _frame = 0; //command buffers begun so far
+    size_t _capturedBytes = 0; //end of the last complete frame in _data
+    uint32_t _captured = 0;
+    bool _capturing = false;
+    bool _finished = false;
+    const FrameAllocator* _frameData = nullptr;
+    std::unordered_map<VkPipeline, Pipeline> _pipelines;
+    std::unordered_map<VkBuffer, Buffer> _buffers;
+    uint32_t _nextId = 0;
+    bool _warnedPipeline = false;
+    bool _warnedBuffer = false;
+    bool _warnedSet = false;
+    std::vector<uint8_t> _data;
+};
+
+//whole trace in memory, records point into it
+class CommandTraceReader
+{
+public:
+    struct Record
+    {
+        TraceOp op;
+        const uint8_t* data;
+        uint32_t size;
+
+        //false if the payload is shorter than T
+        template<typename T>
+        bool read(T& value) const
+        {
+            if (size < sizeof(T))
+                return false;
+            std::memcpy(&value, data, sizeof(T));
+            return true;
+        }
+    };
+
+    //false with a message on std::cout if the file is missing, not a trace or cut short
+    bool load(const std::string& path);
+
+    const TraceFileHeader& header() const { return _header; }
+    const std::vector<Record>& records() const { return _records; }
+
+    //payload decoding for the variable sized records, false on malformed payloads
+    static bool readPipeline(const Record& record, uint32_t& id, TracePipelineDesc& desc);
+    static bool readBuffer(const Record& record, uint32_t& id, const uint8_t*& contents, uint64_t& size);
+    //bytes[i]/sizes[i] per dynamic binding, at most 2 like the FrameAllocator set layout
+    static bool readFrameData(const Record& record, uint32_t& setIndex, uint32_t& bindingCount, const uint8_t* (&bytes)[2], uint32_t (&sizes)[2]);
+    static bool readPushConstants(const Record& record, VkShaderStageFlags& stages, const uint8_t*& bytes, uint32_t& size);
+
+private:
+    TraceFileHeader _header;
+    std::vector<uint8_t> _data;
+    std::vector<Record> _records;
+};
@@ -0,0 +1,51 @@
+#include "deletionQueue.hpp"
+
+#include "queueTimeline.hpp"
+
+DeletionQueue::DeletionQueue(QueueTimeline& timeline)
+    : _timeline(timeline)
+{
+}
+
+DeletionQueue::~DeletionQueue()
+{
+    flush();
+}
+
+void DeletionQueue::retire(std::function<void()> destroy)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    //the timeline is read under the lock so values stay ordered even with several retiring threads
+    _entries.push_back({ _timeline.lastSubmitted(), std::move(destroy) });
+}
+
+size_t DeletionQueue::collect(size_t maxDestroys)
+{
+    size_t destroyed = 0;
+    while (destroyed < maxDestroys)
+    {
+        std::function<void()> destroy;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_entries.empty() || !_timeline.isComplete(_entries.front().value))
+                break;
+            destroy = std::move(_entries.front().destroy);
+            _entries.pop_front();
+        }
+        destroy(); //outside the lock, a destructor may retire further objects
+        ++destroyed;
+    }
+    return destroyed;
+}
+
+void DeletionQueue::flush()
+{
+    _timeline.waitIdle();
+    collect();
+}
+
+size_t DeletionQueue::pending() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _entries.size();
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+class QueueTimeline;
+
+//destroys objects once the GPU has passed the last graphics timeline value that may still use them
+//retire() tags the object with the value of the last submit so far, so anything released between frames
+//stays alive exactly until the frames already recorded with it finish; nothing ever waits for the whole device
+class DeletionQueue
+{
+public:
+    explicit DeletionQueue(QueueTimeline& timeline);
+    //waits for the timeline and destroys everything still queued
+    ~DeletionQueue();
+
+    DeletionQueue(const DeletionQueue&) = delete;
+    DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+    //any thread
+    void retire(std::function<void()> destroy);
+
+    //render thread, once per frame; destroys at most maxDestroys objects whose value the GPU passed, so a burst of
+    //releases is spread over several frames; returns the number destroyed
+    size_t collect(size_t maxDestroys = SIZE_MAX);
+
+    //waits for the timeline to finish and destroys everything
+    void flush();
+
+    size_t pending() const;
+
+private:
+    struct Entry
+    {
+        uint64_t value;
+        std::function<void()> destroy;
+    };
+
+    QueueTimeline& _timeline;
+    mutable std::mutex _mutex;
+    std::deque<Entry> _entries; //values never decrease, ready entries are at the front
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "deletionQueue.hpp"
+#include "memoryTelemetry.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <utility>
+#include <vector>
+
+//move-only owner of a VkDevice child; with a deletion queue the handle is retired there and destroyed once the GPU
+//finished every frame submitted before the release, without one it is destroyed right away (GPU must be done with it)
+template <typename T, auto Destroy>
+class DeviceHandle
+{
+public:
+    DeviceHandle() = default;
+    DeviceHandle(VkDevice device, T handle, DeletionQueue* deletionQueue = nullptr)
+        : _device(device), _handle(handle), _deletionQueue(deletionQueue)
+    {
+    }
+    ~DeviceHandle() { reset(); }
+
+    DeviceHandle(DeviceHandle&& other) noexcept
+        : _device(other._device), _handle(other.release()), _deletionQueue(other._deletionQueue)
+    {
+    }
+    DeviceHandle& operator=(DeviceHandle&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            _device = other._device;
+            _deletionQueue = other._deletionQueue;
+            _handle = other.release();
+        }
+        return *this;
+    }
+    DeviceHandle(const DeviceHandle&) = delete;
+    DeviceHandle& operator=(const DeviceHandle&) = delete;
+
+    T get() const { return _handle; }
+    operator T() const { return _handle; }
+    //for Vulkan structs that take arrays of handles
+    const T* address() const { return &_handle; }
+    explicit operator bool() const { return _handle != VK_NULL_HANDLE; }
+
+    //gives up ownership without destroying
+    T release() { return std::exchange(_handle, VK_NULL_HANDLE); }
+
+    //destroys (or retires) the current handle and takes ownership of handle; replacing at runtime never stalls
+    void reset(T handle = VK_NULL_HANDLE)
+    {
+        const T old = std::exchange(_handle, handle);
+        if (old == VK_NULL_HANDLE)
+            return;
+        if (_deletionQueue != nullptr)
+            _deletionQueue->retire([device = _device, old] { Destroy(device, old, nullptr); });
+        else
+            Destroy(_device, old, nullptr);
+    }
+
+private:
+    VkDevice _device = VK_NULL_HANDLE;
+    T _handle = VK_NULL_HANDLE;
+    DeletionQueue* _deletionQueue = nullptr;
+};
+
+//pipelines are counted by the memory telemetry
+inline void destroyPipeline(VkDevice device, VkPipeline pipeline, const VkAllocationCallbacks* allocator)
+{
+    vkDestroyPipeline(device, pipeline, allocator);
+    memoryTelemetry().pipelineDestroyed();
+}
+
+using SemaphoreHandle = DeviceHandle<VkSemaphore, vkDestroySemaphore>;
+using FenceHandle = DeviceHandle<VkFence, vkDestroyFence>;
+using CommandPoolHandle = DeviceHandle<VkCommandPool, vkDestroyCommandPool>;
+using BufferHandle = DeviceHandle<VkBuffer, vkDestroyBuffer>;
+using ImageHandle = DeviceHandle<VkImage, vkDestroyImage>;
+using ImageViewHandle = DeviceHandle<VkImageView, vkDestroyImageView>;
+using FramebufferHandle = DeviceHandle<VkFramebuffer, vkDestroyFramebuffer>;
+using RenderPassHandle = DeviceHandle<VkRenderPass, vkDestroyRenderPass>;
+using PipelineLayoutHandle = DeviceHandle<VkPipelineLayout, vkDestroyPipelineLayout>;
+using PipelineHandle = DeviceHandle<VkPipeline, destroyPipeline>;
+using SwapchainHandle = DeviceHandle<VkSwapchainKHR, vkDestroySwapchainKHR>;
+
+//takes ownership of every handle in handles
+template <typename Handle, typename T>
+std::vector<Handle> adoptHandles(VkDevice device, const std::vector<T>& handles, DeletionQueue* deletionQueue = nullptr)
+{
+    std::vector<Handle> owned;
+    owned.reserve(handles.size());
+    for (T handle : handles)
+        owned.emplace_back(device, handle, deletionQueue);
+    return owned;
+}
+
+//runs a cleanup at scope exit, for the objects that are not device children (window, instance, surface, device)
+template <typename F>
+class ScopeExit
+{
+public:
+    explicit ScopeExit(F cleanup) : _cleanup(std::move(cleanup)) {}
+    ~ScopeExit() { _cleanup(); }
+
+    ScopeExit(const ScopeExit&) = delete;
+    ScopeExit& operator=(const ScopeExit&) = delete;
+
+private:
+    F _cleanup;
+};
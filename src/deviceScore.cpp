@@ -0,0 +1,559 @@
+#include "deviceScore.hpp"
+
+#include "deviceHandle.hpp"
+#include "frameAllocator.hpp"
+#include "memoryHeap.hpp"
+#include "queueTimeline.hpp"
+#include "shaderInterface.hpp"
+#include "vulkanSetup.hpp"
+#include "vulkanUtils.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#ifdef EMBED_SHADERS
+#include <embeddedShaders.hpp> //generated at build time from src/shaders
+#endif
+
+//sized to take milliseconds on a GPU: big enough to keep it busy, small enough for a CPU implementation
+constexpr uint32_t fillExtent = 1024;
+constexpr uint32_t fillDraws = 16;
+constexpr float fillScale = 8.0f; //shader.vert's triangle scaled past every edge of the viewport
+constexpr uint32_t computeInvocations = 64 * 1024;
+constexpr uint32_t computeIterations = 512;
+constexpr uint32_t flopsPerIteration = 16; //two vec4 FMAs
+constexpr int timedSubmits = 3; //best of, after one warm up submit
+
+double DeviceScore::score() const
+{
+    return computeGflops > 0.0 ? std::sqrt(fillGpixels * computeGflops) : fillGpixels;
+}
+
+//SPIR-V of a shader in src/shaders, false if this build has none
+static bool loadSpirv(const char* source, const char* file, std::vector<uint32_t>& words)
+{
+#ifdef EMBED_SHADERS
+    (void)file;
+    const EmbeddedShader* embedded = findEmbeddedShader(source);
+    if (embedded == nullptr)
+        return false;
+    words.assign(embedded->code, embedded->code + embedded->size / sizeof(uint32_t));
+#else
+    (void)source;
+    std::ifstream spirv(std::string(SPIRV_FOLDER_LOCATION) + "/" + file, std::ios::ate | std::ios::binary);
+    if (!spirv.is_open())
+        return false;
+    words.resize(size_t(spirv.tellg()) / sizeof(uint32_t));
+    spirv.seekg(0);
+    if (!spirv.read(reinterpret_cast<char*>(words.data()), std::streamsize(words.size() * sizeof(uint32_t))))
+        return false;
+#endif
+    return !words.empty();
+}
+
+//temporary logical device with one graphics and compute queue, used by both tests
+class ScoreContext
+{
+public:
+    explicit ScoreContext(VkPhysicalDevice physicalDevice);
+    ~ScoreContext();
+
+    ScoreContext(const ScoreContext&) = delete;
+    ScoreContext& operator=(const ScoreContext&) = delete;
+
+    bool valid() const { return _cmd != VK_NULL_HANDLE; }
+    VkPhysicalDevice physicalDevice() const { return _physicalDevice; }
+    VkDevice device() const { return _device; }
+
+    //records, submits and waits timedSubmits + 1 times; the best GPU time in seconds (wall time without timestamps),
+    //negative on failure
+    double time(const std::function<void(VkCommandBuffer)>& record);
+
+private:
+    VkPhysicalDevice _physicalDevice;
+    VkDevice _device = VK_NULL_HANDLE;
+    std::unique_ptr<QueuePool> _queuePool;
+    std::unique_ptr<QueueTimeline> _timeline;
+    VkCommandPool _commandPool = VK_NULL_HANDLE;
+    VkCommandBuffer _cmd = VK_NULL_HANDLE;
+    VkQueryPool _queryPool = VK_NULL_HANDLE;
+    uint64_t _timestampMask = 0;
+    double _nsPerTick = 1.0;
+};
+
+ScoreContext::ScoreContext(VkPhysicalDevice physicalDevice)
+    : _physicalDevice(physicalDevice)
+{
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+    //every device with graphics has a family with both
+    QueueFamily queueFamily;
+    for (uint32_t i = 0; i < familyCount && queueFamily.graphics < 0; ++i)
+    {
+        if ((families[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) == (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))
+            queueFamily.graphics = int(i);
+    }
+    if (queueFamily.graphics < 0)
+    {
+        std::cout << "Device score: no queue family with graphics and compute\n";
+        return;
+    }
+
+    const QueuePlan plan = planQueues(physicalDevice, queueFamily); //one graphics queue, compute and transfer are unset
+    _device = tryCreateLogicalDevice(physicalDevice, plan);
+    if (_device == VK_NULL_HANDLE)
+    {
+        std::cout << "Device score: cant create logical device\n";
+        return;
+    }
+    _queuePool = std::make_unique<QueuePool>(_device, plan);
+    _timeline = std::make_unique<QueueTimeline>(_device, *_queuePool->acquire(queueFamily.graphics));
+    if (!_timeline->valid())
+    {
+        std::cout << "Device score: cant create timeline semaphore\n";
+        return;
+    }
+
+    const uint32_t timestampBits = families[queueFamily.graphics].timestampValidBits;
+    if (timestampBits > 0)
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        _timestampMask = timestampBits >= 64 ? ~0ull : (1ull << timestampBits) - 1;
+        _nsPerTick = properties.limits.timestampPeriod;
+        VkQueryPoolCreateInfo queryInfo{};
+        queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryInfo.queryCount = 2;
+        if (vkCreateQueryPool(_device, &queryInfo, nullptr, &_queryPool) != VK_SUCCESS)
+            _queryPool = VK_NULL_HANDLE;
+    }
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = _timeline->family();
+    if (vkCreateCommandPool(_device, &poolInfo, nullptr, &_commandPool) != VK_SUCCESS)
+    {
+        _commandPool = VK_NULL_HANDLE;
+        std::cout << "Device score: cant create command pool\n";
+        return;
+    }
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = _commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    if (vkAllocateCommandBuffers(_device, &allocInfo, &_cmd) != VK_SUCCESS)
+    {
+        _cmd = VK_NULL_HANDLE;
+        std::cout << "Device score: cant allocate command buffer\n";
+    }
+}
+
+ScoreContext::~ScoreContext()
+{
+    if (_device == VK_NULL_HANDLE)
+        return;
+    vkDeviceWaitIdle(_device);
+    if (_commandPool != VK_NULL_HANDLE)
+        vkDestroyCommandPool(_device, _commandPool, nullptr);
+    if (_queryPool != VK_NULL_HANDLE)
+        vkDestroyQueryPool(_device, _queryPool, nullptr);
+    _timeline.reset();
+    _queuePool.reset();
+    vkDestroyDevice(_device, nullptr);
+}
+
+double ScoreContext::time(const std::function<void(VkCommandBuffer)>& record)
+{
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    double best = -1.0;
+    for (int submit = 0; submit <= timedSubmits; ++submit)
+    {
+        vkResetCommandBuffer(_cmd, 0);
+        if (vkBeginCommandBuffer(_cmd, &beginInfo) != VK_SUCCESS)
+            return -1.0;
+        if (_queryPool != VK_NULL_HANDLE)
+        {
+            vkCmdResetQueryPool(_cmd, _queryPool, 0, 2);
+            vkCmdWriteTimestamp(_cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _queryPool, 0);
+        }
+        record(_cmd);
+        if (_queryPool != VK_NULL_HANDLE)
+            vkCmdWriteTimestamp(_cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _queryPool, 1);
+        if (vkEndCommandBuffer(_cmd) != VK_SUCCESS)
+            return -1.0;
+
+        const auto start = std::chrono::steady_clock::now();
+        const uint64_t value = _timeline->submit(&_cmd, 1);
+        if (value == 0 || !_timeline->wait(value))
+            return -1.0;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        uint64_t timestamps[2];
+        if (_queryPool != VK_NULL_HANDLE && vkGetQueryPoolResults(_device, _queryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+                VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) == VK_SUCCESS && timestamps[1] != timestamps[0])
+            seconds = double((timestamps[1] - timestamps[0]) & _timestampMask) * _nsPerTick / 1e9;
+        if (submit > 0 && (best < 0.0 || seconds < best))
+            best = seconds;
+    }
+    return best;
+}
+
+//gigapixels per second of shader.vert/shader.frag drawn full screen with blending, like the renderer draws
+static double measureFill(ScoreContext& context)
+{
+    const VkDevice device = context.device();
+    std::vector<uint32_t> vertexSpirv, fragmentSpirv;
+    if (!loadSpirv("shader.vert", "vert.spv", vertexSpirv) || !loadSpirv("shader.frag", "frag.spv", fragmentSpirv))
+    {
+        std::cout << "Device score: no SPIR-V for shader.vert/shader.frag\n";
+        return -1.0;
+    }
+
+    const VkFormat format = VK_FORMAT_R8G8B8A8_UNORM; //color attachment and blending support are required for it
+    FrameAllocator frameData(context.physicalDevice(), device, 1, 64 * 1024);
+    if (!frameData.valid())
+        return -1.0;
+    PipelineLayoutHandle pipelineLayout(device, tryCreatePipelineLayout(device, frameData.setLayout()));
+    RenderPassHandle renderPass(device, tryCreateRenderPass(device, format, false, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL));
+    if (!pipelineLayout || !renderPass)
+        return -1.0;
+
+    TransientImages target(context.physicalDevice(), device);
+    TransientImages::Desc desc;
+    desc.info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    desc.info.imageType = VK_IMAGE_TYPE_2D;
+    desc.info.format = format;
+    desc.info.extent = { fillExtent, fillExtent, 1 };
+    desc.info.mipLevels = 1;
+    desc.info.arrayLayers = 1;
+    desc.info.samples = VK_SAMPLE_COUNT_1_BIT;
+    desc.info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    desc.info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    desc.info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    const uint32_t targetId = target.add(desc);
+    if (!target.build())
+    {
+        std::cout << "Device score: cant create the fill target\n";
+        return -1.0;
+    }
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = target.image(targetId);
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    VkImageView view;
+    if (vkCreateImageView(device, &viewInfo, nullptr, &view) != VK_SUCCESS)
+        return -1.0;
+    ImageViewHandle viewHandle(device, view);
+    const VkExtent2D extent{ fillExtent, fillExtent };
+    FramebufferHandle framebuffer(device, tryCreateFramebuffer(device, renderPass, view, extent));
+    if (!framebuffer)
+        return -1.0;
+
+    VkShaderModule vertex = tryCreateShader(device, vertexSpirv.data(), vertexSpirv.size() * sizeof(uint32_t));
+    VkShaderModule fragment = tryCreateShader(device, fragmentSpirv.data(), fragmentSpirv.size() * sizeof(uint32_t));
+    PipelineHandle pipeline(device, vertex != VK_NULL_HANDLE && fragment != VK_NULL_HANDLE ?
+        createGraphicsPipeline(device, renderPass, pipelineLayout, vertex, fragment) : VK_NULL_HANDLE);
+    vkDestroyShaderModule(device, vertex, nullptr);
+    vkDestroyShaderModule(device, fragment, nullptr);
+    if (!pipeline)
+        return -1.0;
+
+    const VkViewport viewport{ 0.0f, 0.0f, float(fillExtent), float(fillExtent), 0.0f, 1.0f };
+    const VkRect2D area{ { 0, 0 }, extent };
+    FrameUniforms uniforms;
+    uniforms.tint[3] = 0.5f; //blended, every pixel reads the target
+    DrawPushConstants draw;
+    draw.scale = fillScale;
+    const double seconds = context.time([&](VkCommandBuffer cmd) {
+        frameData.beginFrame(0);
+        uint32_t offsets[2] = { 0, 0 };
+        frameData.push(uniforms, offsets[0]);
+        VkClearValue clear{};
+        VkRenderPassBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        beginInfo.renderPass = renderPass;
+        beginInfo.framebuffer = framebuffer;
+        beginInfo.renderArea = area;
+        beginInfo.clearValueCount = 1;
+        beginInfo.pClearValues = &clear;
+        vkCmdBeginRenderPass(cmd, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        vkCmdSetViewport(cmd, 0, 1, &viewport);
+        vkCmdSetScissor(cmd, 0, 1, &area);
+        const VkDescriptorSet set = frameData.descriptorSet();
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &set, 2, offsets);
+        vkCmdPushConstants(cmd, pipelineLayout, drawPushConstantStages, 0, sizeof(draw), &draw);
+        vkCmdDraw(cmd, 3, fillDraws, 0, 0);
+        vkCmdEndRenderPass(cmd);
+    });
+    vkDeviceWaitIdle(device);
+    if (seconds <= 0.0)
+        return -1.0;
+    return double(fillDraws) * fillExtent * fillExtent / seconds / 1e9;
+}
+
+//GFLOPS of score.comp, 0 if the build has no SPIR-V for it
+static double measureCompute(ScoreContext& context)
+{
+    const VkDevice device = context.device();
+    std::vector<uint32_t> spirv;
+    if (!loadSpirv("score.comp", "score.comp.spv", spirv))
+        return 0.0;
+
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    const VkDeviceSize size = VkDeviceSize(computeInvocations) * 16;
+    if (!createBuffer(context.physicalDevice(), device, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, memory))
+        return -1.0;
+    BufferHandle bufferHandle(device, buffer);
+    ScopeExit memoryGuard([device, memory] { memoryTelemetry().free(device, memory); });
+
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &binding;
+    VkDescriptorSetLayout setLayout;
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS)
+        return -1.0;
+    ScopeExit setLayoutGuard([device, setLayout] { vkDestroyDescriptorSetLayout(device, setLayout, nullptr); });
+
+    const VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 };
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    VkDescriptorPool pool;
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+        return -1.0;
+    ScopeExit poolGuard([device, pool] { vkDestroyDescriptorPool(device, pool, nullptr); });
+    VkDescriptorSetAllocateInfo setInfo{};
+    setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setInfo.descriptorPool = pool;
+    setInfo.descriptorSetCount = 1;
+    setInfo.pSetLayouts = &setLayout;
+    VkDescriptorSet set;
+    if (vkAllocateDescriptorSets(device, &setInfo, &set) != VK_SUCCESS)
+        return -1.0;
+    const VkDescriptorBufferInfo bufferInfo{ buffer, 0, size };
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set;
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+    const VkPushConstantRange pushRange{ VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t) };
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+    VkPipelineLayout pipelineLayout;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+        return -1.0;
+    PipelineLayoutHandle pipelineLayoutHandle(device, pipelineLayout);
+
+    VkShaderModule shader = tryCreateShader(device, spirv.data(), spirv.size() * sizeof(uint32_t));
+    if (shader == VK_NULL_HANDLE)
+        return -1.0;
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shader;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = pipelineLayout;
+    VkPipeline pipeline;
+    const VkResult created = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+    vkDestroyShaderModule(device, shader, nullptr);
+    if (created != VK_SUCCESS)
+        return -1.0;
+    memoryTelemetry().pipelineCreated();
+    PipelineHandle pipelineHandle(device, pipeline);
+
+    const double seconds = context.time([&](VkCommandBuffer cmd) {
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &set, 0, nullptr);
+        vkCmdPushConstants(cmd, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(computeIterations), &computeIterations);
+        vkCmdDispatch(cmd, computeInvocations / 64, 1, 1);
+    });
+    vkDeviceWaitIdle(device);
+    if (seconds <= 0.0)
+        return -1.0;
+    return double(computeInvocations) * computeIterations * flopsPerIteration / seconds / 1e9;
+}
+
+bool benchmarkPhysicalDevice(VkPhysicalDevice physicalDevice, DeviceScore& score)
+{
+    ScoreContext context(physicalDevice);
+    if (!context.valid())
+        return false;
+    score.fillGpixels = measureFill(context);
+    score.computeGflops = measureCompute(context);
+    if (score.fillGpixels <= 0.0 || score.computeGflops < 0.0)
+    {
+        std::cout << "Device score: a microbenchmark failed to run\n";
+        return false;
+    }
+    return true;
+}
+
+DeviceScoreCache::DeviceScoreCache(std::string path)
+    : _path(std::move(path))
+{
+    std::ifstream file(_path);
+    std::string line;
+    while (std::getline(file, line))
+    {//<uuid>-<driver version> <fill> <compute> <name>
+        std::istringstream fields(line);
+        std::string key;
+        DeviceScore score;
+        if (!(fields >> key >> score.fillGpixels >> score.computeGflops))
+            continue;
+        std::string name;
+        std::getline(fields >> std::ws, name);
+        _scores[key] = score;
+        _names[key] = name;
+    }
+}
+
+std::string DeviceScoreCache::key(VkPhysicalDevice physicalDevice)
+{
+    VkPhysicalDeviceIDProperties idProperties{};
+    idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &idProperties;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+    std::ostringstream key;
+    key << std::hex << std::setfill('0');
+    for (uint8_t byte : idProperties.deviceUUID)
+        key << std::setw(2) << uint32_t(byte);
+    key << '-' << properties.properties.driverVersion;
+    return key.str();
+}
+
+bool DeviceScoreCache::find(VkPhysicalDevice physicalDevice, DeviceScore& score) const
+{
+    auto found = _scores.find(key(physicalDevice));
+    if (found == _scores.end())
+        return false;
+    score = found->second;
+    return true;
+}
+
+void DeviceScoreCache::store(VkPhysicalDevice physicalDevice, const DeviceScore& score)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    const std::string deviceKey = key(physicalDevice);
+    _scores[deviceKey] = score;
+    _names[deviceKey] = properties.deviceName;
+}
+
+bool DeviceScoreCache::save() const
+{
+    std::error_code error;
+    const std::filesystem::path folder = std::filesystem::path(_path).parent_path();
+    if (!folder.empty())
+        std::filesystem::create_directories(folder, error);
+    std::ofstream file(_path);
+    for (const auto& [deviceKey, score] : _scores)
+        file << deviceKey << ' ' << score.fillGpixels << ' ' << score.computeGflops << ' ' << _names.at(deviceKey) << '\n';
+    if (!file)
+    {
+        std::cout << "Device score: cant write " << _path << "\n";
+        return false;
+    }
+    return true;
+}
+
+std::string defaultDeviceScoreCachePath()
+{
+    const char* fileName = "MetalOverVulkan/deviceScores.txt";
+#ifdef _WIN32
+    if (const char* localAppData = std::getenv("LOCALAPPDATA"))
+        return std::string(localAppData) + "/" + fileName;
+#else
+    if (const char* cacheHome = std::getenv("XDG_CACHE_HOME"); cacheHome != nullptr && cacheHome[0] != '\0')
+        return std::string(cacheHome) + "/" + fileName;
+    if (const char* home = std::getenv("HOME"))
+        return std::string(home) + "/.cache/" + fileName;
+#endif
+    return "deviceScores.txt";
+}
+
+VkPhysicalDevice pickPhysicalDeviceByBenchmark(VkInstance instance, const VkSurfaceKHR& surface, DeviceScoreCache& cache)
+{
+    const std::vector<VkPhysicalDevice> candidates = suitablePhysicalDevices(instance, surface);
+    if (candidates.size() <= 1)
+        return candidates.empty() ? VK_NULL_HANDLE : candidates[0]; //nothing to choose from
+
+    VkPhysicalDevice best = VK_NULL_HANDLE;
+    double bestScore = 0.0;
+    bool measured = false;
+    for (VkPhysicalDevice candidate : candidates)
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(candidate, &properties);
+        DeviceScore score;
+        const bool cached = cache.find(candidate, score);
+        if (!cached)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            if (!benchmarkPhysicalDevice(candidate, score))
+            {
+                std::cout << "Device " << properties.deviceName << " skipped\n";
+                continue;
+            }
+            cache.store(candidate, score);
+            measured = true;
+            std::cout << "Device " << properties.deviceName << " measured in "
+                << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms\n";
+        }
+        std::cout << "Device " << properties.deviceName << (properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU ? " (CPU)" : "")
+            << ": fill " << score.fillGpixels << " Gpixel/s, compute " << score.computeGflops << " GFLOPS, score " << score.score()
+            << (cached ? " (cached)" : "") << "\n";
+        if (score.score() > bestScore)
+        {
+            bestScore = score.score();
+            best = candidate;
+        }
+    }
+    if (measured)
+        cache.save();
+    if (best == VK_NULL_HANDLE)
+    {//every candidate failed to run the tests, they can still render
+        std::cout << "No device finished the microbenchmarks, using the static ranking\n";
+        return pickPhysicalDevice(instance, surface);
+    }
+    return best;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <map>
+#include <string>
+
+//measured device ranking: a blended fill rate and an FMA compute microbenchmark per candidate, on a temporary device
+//the static ranking in pickPhysicalDevice guesses from heap sizes, this one finds the fastest usable device on
+//multi GPU hosts and lets a CPU implementation compete on hosts without a GPU
+
+struct DeviceScore
+{
+    double fillGpixels = 0.0;   //full screen triangles blended into RGBA8, gigapixels per second
+    double computeGflops = 0.0; //0 when score.comp has no SPIR-V in this build
+
+    //geometric mean of what was measured, only comparable between scores measuring the same tests
+    double score() const;
+};
+
+//runs both tests, a few tens of milliseconds on a GPU and a few hundred on a CPU implementation
+//false with a message on std::cout if the device cant run them
+bool benchmarkPhysicalDevice(VkPhysicalDevice physicalDevice, DeviceScore& score);
+
+//scores by device UUID and driver version, a driver update measures again; a text file with one device per line
+class DeviceScoreCache
+{
+public:
+    //reads path if it exists
+    explicit DeviceScoreCache(std::string path);
+
+    bool find(VkPhysicalDevice physicalDevice, DeviceScore& score) const;
+    void store(VkPhysicalDevice physicalDevice, const DeviceScore& score);
+    //false with a message on std::cout if the file cant be written
+    bool save() const;
+
+    const std::string& path() const { return _path; }
+
+private:
+    static std::string key(VkPhysicalDevice physicalDevice);
+
+    std::string _path;
+    std::map<std::string, DeviceScore> _scores;
+    std::map<std::string, std::string> _names; //only for people reading the file
+};
+
+//deviceScores.txt in the user's cache directory (LOCALAPPDATA, XDG_CACHE_HOME or ~/.cache), the working directory otherwise
+std::string defaultDeviceScoreCachePath();
+
+//highest score of suitablePhysicalDevices(), measuring the devices the cache does not know yet; a single suitable device
+//is returned without measuring; VK_NULL_HANDLE if no device is suitable
+VkPhysicalDevice pickPhysicalDeviceByBenchmark(VkInstance instance, const VkSurfaceKHR& surface, DeviceScoreCache& cache);
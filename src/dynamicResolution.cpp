@@ -0,0 +1,317 @@
+#include "dynamicResolution.hpp"
+
+#include "memoryTelemetry.hpp"
+#include "vulkanUtils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+//smoothing of the GPU time samples, one slow frame moves the filtered value by this fraction of the difference
+constexpr double sampleWeight = 0.2;
+//no change while the filtered time is within this band under the target
+constexpr double deadBandLow = 0.85;
+//largest step per frame, down and up
+constexpr float maxDrop = 0.10f;
+constexpr float maxRise = 0.03f;
+}
+
+ResolutionController::ResolutionController(double targetMs, float minScale, float maxScale)
+    : _targetMs(targetMs), _minScale(minScale), _maxScale(std::max(minScale, maxScale)), _scale(_maxScale)
+{
+}
+
+float ResolutionController::update(double gpuMs)
+{
+    _filteredMs = _primed ? _filteredMs + sampleWeight * (gpuMs - _filteredMs) : gpuMs;
+    _primed = true;
+    if (_filteredMs <= 0.0 || _targetMs <= 0.0)
+        return _scale;
+    if (_filteredMs <= _targetMs && _filteredMs >= _targetMs * deadBandLow)
+        return _scale;
+
+    //aim for the middle of the band so noise does not push it straight back out
+    const double aim = _targetMs * (1.0 + deadBandLow) * 0.5;
+    float next = _scale * static_cast<float>(std::sqrt(aim / _filteredMs));
+    next = std::clamp(next, _scale * (1.0f - maxDrop), _scale * (1.0f + maxRise));
+    next = std::clamp(next, _minScale, _maxScale);
+    if (next != _scale)
+    {//the samples in flight were rendered at the old scale, predict what they would be at the new one
+        _filteredMs *= double(next) * next / (double(_scale) * _scale);
+        _scale = next;
+    }
+    return _scale;
+}
+
+DynamicResolution::DynamicResolution(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, VkExtent2D extent,
+    VkFormat format, uint32_t framesInFlight, const ResolutionController& controller)
+    : _device(device), _extent(extent), _format(format), _controller(controller), _renderExtent(extent), _written(framesInFlight, false)
+{
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+    const VkFormatFeatureFlags features = formatProperties.optimalTilingFeatures;
+    const VkFormatFeatureFlags needed = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+    if ((features & needed) != needed)
+    {
+        std::cout << "Dynamic resolution disabled, format " << format << " cant be blitted\n";
+        return;
+    }
+    if (!(features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
+        _filter = VK_FILTER_NEAREST;
+
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+    const uint32_t validBits = queueFamily < familyCount ? families[queueFamily].timestampValidBits : 0;
+    if (validBits == 0)
+    {
+        std::cout << "Dynamic resolution disabled, queue family " << queueFamily << " has no timestamps\n";
+        return;
+    }
+    _timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    _nsPerTick = properties.limits.timestampPeriod;
+
+    VkQueryPoolCreateInfo queryInfo{};
+    queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryInfo.queryCount = 2 * framesInFlight;
+    if (vkCreateQueryPool(_device, &queryInfo, nullptr, &_queryPool) != VK_SUCCESS)
+    {
+        std::cout << "Dynamic resolution disabled, cant create the timestamp query pool\n";
+        _queryPool = VK_NULL_HANDLE;
+        return;
+    }
+
+    if (!createTarget(physicalDevice))
+    {
+        std::cout << "Dynamic resolution disabled, cant create the offscreen target\n";
+        destroy();
+        return;
+    }
+    updateExtent();
+}
+
+DynamicResolution::~DynamicResolution()
+{
+    destroy();
+}
+
+bool DynamicResolution::createTarget(VkPhysicalDevice physicalDevice)
+{
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = _format;
+    imageInfo.extent = { _extent.width, _extent.height, 1 };
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (vkCreateImage(_device, &imageInfo, nullptr, &_image) != VK_SUCCESS)
+    {
+        _image = VK_NULL_HANDLE;
+        return false;
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(_device, _image, &requirements);
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (allocInfo.memoryTypeIndex == UINT32_MAX ||
+        memoryTelemetry().allocate(_device, allocInfo, MemoryCategory::Image, _memory) != VK_SUCCESS)
+    {
+        _memory = VK_NULL_HANDLE;
+        return false;
+    }
+    if (vkBindImageMemory(_device, _image, _memory, 0) != VK_SUCCESS)
+        return false;
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = _image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = _format;
+    viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    if (vkCreateImageView(_device, &viewInfo, nullptr, &_view) != VK_SUCCESS)
+    {
+        _view = VK_NULL_HANDLE;
+        return false;
+    }
+
+    //same attachment as the swapchain pass apart from the final layout, the blit reads it right after
+    VkAttachmentDescription colorAttachment{};
+    colorAttachment.format = _format;
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    VkAttachmentReference colorAttachmentRef{};
+    colorAttachmentRef.attachment = 0;
+    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorAttachmentRef;
+
+    VkSubpassDependency dependencies[2]{};
+    //the previous frame's blit read is waited for by the barrier in beginScene, this chains onto it
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[0].srcAccessMask = 0;
+    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    //rendered pixels visible to the blit
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &colorAttachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = 2;
+    renderPassInfo.pDependencies = dependencies;
+    if (vkCreateRenderPass(_device, &renderPassInfo, nullptr, &_renderPass) != VK_SUCCESS)
+    {
+        _renderPass = VK_NULL_HANDLE;
+        return false;
+    }
+
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = _renderPass;
+    framebufferInfo.attachmentCount = 1;
+    framebufferInfo.pAttachments = &_view;
+    framebufferInfo.width = _extent.width;
+    framebufferInfo.height = _extent.height;
+    framebufferInfo.layers = 1;
+    if (vkCreateFramebuffer(_device, &framebufferInfo, nullptr, &_framebuffer) != VK_SUCCESS)
+    {
+        _framebuffer = VK_NULL_HANDLE;
+        return false;
+    }
+    return true;
+}
+
+void DynamicResolution::updateExtent()
+{
+    const float scale = _controller.scale();
+    _renderExtent.width = std::clamp(static_cast<uint32_t>(std::lround(_extent.width * scale)), 1u, _extent.width);
+    _renderExtent.height = std::clamp(static_cast<uint32_t>(std::lround(_extent.height * scale)), 1u, _extent.height);
+}
+
+void DynamicResolution::beginFrame(uint32_t slot)
+{
+    if (!valid() || slot >= _written.size() || !_written[slot])
+        return;
+
+    uint64_t timestamps[2];
+    const VkResult result = vkGetQueryPoolResults(_device, _queryPool, 2 * slot, 2, sizeof(timestamps), timestamps,
+        sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    _written[slot] = false;
+    if (result != VK_SUCCESS)
+        return; //not available, skip the sample rather than wait
+
+    const double gpuMs = double((timestamps[1] - timestamps[0]) & _timestampMask) * _nsPerTick / 1e6;
+    _stats.samples++;
+    _stats.gpuMsTotal += gpuMs;
+    _stats.scaleTotal += _controller.scale();
+    _stats.lowestScale = std::min(_stats.lowestScale, _controller.scale());
+    _controller.update(gpuMs);
+    updateExtent();
+}
+
+void DynamicResolution::beginScene(VkCommandBuffer cmd, uint32_t slot)
+{
+    if (!valid())
+        return;
+    vkCmdResetQueryPool(cmd, _queryPool, 2 * slot, 2);
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _queryPool, 2 * slot);
+
+    //the target is shared by the frames in flight: the previous frame's blit must be done reading before the clear
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0,
+        0, nullptr, 0, nullptr, 0, nullptr);
+}
+
+void DynamicResolution::upscale(VkCommandBuffer cmd, uint32_t slot, VkImage swapchainImage)
+{
+    if (!valid())
+        return;
+    //scene time only, the blit costs the same at any scale
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _queryPool, 2 * slot + 1);
+    _written[slot] = true;
+
+    VkImageMemoryBarrier toTransfer{};
+    toTransfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    toTransfer.srcAccessMask = 0;
+    toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toTransfer.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED; //every pixel is overwritten
+    toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.image = swapchainImage;
+    toTransfer.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    //chains onto the acquire semaphore wait at the transfer stage
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        0, nullptr, 0, nullptr, 1, &toTransfer);
+
+    VkImageBlit region{};
+    region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.srcOffsets[1] = { static_cast<int32_t>(_renderExtent.width), static_cast<int32_t>(_renderExtent.height), 1 };
+    region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.dstOffsets[1] = { static_cast<int32_t>(_extent.width), static_cast<int32_t>(_extent.height), 1 };
+    vkCmdBlitImage(cmd, _image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, swapchainImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        1, &region, _filter);
+
+    //the color output stage lets later users that expect a render pass write (frame capture) chain onto the blit
+    VkImageMemoryBarrier toPresent = toTransfer;
+    toPresent.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toPresent.dstAccessMask = 0;
+    toPresent.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    toPresent.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0,
+        0, nullptr, 0, nullptr, 1, &toPresent);
+}
+
+void DynamicResolution::destroy()
+{
+    if (_framebuffer != VK_NULL_HANDLE)
+        vkDestroyFramebuffer(_device, _framebuffer, nullptr);
+    if (_renderPass != VK_NULL_HANDLE)
+        vkDestroyRenderPass(_device, _renderPass, nullptr);
+    if (_view != VK_NULL_HANDLE)
+        vkDestroyImageView(_device, _view, nullptr);
+    if (_image != VK_NULL_HANDLE)
+        vkDestroyImage(_device, _image, nullptr);
+    memoryTelemetry().free(_device, _memory);
+    if (_queryPool != VK_NULL_HANDLE)
+        vkDestroyQueryPool(_device, _queryPool, nullptr);
+    _framebuffer = VK_NULL_HANDLE;
+    _renderPass = VK_NULL_HANDLE;
+    _view = VK_NULL_HANDLE;
+    _image = VK_NULL_HANDLE;
+    _memory = VK_NULL_HANDLE;
+    _queryPool = VK_NULL_HANDLE;
+}
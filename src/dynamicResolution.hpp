@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+//picks the render scale from measured GPU frame times so the scene pass holds a target duration
+//GPU time follows the pixel count, so the scale moves with the square root of target / measured;
+//samples are smoothed, a dead band keeps it from hunting around the target and each step is rate limited
+//(drops fast when over budget, climbs slowly back) because the measurement lags by the frames in flight
+class ResolutionController
+{
+public:
+    ResolutionController(double targetMs, float minScale = 0.5f, float maxScale = 1.0f);
+
+    //one GPU time sample of a finished frame, returns the scale for the next frame
+    float update(double gpuMs);
+
+    float scale() const { return _scale; }
+    double targetMs() const { return _targetMs; }
+    double filteredMs() const { return _filteredMs; }
+
+private:
+    double _targetMs;
+    float _minScale;
+    float _maxScale;
+    float _scale;
+    double _filteredMs = 0.0;
+    bool _primed = false;
+};
+
+//offscreen color target the scene renders into at a fraction of the swapchain extent, upscaled into the swapchain
+//image with a filtered blit; the target is allocated once at full size and only the rendered area changes, so scale
+//changes never reallocate; the scene time comes from a pair of timestamps per frame slot around the scene pass
+class DynamicResolution
+{
+public:
+    struct Stats
+    {
+        uint64_t samples = 0;
+        double gpuMsTotal = 0.0;
+        double scaleTotal = 0.0;
+        float lowestScale = 1.0f;
+    };
+
+    //swapchain images must be created with VK_IMAGE_USAGE_TRANSFER_DST_BIT
+    DynamicResolution(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, VkExtent2D extent, VkFormat format,
+        uint32_t framesInFlight, const ResolutionController& controller);
+    ~DynamicResolution();
+
+    DynamicResolution(const DynamicResolution&) = delete;
+    DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+    //false if the format cant be blitted, the queue has no timestamps or allocation failed; nothing else works then
+    bool valid() const { return _framebuffer != VK_NULL_HANDLE; }
+
+    //compatible with the swapchain render pass, pipelines built for one work in the other
+    VkRenderPass renderPass() const { return _renderPass; }
+    VkFramebuffer framebuffer() const { return _framebuffer; }
+
+    //area of the target the scene covers this frame, from the origin
+    VkExtent2D renderExtent() const { return _renderExtent; }
+    float scale() const { return _controller.scale(); }
+    const ResolutionController& controller() const { return _controller; }
+    const Stats& stats() const { return _stats; }
+
+    //once the GPU finished the last frame recorded in slot: reads its timestamps and moves the scale
+    void beginFrame(uint32_t slot);
+    //before the scene render pass
+    void beginScene(VkCommandBuffer cmd, uint32_t slot);
+    //after the scene render pass: blits the rendered area over the whole swapchain image and leaves it in PRESENT_SRC;
+    //the acquire semaphore only has to be waited for at VK_PIPELINE_STAGE_TRANSFER_BIT, the scene does not touch the image
+    void upscale(VkCommandBuffer cmd, uint32_t slot, VkImage swapchainImage);
+
+    //device must be idle
+    void destroy();
+
+private:
+    bool createTarget(VkPhysicalDevice physicalDevice);
+    void updateExtent();
+
+    VkDevice _device;
+    VkExtent2D _extent;
+    VkFormat _format;
+    ResolutionController _controller;
+    VkExtent2D _renderExtent;
+    VkFilter _filter = VK_FILTER_LINEAR;
+
+    VkImage _image = VK_NULL_HANDLE;
+    VkDeviceMemory _memory = VK_NULL_HANDLE;
+    VkImageView _view = VK_NULL_HANDLE;
+    VkRenderPass _renderPass = VK_NULL_HANDLE;
+    VkFramebuffer _framebuffer = VK_NULL_HANDLE;
+
+    VkQueryPool _queryPool = VK_NULL_HANDLE;
+    double _nsPerTick = 1.0;
+    uint64_t _timestampMask = ~0ull;
+    std::vector<bool> _written; //per slot, reading queries that were never written is not allowed
+    Stats _stats;
+};
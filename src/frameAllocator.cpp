@@ -0,0 +1,136 @@
+#include "frameAllocator.hpp"
+
+#include "vulkanUtils.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+FrameAllocator::FrameAllocator(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t framesInFlight, VkDeviceSize bytesPerFrame,
+    VkDeviceSize uniformRange, VkDeviceSize storageRange)
+    : _device(device), _framesInFlight(framesInFlight)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    const VkPhysicalDeviceLimits& limits = properties.limits;
+
+    //both alignments are powers of two, one alignment keeps every allocation usable from either binding
+    _alignment = std::max<VkDeviceSize>({ limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment, 16 });
+    uniformRange = std::min<VkDeviceSize>(uniformRange, limits.maxUniformBufferRange);
+    storageRange = std::min<VkDeviceSize>(storageRange, limits.maxStorageBufferRange);
+    _ranges[0] = uniformRange;
+    _ranges[1] = storageRange;
+    _frameSize = (bytesPerFrame + _alignment - 1) & ~(_alignment - 1);
+
+    //the tail keeps offset + range inside the buffer for allocations at the very end of the last region
+    const VkDeviceSize size = _frameSize * framesInFlight + std::max(uniformRange, storageRange);
+    const VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    //device local + host visible (resizable BAR / UMA) saves the GPU from reading over PCIe, plain host memory otherwise
+    if (!createBuffer(physicalDevice, _device, size, usage,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _buffer, _memory) &&
+        !createBuffer(physicalDevice, _device, size, usage,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _buffer, _memory))
+    {
+        std::cout << "Frame allocator: cant allocate " << size << " bytes\n";
+        return;
+    }
+
+    void* mapped;
+    if (vkMapMemory(_device, _memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+    {
+        std::cout << "Frame allocator: cant map memory\n";
+        return;
+    }
+    _mapped = static_cast<uint8_t*>(mapped);
+
+    VkDescriptorSetLayoutBinding bindings[2]{};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[1] = bindings[0];
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = bindings;
+    if (vkCreateDescriptorSetLayout(_device, &layoutInfo, nullptr, &_setLayout) != VK_SUCCESS)
+    {
+        std::cout << "Frame allocator: cant create descriptor set layout\n";
+        return;
+    }
+
+    VkDescriptorPoolSize poolSizes[2] = { { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 }, { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1 } };
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+    if (vkCreateDescriptorPool(_device, &poolInfo, nullptr, &_pool) != VK_SUCCESS)
+    {
+        std::cout << "Frame allocator: cant create descriptor pool\n";
+        return;
+    }
+
+    VkDescriptorSetAllocateInfo setInfo{};
+    setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setInfo.descriptorPool = _pool;
+    setInfo.descriptorSetCount = 1;
+    setInfo.pSetLayouts = &_setLayout;
+    if (vkAllocateDescriptorSets(_device, &setInfo, &_set) != VK_SUCCESS)
+    {
+        std::cout << "Frame allocator: cant allocate descriptor set\n";
+        return;
+    }
+
+    //written once, the dynamic offsets pick the data of every draw
+    VkDescriptorBufferInfo bufferInfos[2] = { { _buffer, 0, uniformRange }, { _buffer, 0, storageRange } };
+    VkWriteDescriptorSet writes[2]{};
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = _set;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = bindings[i].descriptorType;
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+    vkUpdateDescriptorSets(_device, 2, writes, 0, nullptr);
+
+    _valid = true;
+    beginFrame(0);
+}
+
+FrameAllocator::~FrameAllocator()
+{
+    destroy();
+}
+
+void FrameAllocator::beginFrame(uint32_t frameIndex)
+{
+    _peak = std::max(_peak, _head - _frameBegin);
+    _frameBegin = _frameSize * (frameIndex % _framesInFlight);
+    _frameEnd = _frameBegin + _frameSize;
+    _head = _frameBegin;
+}
+
+void FrameAllocator::destroy()
+{
+    if (_pool != VK_NULL_HANDLE)
+        vkDestroyDescriptorPool(_device, _pool, nullptr); //frees the set
+    if (_setLayout != VK_NULL_HANDLE)
+        vkDestroyDescriptorSetLayout(_device, _setLayout, nullptr);
+    if (_buffer != VK_NULL_HANDLE)
+        vkDestroyBuffer(_device, _buffer, nullptr);
+    if (_memory != VK_NULL_HANDLE)
+        memoryTelemetry().free(_device, _memory); //implicitly unmaps
+    _pool = VK_NULL_HANDLE;
+    _setLayout = VK_NULL_HANDLE;
+    _set = VK_NULL_HANDLE;
+    _buffer = VK_NULL_HANDLE;
+    _memory = VK_NULL_HANDLE;
+    _mapped = nullptr;
+    _valid = false;
+    _frameBegin = _frameEnd = _head = 0;
+}
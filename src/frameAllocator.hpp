@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <cstring>
+
+//linear allocator for per frame shader data over one persistently mapped buffer split into one region per frame in flight
+//the descriptor set is written once, draws select their data through dynamic offsets,
+//so per draw updates cost one pointer bump and a memcpy and never a descriptor write
+//set layout: binding 0 dynamic uniform buffer, binding 1 dynamic storage buffer (both vertex and fragment stages)
+class FrameAllocator
+{
+public:
+    struct Allocation
+    {
+        void* data = nullptr; //nullptr when the frame region is full
+        uint32_t offset = 0;  //dynamic offset for vkCmdBindDescriptorSets
+    };
+
+    //uniformRange/storageRange are the buffer windows the shaders see starting at each dynamic offset
+    FrameAllocator(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t framesInFlight, VkDeviceSize bytesPerFrame,
+        VkDeviceSize uniformRange = 256, VkDeviceSize storageRange = 16 * 1024);
+    ~FrameAllocator();
+
+    FrameAllocator(const FrameAllocator&) = delete;
+    FrameAllocator& operator=(const FrameAllocator&) = delete;
+
+    bool valid() const { return _valid; }
+
+    VkDescriptorSetLayout setLayout() const { return _setLayout; }
+    VkDescriptorSet descriptorSet() const { return _set; }
+
+    //starts allocating from the region of frameIndex (0..framesInFlight-1), the GPU must be done with its previous use
+    void beginFrame(uint32_t frameIndex);
+
+    Allocation allocate(VkDeviceSize size)
+    {
+        const VkDeviceSize aligned = (size + _alignment - 1) & ~(_alignment - 1);
+        if (_head + aligned > _frameEnd)
+        {
+            ++_overflows;
+            return {};
+        }
+        Allocation allocation{ _mapped + _head, static_cast<uint32_t>(_head) };
+        _head += aligned;
+        return allocation;
+    }
+
+    //copies value into this frame's region, false when the region is full
+    template<typename T>
+    bool push(const T& value, uint32_t& dynamicOffset)
+    {
+        const Allocation allocation = allocate(sizeof(T));
+        if (allocation.data == nullptr)
+            return false;
+        std::memcpy(allocation.data, &value, sizeof(T));
+        dynamicOffset = allocation.offset;
+        return true;
+    }
+
+    //bytes used by the current frame and the most any frame used so far
+    VkDeviceSize usedBytes() const { return _head - _frameBegin; }
+    VkDeviceSize peakBytes() const { return _peak; }
+    uint64_t overflows() const { return _overflows; }
+
+    //read access for CommandTraceWriter: bytes at a dynamic offset, the end of this frame's data and each binding's window
+    const uint8_t* mappedData() const { return _mapped; }
+    VkDeviceSize headOffset() const { return _head; }
+    VkDeviceSize bindingRange(uint32_t binding) const { return _ranges[binding]; }
+
+    //device must be idle
+    void destroy();
+
+private:
+    VkDevice _device;
+    VkBuffer _buffer = VK_NULL_HANDLE;
+    VkDeviceMemory _memory = VK_NULL_HANDLE;
+    VkDescriptorSetLayout _setLayout = VK_NULL_HANDLE;
+    VkDescriptorPool _pool = VK_NULL_HANDLE;
+    VkDescriptorSet _set = VK_NULL_HANDLE;
+    uint8_t* _mapped = nullptr;
+    bool _valid = false;
+
+    uint32_t _framesInFlight;
+    VkDeviceSize _alignment = 1;
+    VkDeviceSize _ranges[2]{}; //uniform, storage
+    VkDeviceSize _frameSize = 0;
+    VkDeviceSize _frameBegin = 0;
+    VkDeviceSize _frameEnd = 0;
+    VkDeviceSize _head = 0;
+    VkDeviceSize _peak = 0;
+    uint64_t _overflows = 0;
+};
@@ -0,0 +1,228 @@
+#include "frameCapture.hpp"
+
+#include "imageWrite.hpp"
+#include "pixelConvert.hpp"
+#include "vulkanUtils.hpp"
+
+#include <cstdio>
+#include <iostream>
+#include <limits>
+
+bool FrameCapture::supportsFormat(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_R8G8B8A8_UNORM:
+        return true;
+    default:
+        return false;
+    }
+}
+
+FrameCapture::FrameCapture(VkPhysicalDevice physicalDevice, VkDevice device, VkExtent2D extent, VkFormat format,
+    std::string outputFolder, FileFormat fileFormat, uint32_t ringSize)
+    : _device(device), _extent(extent), _format(format), _folder(std::move(outputFolder)), _fileFormat(fileFormat),
+    _slots(std::make_unique<Slot[]>(ringSize)), _slotCount(ringSize)
+{
+    if (!supportsFormat(format))
+    {
+        std::cout << "Frame capture disabled, swapchain format " << format << " is not 8 bit RGBA/BGRA\n";
+        return;
+    }
+
+    const VkDeviceSize size = VkDeviceSize(extent.width) * extent.height * 4;
+    for (uint32_t i = 0; i < _slotCount; ++i)
+    {
+        Slot& slot = _slots[i];
+        //cached memory makes the CPU reads on the encoder thread fast, it may need an explicit invalidate
+        bool created = createBuffer(physicalDevice, _device, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, slot.buffer, slot.memory, MemoryCategory::Staging);
+        if (created)
+            _coherent = false;
+        else
+            created = createBuffer(physicalDevice, _device, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, slot.buffer, slot.memory, MemoryCategory::Staging);
+
+        if (!created || vkMapMemory(_device, slot.memory, 0, VK_WHOLE_SIZE, 0, &slot.mapped) != VK_SUCCESS)
+        {
+            std::cout << "Frame capture disabled, cant allocate readback buffers\n";
+            return;
+        }
+    }
+
+    _valid = true;
+    _encoder = std::thread(&FrameCapture::encoderLoop, this);
+}
+
+FrameCapture::~FrameCapture()
+{
+    shutdown(); //no-op if already shut down, also frees a partially created ring
+}
+
+bool FrameCapture::record(VkCommandBuffer cmdBuffer, VkImage image, uint64_t frame)
+{
+    if (!_valid || frame < _firstFrame)
+        return false;
+
+    Slot& slot = _slots[_nextSlot];
+    if (slot.state != Free)
+    {//encoder is behind, skip instead of waiting
+        ++_dropped;
+        return false;
+    }
+
+    VkImageMemoryBarrier toTransfer{};
+    toTransfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    toTransfer.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    toTransfer.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.image = image;
+    toTransfer.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        0, nullptr, 0, nullptr, 1, &toTransfer);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.imageExtent = { _extent.width, _extent.height, 1 };
+    vkCmdCopyImageToBuffer(cmdBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer, 1, &region);
+
+    VkImageMemoryBarrier toPresent = toTransfer;
+    toPresent.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    toPresent.dstAccessMask = 0;
+    toPresent.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    toPresent.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+    VkBufferMemoryBarrier toHost{};
+    toHost.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    toHost.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toHost.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toHost.buffer = slot.buffer;
+    toHost.offset = 0;
+    toHost.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+        0, nullptr, 1, &toHost, 1, &toPresent);
+
+    slot.frame = frame;
+    slot.state = Recorded;
+    _nextSlot = (_nextSlot + 1) % _slotCount;
+    return true;
+}
+
+void FrameCapture::collect(uint64_t completedFrames)
+{
+    if (!_valid)
+        return;
+
+    std::vector<uint32_t> ready;
+    for (uint32_t i = 0; i < _slotCount; ++i)
+    {
+        Slot& slot = _slots[i];
+        if (slot.state == Recorded && slot.frame < completedFrames)
+        {
+            slot.state = Encoding;
+            ready.push_back(i);
+        }
+    }
+    if (ready.empty())
+        return;
+
+    _captured += ready.size();
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex); //only ever contended for a push/pop
+        _encodeQueue.insert(_encodeQueue.end(), ready.begin(), ready.end());
+    }
+    _queueCv.notify_one();
+}
+
+void FrameCapture::encoderLoop()
+{
+    for (;;)
+    {
+        uint32_t index;
+        {
+            std::unique_lock<std::mutex> lock(_queueMutex);
+            _queueCv.wait(lock, [this] {return _stop || !_encodeQueue.empty(); });
+            if (_encodeQueue.empty())
+                return; //stopped and drained
+            index = _encodeQueue.front();
+            _encodeQueue.pop_front();
+        }
+        encode(_slots[index]);
+    }
+}
+
+void FrameCapture::encode(Slot& slot)
+{
+    if (!_coherent)
+    {
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = slot.memory;
+        range.offset = 0;
+        range.size = VK_WHOLE_SIZE;
+        vkInvalidateMappedMemoryRanges(_device, 1, &range);
+    }
+
+    const size_t pixelCount = size_t(_extent.width) * _extent.height;
+    const uint8_t* pixels = static_cast<const uint8_t*>(slot.mapped);
+
+    //swizzle in a scratch buffer instead of in place, the mapped memory may be uncached
+    static thread_local std::vector<uint8_t> rgba;
+    if (_format == VK_FORMAT_B8G8R8A8_SRGB || _format == VK_FORMAT_B8G8R8A8_UNORM)
+    {
+        rgba.resize(pixelCount * 4);
+        bgra8ToRgba8(pixels, rgba.data(), pixelCount);
+        pixels = rgba.data();
+    }
+
+    const std::string path = framePath(slot.frame);
+
+    const bool written = _fileFormat == FileFormat::PNG ?
+        writePNG(path, _extent.width, _extent.height, pixels) :
+        writePPM(path, _extent.width, _extent.height, pixels);
+    if (!written)
+        std::cout << "Frame capture: cant write \"" << path << "\"\n";
+
+    slot.state = Free;
+}
+
+std::string FrameCapture::framePath(uint64_t frame) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "/frame_%06llu.%s", static_cast<unsigned long long>(frame),
+        _fileFormat == FileFormat::PNG ? "png" : "ppm");
+    return _folder + name;
+}
+
+void FrameCapture::shutdown()
+{
+    collect(std::numeric_limits<uint64_t>::max()); //device is idle, every recorded frame is complete
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        _stop = true;
+    }
+    _queueCv.notify_all();
+    if (_encoder.joinable())
+        _encoder.join();
+
+    for (uint32_t i = 0; i < _slotCount; ++i)
+    {
+        Slot& slot = _slots[i];
+        if (slot.buffer != VK_NULL_HANDLE)
+            vkDestroyBuffer(_device, slot.buffer, nullptr);
+        if (slot.memory != VK_NULL_HANDLE)
+            memoryTelemetry().free(_device, slot.memory); //implicitly unmaps
+        slot.buffer = VK_NULL_HANDLE;
+        slot.memory = VK_NULL_HANDLE;
+        slot.mapped = nullptr;
+    }
+    _valid = false;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//copies rendered swapchain images into a ring of persistently mapped host buffers
+//slots are handed to an encoder thread once the GPU finished the frame that wrote them,
+//the render loop never waits: when every slot is busy the frame is simply not captured
+class FrameCapture
+{
+public:
+    enum class FileFormat
+    {
+        PPM,
+        PNG
+    };
+
+    //swapchain images must be created with VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+    //outputFolder must exist, frames are written as frame_<number>.<ext>
+    FrameCapture(VkPhysicalDevice physicalDevice, VkDevice device, VkExtent2D extent, VkFormat format,
+        std::string outputFolder, FileFormat fileFormat, uint32_t ringSize = 4);
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    //false if the swapchain format or memory types are not supported, record() is a no-op then
+    bool valid() const { return _valid; }
+
+    //records the copy of image (in VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, left in the same layout) after the render pass
+    //frame is the index of the frame being recorded; returns false if the frame is not captured
+    bool record(VkCommandBuffer cmdBuffer, VkImage image, uint64_t frame);
+
+    //hands every slot whose frame finished on the GPU to the encoder; render thread, never blocks
+    void collect(uint64_t completedFrames);
+
+    //waits for the encoder to drain and frees the buffers; device must be idle
+    void shutdown();
+
+    //frames recorded before this one are skipped without counting as dropped
+    void setFirstFrame(uint64_t frame) { _firstFrame = frame; }
+
+    //file the given frame is written to
+    std::string framePath(uint64_t frame) const;
+
+    uint64_t capturedFrames() const { return _captured; }
+    uint64_t droppedFrames() const { return _dropped; }
+
+    //capture only makes sense for 8 bit BGRA/RGBA swapchains
+    static bool supportsFormat(VkFormat format);
+
+private:
+    enum SlotState : int
+    {
+        Free,
+        Recorded, //copy recorded, GPU may still be writing
+        Encoding  //owned by the encoder thread
+    };
+
+    struct Slot
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void* mapped = nullptr;
+        uint64_t frame = 0;
+        std::atomic<int> state{ Free };
+    };
+
+    void encoderLoop();
+    void encode(Slot& slot);
+
+    VkDevice _device;
+    VkExtent2D _extent;
+    VkFormat _format;
+    std::string _folder;
+    FileFormat _fileFormat;
+    bool _coherent = true;
+    bool _valid = false;
+
+    std::unique_ptr<Slot[]> _slots;
+    uint32_t _slotCount;
+    uint32_t _nextSlot = 0;
+    uint64_t _firstFrame = 0;
+
+    uint64_t _captured = 0; //render thread
+    uint64_t _dropped = 0;
+
+    std::mutex _queueMutex;
+    std::condition_variable _queueCv;
+    std::deque<uint32_t> _encodeQueue;
+    bool _stop = false;
+
+    std::thread _encoder;
+};
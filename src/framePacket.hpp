@@ -0,0 +1,63 @@
+#pragma once
+
+#include "shaderInterface.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+//everything the render thread needs to draw one frame, built by the event/simulation thread and never modified afterwards
+struct FramePacket
+{
+    uint64_t frame = 0;
+    DrawPushConstants draw;
+    FrameUniforms uniforms;
+    std::chrono::steady_clock::time_point inputTime; //when the input this frame reacts to was sampled
+    VkExtent2D extent{}; //framebuffer size the packet was built for, the render thread recreates the swapchain to match
+    VkRect2D damage{}; //pixels that changed since the previous packet, render area and scissor of the redraw
+    bool last = false; //no frame, the render thread drains the GPU and exits
+};
+
+//pixels covered by the triangle of shader.vert drawn with draw, padded by a pixel for rasterization rounding
+inline VkRect2D triangleBounds(const DrawPushConstants& draw, VkExtent2D extent)
+{
+    const float half = 0.5f * std::abs(draw.scale);
+    auto toPixels = [](float ndc, uint32_t size) {return std::clamp((ndc + 1.0f) * 0.5f * float(size), 0.0f, float(size)); };
+    const int32_t x0 = int32_t(toPixels(draw.offset[0] - half, extent.width)) - 1;
+    const int32_t y0 = int32_t(toPixels(draw.offset[1] - half, extent.height)) - 1;
+    const int32_t x1 = int32_t(std::ceil(toPixels(draw.offset[0] + half, extent.width))) + 1;
+    const int32_t y1 = int32_t(std::ceil(toPixels(draw.offset[1] + half, extent.height))) + 1;
+
+    VkRect2D rect;
+    rect.offset = { std::max(x0, 0), std::max(y0, 0) };
+    rect.extent = { uint32_t(std::max(std::min(x1, int32_t(extent.width)) - rect.offset.x, 0)),
+        uint32_t(std::max(std::min(y1, int32_t(extent.height)) - rect.offset.y, 0)) };
+    return rect;
+}
+
+//smallest rectangle containing both, empty rectangles are ignored
+inline VkRect2D unionRect(const VkRect2D& a, const VkRect2D& b)
+{
+    if (a.extent.width == 0 || a.extent.height == 0)
+        return b;
+    if (b.extent.width == 0 || b.extent.height == 0)
+        return a;
+    const int32_t x0 = std::min(a.offset.x, b.offset.x);
+    const int32_t y0 = std::min(a.offset.y, b.offset.y);
+    const int32_t x1 = std::max(a.offset.x + int32_t(a.extent.width), b.offset.x + int32_t(b.extent.width));
+    const int32_t y1 = std::max(a.offset.y + int32_t(a.extent.height), b.offset.y + int32_t(b.extent.height));
+    return { { x0, y0 }, { uint32_t(x1 - x0), uint32_t(y1 - y0) } };
+}
+
+//the part of rect inside a framebuffer of extent, damage is computed for the window size and the swapchain may differ
+inline VkRect2D clampRect(const VkRect2D& rect, VkExtent2D extent)
+{
+    const int32_t x0 = std::clamp(rect.offset.x, 0, int32_t(extent.width));
+    const int32_t y0 = std::clamp(rect.offset.y, 0, int32_t(extent.height));
+    const int32_t x1 = std::clamp(rect.offset.x + int32_t(rect.extent.width), x0, int32_t(extent.width));
+    const int32_t y1 = std::clamp(rect.offset.y + int32_t(rect.extent.height), y0, int32_t(extent.height));
+    return { { x0, y0 }, { uint32_t(x1 - x0), uint32_t(y1 - y0) } };
+}
@@ -0,0 +1,122 @@
+#include "goldenImage.hpp"
+
+#include "imageWrite.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+bool readPPM(const std::string& path, RgbImage& image)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+    const std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    PpmHeader header;
+    if (!parsePPM(data.data(), data.size(), header))
+        return false;
+
+    image.width = header.width;
+    image.height = header.height;
+    image.pixels.assign(data.begin() + header.pixelOffset, data.begin() + header.pixelOffset + size_t(header.width) * header.height * 3);
+    return true;
+}
+
+static bool writeDiffPPM(const std::string& path, const RgbImage& diff)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+    file << "P6\n" << diff.width << " " << diff.height << "\n255\n";
+    file.write(reinterpret_cast<const char*>(diff.pixels.data()), diff.pixels.size());
+    return static_cast<bool>(file);
+}
+
+ImageDiff compareImages(const RgbImage& actual, const RgbImage& golden, uint32_t tolerance, const std::string& diffPath)
+{
+    ImageDiff result;
+    if (actual.width != golden.width || actual.height != golden.height)
+        return result;
+    result.sizeMatches = true;
+
+    RgbImage diff;
+    if (!diffPath.empty())
+    {
+        diff.width = actual.width;
+        diff.height = actual.height;
+        diff.pixels.resize(actual.pixels.size());
+    }
+
+    const size_t pixelCount = size_t(actual.width) * actual.height;
+    for (size_t i = 0; i < pixelCount; ++i)
+    {
+        uint32_t pixelDiff = 0;
+        for (size_t c = 0; c < 3; ++c)
+        {
+            const int d = int(actual.pixels[i * 3 + c]) - int(golden.pixels[i * 3 + c]);
+            pixelDiff = std::max(pixelDiff, uint32_t(d < 0 ? -d : d));
+        }
+        result.maxChannelDiff = std::max(result.maxChannelDiff, pixelDiff);
+        const bool mismatch = pixelDiff > tolerance;
+        if (mismatch)
+            ++result.mismatchedPixels;
+
+        if (!diff.pixels.empty())
+        {
+            for (size_t c = 0; c < 3; ++c)
+                diff.pixels[i * 3 + c] = mismatch ? (c == 0 ? 255 : 0) : actual.pixels[i * 3 + c] / 4;
+        }
+    }
+
+    if (!diff.pixels.empty() && result.mismatchedPixels > 0)
+        writeDiffPPM(diffPath, diff);
+    return result;
+}
+
+bool checkGoldenImage(const std::string& framePath, const std::string& goldenPath, uint32_t tolerance, double maxMismatchedFraction, bool update)
+{
+    if (update)
+    {
+        std::error_code error;
+        std::filesystem::copy_file(framePath, goldenPath, std::filesystem::copy_options::overwrite_existing, error);
+        if (error)
+        {
+            std::cout << "Golden image: cant copy \"" << framePath << "\" to \"" << goldenPath << "\": " << error.message() << "\n";
+            return false;
+        }
+        std::cout << "Golden image updated: " << goldenPath << "\n";
+        return true;
+    }
+
+    RgbImage actual, golden;
+    if (!readPPM(framePath, actual))
+    {
+        std::cout << "Golden image FAIL: cant read captured frame \"" << framePath << "\"\n";
+        return false;
+    }
+    if (!readPPM(goldenPath, golden))
+    {
+        std::cout << "Golden image FAIL: cant read \"" << goldenPath << "\", run with --update-golden to create it\n";
+        return false;
+    }
+
+    const std::string diffPath = framePath.substr(0, framePath.rfind('.')) + "_diff.ppm";
+    const ImageDiff diff = compareImages(actual, golden, tolerance, diffPath);
+    if (!diff.sizeMatches)
+    {
+        std::cout << "Golden image FAIL: size " << actual.width << "x" << actual.height
+            << " does not match " << golden.width << "x" << golden.height << "\n";
+        return false;
+    }
+
+    const double fraction = diff.mismatchedFraction(uint64_t(actual.width) * actual.height);
+    const bool pass = fraction <= maxMismatchedFraction;
+    std::cout << "Golden image " << (pass ? "PASS" : "FAIL") << ": " << diff.mismatchedPixels << " pixels ("
+        << fraction * 100.0 << "%) differ by more than " << tolerance << ", max channel difference " << diff.maxChannelDiff << "\n";
+    if (diff.mismatchedPixels > 0)
+        std::cout << "Difference image: " << diffPath << "\n";
+    return pass;
+}
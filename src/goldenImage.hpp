@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//golden image comparison for headless regression runs, images are binary PPM (P6) files
+
+struct RgbImage
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels; //tightly packed RGB8 rows top to bottom
+};
+
+bool readPPM(const std::string& path, RgbImage& image);
+
+struct ImageDiff
+{
+    bool sizeMatches = false;
+    uint64_t mismatchedPixels = 0; //pixels with any channel differing by more than the tolerance
+    uint32_t maxChannelDiff = 0;
+
+    double mismatchedFraction(uint64_t pixelCount) const { return pixelCount ? double(mismatchedPixels) / pixelCount : 0.0; }
+};
+
+//per channel absolute difference, a pixel mismatches when any channel is off by more than tolerance
+//writes a diff image (mismatches red over a darkened copy of actual) when diffPath is not empty
+ImageDiff compareImages(const RgbImage& actual, const RgbImage& golden, uint32_t tolerance, const std::string& diffPath = {});
+
+//compares a captured frame with the golden image and prints the result, true on pass
+//with update set the frame replaces the golden image instead and the check passes
+bool checkGoldenImage(const std::string& framePath, const std::string& goldenPath, uint32_t tolerance, double maxMismatchedFraction, bool update);
@@ -0,0 +1,332 @@
+#include "hazardTracker.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+static constexpr VkAccessFlags writeAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+void BarrierBatch::record(VkCommandBuffer cmd) const
+{
+    if (empty())
+        return;
+    vkCmdPipelineBarrier(cmd, srcStages, dstStages, 0, 0, nullptr,
+        static_cast<uint32_t>(buffers.size()), buffers.data(), static_cast<uint32_t>(images.size()), images.data());
+}
+
+void BarrierBatch::clear()
+{
+    srcStages = 0;
+    dstStages = 0;
+    buffers.clear();
+    images.clear();
+}
+
+uint32_t HazardTracker::addBuffer(VkBuffer buffer, HazardTracking mode)
+{
+    Resource& resource = _resources.emplace_back();
+    resource.buffer = buffer;
+    resource.mode = mode;
+    resource.states.resize(1);
+    return static_cast<uint32_t>(_resources.size() - 1);
+}
+
+uint32_t HazardTracker::addImage(VkImage image, VkImageAspectFlags aspect, uint32_t mipLevels, uint32_t arrayLayers, VkImageLayout layout,
+    HazardTracking mode)
+{
+    Resource& resource = _resources.emplace_back();
+    resource.image = image;
+    resource.aspect = aspect;
+    resource.mipLevels = mipLevels;
+    resource.arrayLayers = arrayLayers;
+    resource.mode = mode;
+    AccessState initial;
+    initial.layout = layout;
+    resource.states.assign(size_t(mipLevels) * arrayLayers, initial);
+    return static_cast<uint32_t>(_resources.size() - 1);
+}
+
+void HazardTracker::setTracking(uint32_t id, HazardTracking mode)
+{
+    _resources[id].mode = mode;
+}
+
+void HazardTracker::useBuffer(uint32_t id, VkPipelineStageFlags stages, VkAccessFlags access)
+{
+    Resource& resource = _resources[id];
+    if (resource.mode == HazardTracking::Untracked)
+        return;
+    ++_stats.uses;
+    if (resource.pending != UINT32_MAX)
+    {//several uses in one encoder count as one
+        _pending[resource.pending].stages |= stages;
+        _pending[resource.pending].access |= access;
+        return;
+    }
+    resource.pending = static_cast<uint32_t>(_pending.size());
+    _pending.push_back({ id, {}, VK_IMAGE_LAYOUT_UNDEFINED, stages, access });
+}
+
+void HazardTracker::useImage(uint32_t id, const VkImageSubresourceRange& range, VkImageLayout layout, VkPipelineStageFlags stages,
+    VkAccessFlags access)
+{
+    Resource& resource = _resources[id];
+    if (resource.mode == HazardTracking::Untracked)
+        return;
+    ++_stats.uses;
+    if (resource.pending == UINT32_MAX)
+        resource.pending = static_cast<uint32_t>(_pending.size());
+    //ranges can overlap, resolve() merges the uses per subresource
+    _pending.push_back({ id, range, layout, stages, access });
+}
+
+void HazardTracker::useImage(uint32_t id, VkImageLayout layout, VkPipelineStageFlags stages, VkAccessFlags access)
+{
+    const Resource& resource = _resources[id];
+    useImage(id, { resource.aspect, 0, resource.mipLevels, 0, resource.arrayLayers }, layout, stages, access);
+}
+
+void HazardTracker::setImageLayout(uint32_t id, const VkImageSubresourceRange& range, VkImageLayout layout)
+{
+    Resource& resource = _resources[id];
+    const uint32_t mipEnd = range.levelCount == VK_REMAINING_MIP_LEVELS ? resource.mipLevels : range.baseMipLevel + range.levelCount;
+    const uint32_t layerEnd = range.layerCount == VK_REMAINING_ARRAY_LAYERS ? resource.arrayLayers : range.baseArrayLayer + range.layerCount;
+    for (uint32_t mip = range.baseMipLevel; mip < mipEnd; ++mip)
+        for (uint32_t layer = range.baseArrayLayer; layer < layerEnd; ++layer)
+            resource.states[size_t(mip) * resource.arrayLayers + layer].layout = layout;
+}
+
+VkImageLayout HazardTracker::imageLayout(uint32_t id, uint32_t mipLevel, uint32_t arrayLayer) const
+{
+    const Resource& resource = _resources[id];
+    return resource.states[size_t(mipLevel) * resource.arrayLayers + arrayLayer].layout;
+}
+
+bool HazardTracker::transition(AccessState& s, const Use& use, bool image, VkPipelineStageFlags& srcStages, VkAccessFlags& srcAccess)
+{
+    const bool write = (use.access & writeAccessMask) != 0;
+    const bool layoutChange = image && use.layout != s.layout;
+    srcStages = 0;
+    srcAccess = 0;
+
+    if (write || layoutChange)
+    {//waits for the last write and every read after it, a layout transition is a write too
+        srcStages = s.writeStages | s.readStages;
+        srcAccess = s.visibleAccess != 0 ? 0 : s.writeAccess; //a barrier for an earlier reader already made the write available
+        const bool needed = srcStages != 0 || layoutChange;
+        if (write)
+        {
+            s.writeStages = use.stages;
+            s.writeAccess = use.access & writeAccessMask;
+            s.visibleStages = 0;
+            s.visibleAccess = 0;
+            s.readStages = 0;
+        }
+        else
+        {//later readers in other stages still have to chain after the transition
+            s.writeStages = use.stages;
+            s.writeAccess = 0;
+            s.visibleStages = use.stages;
+            s.visibleAccess = use.access;
+            s.readStages = use.stages;
+        }
+        s.layout = image ? use.layout : s.layout;
+        return needed;
+    }
+
+    bool needed = false;
+    if (s.writeStages != 0 && ((use.stages & ~s.visibleStages) != 0 || (use.access & ~s.visibleAccess) != 0))
+    {//read after write, once per new reader stage or access type
+        srcStages = s.writeStages;
+        srcAccess = s.writeAccess;
+        s.visibleStages |= use.stages;
+        s.visibleAccess |= use.access;
+        needed = true;
+    }
+    s.readStages |= use.stages;
+    return needed;
+}
+
+void HazardTracker::addImageBarrier(const Resource& resource, const VkImageSubresourceRange& range, const SubresourceResult& result)
+{
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = result.srcAccess;
+    barrier.dstAccessMask = result.dstAccess;
+    barrier.oldLayout = result.oldLayout;
+    barrier.newLayout = result.newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = resource.image;
+    barrier.subresourceRange = range;
+    _batch.images.push_back(barrier);
+}
+
+void HazardTracker::resolveImage(Resource& resource, size_t first)
+{
+    //merge the encoder's uses per subresource first, every subresource then gets at most one barrier in the batch
+    const uint32_t id = _pending[first].id;
+    _scratchUses.assign(resource.states.size(), SubresourceUse{});
+    for (size_t i = first; i < _pending.size(); ++i)
+    {
+        const Use& use = _pending[i];
+        if (use.id != id)
+            continue;
+        const uint32_t mipEnd = use.range.levelCount == VK_REMAINING_MIP_LEVELS ? resource.mipLevels : use.range.baseMipLevel + use.range.levelCount;
+        const uint32_t layerEnd = use.range.layerCount == VK_REMAINING_ARRAY_LAYERS ? resource.arrayLayers : use.range.baseArrayLayer + use.range.layerCount;
+        if (mipEnd > resource.mipLevels || layerEnd > resource.arrayLayers || mipEnd <= use.range.baseMipLevel ||
+            layerEnd <= use.range.baseArrayLayer)
+        {
+            std::cout << "HazardTracker: image use outside of the image, ignored\n";
+            continue;
+        }
+        bool conflict = false;
+        for (uint32_t mip = use.range.baseMipLevel; mip < mipEnd; ++mip)
+            for (uint32_t layer = use.range.baseArrayLayer; layer < layerEnd; ++layer)
+            {
+                SubresourceUse& merged = _scratchUses[size_t(mip) * resource.arrayLayers + layer];
+                if (!merged.used)
+                {
+                    merged = { true, use.layout, use.stages, use.access };
+                    continue;
+                }
+                merged.stages |= use.stages;
+                merged.access |= use.access;
+                if (merged.layout != use.layout)
+                {//both transitions in one vkCmdPipelineBarrier would conflict, GENERAL serves every use
+                    merged.layout = VK_IMAGE_LAYOUT_GENERAL;
+                    conflict = true;
+                }
+            }
+        if (conflict)
+            ++_stats.layoutConflicts;
+    }
+
+    std::vector<SubresourceResult>& results = _scratch;
+    results.assign(resource.states.size(), SubresourceResult{});
+    bool any = false;
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const SubresourceUse& merged = _scratchUses[i];
+        if (!merged.used)
+            continue;
+        AccessState& s = resource.states[i];
+        const VkImageLayout oldLayout = s.layout;
+        const Use use = { id, {}, merged.layout, merged.stages, merged.access };
+        VkPipelineStageFlags srcStages;
+        VkAccessFlags srcAccess;
+        if (!transition(s, use, true, srcStages, srcAccess))
+            continue;
+        any = true;
+        _batch.srcStages |= srcStages;
+        _batch.dstStages |= merged.stages;
+        //without a write or a layout change the execution dependency is enough
+        if (srcAccess != 0 || oldLayout != merged.layout)
+            results[i] = { true, oldLayout, merged.layout, srcAccess, merged.access };
+    }
+    if (!any)
+        return;
+
+    //subresources with identical barriers share one: runs of layers within a mip level, extended over the following
+    //mip levels while those have the same run
+    struct Run
+    {
+        uint32_t mipBegin;
+        uint32_t layerBegin;
+        uint32_t layerEnd;
+        SubresourceResult result;
+    };
+    std::vector<Run> open, next;
+    const auto emit = [this, &resource](const Run& run, uint32_t mipEnd) {
+        addImageBarrier(resource, { resource.aspect, run.mipBegin, mipEnd - run.mipBegin, run.layerBegin, run.layerEnd - run.layerBegin },
+            run.result);
+    };
+    for (uint32_t mip = 0; mip < resource.mipLevels; ++mip)
+    {
+        const SubresourceResult* row = results.data() + size_t(mip) * resource.arrayLayers;
+        next.clear();
+        for (uint32_t layer = 0; layer < resource.arrayLayers; )
+        {
+            if (!row[layer].barrier)
+            {
+                ++layer;
+                continue;
+            }
+            uint32_t layerEnd = layer + 1;
+            while (layerEnd < resource.arrayLayers && row[layerEnd] == row[layer])
+                ++layerEnd;
+            auto it = std::find_if(open.begin(), open.end(), [&](const Run& run) {
+                return run.layerBegin == layer && run.layerEnd == layerEnd && run.result == row[layer];
+                });
+            if (it != open.end())
+            {
+                next.push_back(*it);
+                open.erase(it);
+            }
+            else
+                next.push_back({ mip, layer, layerEnd, row[layer] });
+            layer = layerEnd;
+        }
+        for (const Run& run : open)
+            emit(run, mip);
+        open.swap(next);
+    }
+    for (const Run& run : open)
+        emit(run, resource.mipLevels);
+}
+
+const BarrierBatch& HazardTracker::resolve()
+{
+    _batch.clear();
+    for (size_t i = 0; i < _pending.size(); ++i)
+    {
+        const Use& use = _pending[i];
+        Resource& resource = _resources[use.id];
+        if (resource.pending != i)
+            continue; //an image use resolved together with the image's first one
+        resource.pending = UINT32_MAX;
+
+        if (resource.image != VK_NULL_HANDLE)
+        {
+            resolveImage(resource, i);
+            continue;
+        }
+
+        VkPipelineStageFlags srcStages;
+        VkAccessFlags srcAccess;
+        if (!transition(resource.states[0], use, false, srcStages, srcAccess))
+            continue;
+        _batch.srcStages |= srcStages;
+        _batch.dstStages |= use.stages;
+        if (srcAccess == 0)
+            continue; //write after read only needs the execution dependency
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = use.access;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = resource.buffer;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+        _batch.buffers.push_back(barrier);
+    }
+    _pending.clear();
+
+    if (!_batch.empty())
+    {
+        if (_batch.srcStages == 0)
+            _batch.srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT; //first use, only a layout transition
+        ++_stats.barrierCalls;
+        _stats.bufferBarriers += _batch.buffers.size();
+        _stats.imageBarriers += _batch.images.size();
+    }
+    return _batch;
+}
+
+uint32_t HazardTracker::flush(VkCommandBuffer cmd)
+{
+    const BarrierBatch& batch = resolve();
+    batch.record(cmd);
+    return static_cast<uint32_t>(batch.buffers.size() + batch.images.size());
+}
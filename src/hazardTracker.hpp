@@ -0,0 +1,137 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+//MTLHazardTrackingMode: untracked resources are skipped entirely, their barriers are up to the caller
+enum class HazardTracking
+{
+    Tracked,
+    Untracked
+};
+
+//barriers resolved at one encoder boundary, recorded as a single vkCmdPipelineBarrier
+struct BarrierBatch
+{
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+    std::vector<VkBufferMemoryBarrier> buffers;
+    std::vector<VkImageMemoryBarrier> images;
+
+    //no dependency at all; an execution only dependency (write after read) has stages but no barrier structs
+    bool empty() const { return dstStages == 0; }
+    void record(VkCommandBuffer cmd) const;
+    void clear();
+};
+
+//Metal style automatic hazard tracking: encoders declare how they use each resource, at the next encoder boundary the
+//tracker compares that against the last accesses and emits the barriers for read after write, write after write,
+//write after read and layout changes, all in one batch; buffers are tracked whole, images per mip level and layer
+//uses declared for the same encoder are not ordered against each other, like inside a Metal encoder; an image
+//subresource declared with two layouts in one encoder is transitioned once, to VK_IMAGE_LAYOUT_GENERAL, which every
+//use accepts; callers ask imageLayout() for the layout to put in their descriptors and render passes
+class HazardTracker
+{
+public:
+    uint32_t addBuffer(VkBuffer buffer, HazardTracking mode = HazardTracking::Tracked);
+    //layout is the one the image is in now, e.g. UNDEFINED right after creation
+    uint32_t addImage(VkImage image, VkImageAspectFlags aspect, uint32_t mipLevels, uint32_t arrayLayers, VkImageLayout layout,
+        HazardTracking mode = HazardTracking::Tracked);
+    void setTracking(uint32_t id, HazardTracking mode);
+
+    //uses of the next encoder
+    void useBuffer(uint32_t id, VkPipelineStageFlags stages, VkAccessFlags access);
+    void useImage(uint32_t id, const VkImageSubresourceRange& range, VkImageLayout layout, VkPipelineStageFlags stages, VkAccessFlags access);
+    void useImage(uint32_t id, VkImageLayout layout, VkPipelineStageFlags stages, VkAccessFlags access);
+
+    //layout changes done outside the tracker, e.g. by a render pass finalLayout; the GPU must be synchronized by the caller
+    void setImageLayout(uint32_t id, const VkImageSubresourceRange& range, VkImageLayout layout);
+    //layout of a subresource after the last resolve()
+    VkImageLayout imageLayout(uint32_t id, uint32_t mipLevel, uint32_t arrayLayer) const;
+
+    //turns the pending uses into barriers, the batch stays valid until the next call
+    const BarrierBatch& resolve();
+    //resolve() and record; returns the number of barrier structs, 0 if nothing (or only an execution dependency) was needed
+    uint32_t flush(VkCommandBuffer cmd);
+
+    struct Stats
+    {
+        uint64_t uses = 0;
+        uint64_t barrierCalls = 0;
+        uint64_t bufferBarriers = 0;
+        uint64_t imageBarriers = 0;
+        uint64_t layoutConflicts = 0; //image uses that shared a subresource with another layout in the same encoder
+    };
+    const Stats& stats() const { return _stats; }
+
+    size_t resourceCount() const { return _resources.size(); }
+
+private:
+    //last accesses of a buffer or an image subresource
+    struct AccessState
+    {
+        VkPipelineStageFlags writeStages = 0; //last write, until a barrier made it visible to everyone
+        VkAccessFlags writeAccess = 0;
+        VkPipelineStageFlags visibleStages = 0; //readers the last write was already made visible to
+        VkAccessFlags visibleAccess = 0;
+        VkPipelineStageFlags readStages = 0; //reads since the last write, a later write must wait for them
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    };
+
+    struct Resource
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageAspectFlags aspect = 0;
+        uint32_t mipLevels = 1;
+        uint32_t arrayLayers = 1;
+        HazardTracking mode = HazardTracking::Tracked;
+        std::vector<AccessState> states; //one for buffers, mip major for images
+        uint32_t pending = UINT32_MAX; //index of its (first) use in _pending while one is queued
+    };
+
+    struct Use
+    {
+        uint32_t id;
+        VkImageSubresourceRange range;
+        VkImageLayout layout;
+        VkPipelineStageFlags stages;
+        VkAccessFlags access;
+    };
+
+    //every use of one image subresource in the encoder, merged
+    struct SubresourceUse
+    {
+        bool used = false;
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags stages = 0;
+        VkAccessFlags access = 0;
+    };
+
+    //the image barrier a subresource needs, barrier is false when it needs none or only an execution dependency
+    struct SubresourceResult
+    {
+        bool barrier = false;
+        VkImageLayout oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkImageLayout newLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkAccessFlags srcAccess = 0;
+        VkAccessFlags dstAccess = 0;
+
+        bool operator==(const SubresourceResult&) const = default;
+    };
+
+    //updates s for the use and returns the source scope of the dependency, false if the use needs none
+    bool transition(AccessState& s, const Use& use, bool image, VkPipelineStageFlags& srcStages, VkAccessFlags& srcAccess);
+    //resolves every pending use of the image whose first use is _pending[first]
+    void resolveImage(Resource& resource, size_t first);
+    void addImageBarrier(const Resource& resource, const VkImageSubresourceRange& range, const SubresourceResult& result);
+
+    std::vector<Resource> _resources;
+    std::vector<Use> _pending;
+    BarrierBatch _batch;
+    std::vector<SubresourceUse> _scratchUses; //per subresource of the image being resolved, mip major
+    std::vector<SubresourceResult> _scratch;
+    Stats _stats;
+};
@@ -0,0 +1,166 @@
+#include "imageWrite.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <fstream>
+#include <vector>
+
+bool writePPM(const std::string& path, uint32_t width, uint32_t height, const uint8_t* rgba)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    file << "P6\n" << width << " " << height << "\n255\n";
+
+    std::vector<uint8_t> row(size_t(width) * 3);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        const uint8_t* src = rgba + size_t(y) * width * 4;
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            row[x * 3 + 0] = src[x * 4 + 0];
+            row[x * 3 + 1] = src[x * 4 + 1];
+            row[x * 3 + 2] = src[x * 4 + 2];
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+    return static_cast<bool>(file);
+}
+
+static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+{
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t n = 0; n < 256; ++n)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+        }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void putBE32(std::vector<uint8_t>& out, uint32_t value)
+{
+    out.push_back(uint8_t(value >> 24));
+    out.push_back(uint8_t(value >> 16));
+    out.push_back(uint8_t(value >> 8));
+    out.push_back(uint8_t(value));
+}
+
+static void writeChunk(std::ofstream& file, const char type[4], const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> chunk;
+    chunk.reserve(data.size() + 12);
+    putBE32(chunk, static_cast<uint32_t>(data.size()));
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    putBE32(chunk, crc32(chunk.data() + 4, data.size() + 4)); //crc covers type and data
+    file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+}
+
+bool writePNG(const std::string& path, uint32_t width, uint32_t height, const uint8_t* rgba)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    static constexpr uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+    std::vector<uint8_t> header;
+    putBE32(header, width);
+    putBE32(header, height);
+    header.insert(header.end(), { 8, 6, 0, 0, 0 }); //8 bit, RGBA, deflate, no filter method, no interlace
+    writeChunk(file, "IHDR", header);
+
+    //scanlines with filter type 0 in front of every row
+    const size_t rowSize = size_t(width) * 4;
+    std::vector<uint8_t> raw;
+    raw.reserve((rowSize + 1) * height);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        raw.push_back(0);
+        raw.insert(raw.end(), rgba + y * rowSize, rgba + (y + 1) * rowSize);
+    }
+
+    //zlib stream made of stored deflate blocks (max 65535 bytes each)
+    std::vector<uint8_t> zlib;
+    zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+    size_t pos = 0;
+    do
+    {
+        const size_t blockSize = std::min<size_t>(65535, raw.size() - pos);
+        const bool last = pos + blockSize == raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(uint8_t(blockSize));
+        zlib.push_back(uint8_t(blockSize >> 8));
+        zlib.push_back(uint8_t(~blockSize));
+        zlib.push_back(uint8_t(~blockSize >> 8));
+        zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + blockSize);
+        pos += blockSize;
+    } while (pos < raw.size());
+
+    uint32_t a = 1, b = 0; //adler32
+    for (uint8_t byte : raw)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    putBE32(zlib, (b << 16) | a);
+
+    writeChunk(file, "IDAT", zlib);
+    writeChunk(file, "IEND", {});
+    return static_cast<bool>(file);
+}
+
+bool parsePPM(const uint8_t* data, size_t size, PpmHeader& header)
+{
+    if (size < 2 || data[0] != 'P' || data[1] != '6')
+        return false;
+
+    constexpr uint32_t maxValue = 1u << 16; //past any image loaded here, keeps the raster size from overflowing
+    size_t pos = 2;
+    uint32_t values[3]{}; //width, height, maxval
+    for (uint32_t& value : values)
+    {
+        //skip whitespace and comments
+        while (pos < size && (std::isspace(data[pos]) || data[pos] == '#'))
+        {
+            if (data[pos] == '#')
+                while (pos < size && data[pos] != '\n') ++pos;
+            else
+                ++pos;
+        }
+        if (pos >= size || !std::isdigit(data[pos]))
+            return false;
+        while (pos < size && std::isdigit(data[pos]))
+        {
+            value = value * 10 + (data[pos++] - '0');
+            if (value > maxValue)
+                return false;
+        }
+    }
+    ++pos; //single whitespace before the raster
+
+    if (values[2] != 255 || values[0] == 0 || values[1] == 0)
+        return false;
+    if (pos > size || size - pos < size_t(values[0]) * values[1] * 3)
+        return false;
+
+    header.width = values[0];
+    header.height = values[1];
+    header.pixelOffset = pos;
+    return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//minimal image file writers used by frame capture, pixels are tightly packed RGBA8 rows top to bottom, and a PPM reader
+
+//binary PPM (P6), alpha is dropped
+bool writePPM(const std::string& path, uint32_t width, uint32_t height, const uint8_t* rgba);
+
+//PNG with stored (uncompressed) deflate blocks; fast to write, readable by every decoder
+bool writePNG(const std::string& path, uint32_t width, uint32_t height, const uint8_t* rgba);
+
+//binary PPM (P6) with maxval 255, the only kind the writer above produces; shared by the golden image check and
+//the texture loader; on success the tightly packed RGB rows, top to bottom, start at data + pixelOffset
+struct PpmHeader
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    size_t pixelOffset = 0;
+};
+bool parsePPM(const uint8_t* data, size_t size, PpmHeader& header);
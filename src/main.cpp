@@ -1,7 +1,5 @@
-#define GLFW_INCLUDE_VULKAN
-#include <GLFW/glfw3.h>
+#include "vulkanSetup.hpp"
 
-#include <vulkan/vulkan.h>
 #include <stdexcept>
 #include <vector>
 #include <set>
@@ -15,547 +13,195 @@
 #include <sstream>
 #include <cstdlib> //for exit
 
+#include <chrono>
+
+#include "shaderHotReload.hpp"
+#include "pixelConvert.hpp"
+#include "texture.hpp"
+#include "frameCapture.hpp"
+#include "goldenImage.hpp"
+#include "frameAllocator.hpp"
+#include "shaderInterface.hpp"
+#include "queueTimeline.hpp"
+#include "framePacket.hpp"
+#include "spscQueue.hpp"
+#include "memoryTelemetry.hpp"
+#include "deletionQueue.hpp"
+#include "deviceHandle.hpp"
+#include "commandEncoder.hpp"
+#include "dynamicResolution.hpp"
+#include "meshLoader.hpp"
+#include "commandTrace.hpp"
+#include "deviceScore.hpp"
+
+#include <memory>
+#include <thread>
+#include <cmath>
+#include <ctime>
+
+#ifdef EMBED_SHADERS
+#include <embeddedShaders.hpp> //generated at build time from src/shaders
+#endif
+
+#ifndef GLSLC_EXECUTABLE
+#define GLSLC_EXECUTABLE "" //hot reload is then disabled
+#endif
+
 #ifdef _WIN32
 
-int main();
+int main(int argc, char** argv);
 int WinMain()
 {
-    return main();
+    return main(__argc, __argv);
 }
 
 #endif // _WIN32 
 
-static void exitWithError(const char* error, int code = 0) 
-{
-    std::ostringstream errText;
-    errText << error;
-    if (code != 0)
-        errText << "; error code: " << code;
-
-    std::cout << "\nFatal error: " << errText.str() << "\n";
-
-    exit(code);
-    throw std::runtime_error(errText.str());
-}
-
-static std::vector<char> readFile(const std::string& filename);
-static VkShaderModule createShader(const VkDevice& device, const std::string& filePath);
-
-GLFWwindow* initGLFW() {
-    if (!glfwInit()) {
-        return nullptr;
-    }
-
-    // Optional: prevent OpenGL context if using Vulkan later
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
-
-    GLFWwindow* window = glfwCreateWindow(800, 600, "Empty GLFW Window", nullptr, nullptr);
-    if (!window) {
-        glfwTerminate();
-        return nullptr;
-    }
-    return window;
+//comma separated queue priorities, e.g. "1,0.5" asks for two queues; false on anything else
+static bool parseQueuePriorities(const char* list, std::vector<float>& priorities)
+{
+    std::vector<float> parsed;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        char* end = nullptr;
+        const float priority = std::strtof(item.c_str(), &end);
+        if (item.empty() || *end != '\0' || priority < 0.0f || priority > 1.0f)
+            return false;
+        parsed.push_back(priority);
+    }
+    if (parsed.empty())
+        return false;
+    priorities = std::move(parsed);
+    return true;
 }
 
-
-
-class PropList
+int main(int argc, char** argv)
 {
-    std::vector<const char*> _props;
-public:
-    void addProp(const char *prop) {
-        _props.emplace_back(prop);
-    }
-    void addProps(const char** props, size_t cnt)
+    std::vector<std::string> texturePaths; //upload only: decoded, uploaded with mips and never sampled, see TextureLoader
+    std::string meshPath; //packed mesh from the mesh packer tool, drawn instead of the built in triangle
+    std::string captureFolder; //empty when capture is off
+    FrameCapture::FileFormat captureFormat = FrameCapture::FileFormat::PNG;
+    //regression run: render a fixed number of frames, compare the last one with a golden image and check frame times
+    bool headless = false;
+    uint64_t frameLimit = 0; //0 runs until the window is closed
+    std::string goldenPath;
+    bool updateGolden = false;
+    uint32_t goldenTolerance = 2;
+    double maxMismatch = 0.001;
+    double maxFrameMs = 0.0; //0 disables the frame time check
+    double simulationLoadMs = 0.0; //busy work per frame on the event thread, to check it does not leak into frame times
+    uint64_t resizeInterval = 0; //resize the window every this many frames to exercise swapchain recreation, 0 never
+    bool onDemand = false; //block on events and only redraw damaged regions
+    double memoryLogSeconds = 10.0; //0 disables the periodic GPU memory line
+    double dynamicResolutionMs = 0.0; //scene GPU time to hold by scaling the render resolution, 0 renders at full size
+    float minRenderScale = 0.5f;
+    std::string tracePath; //command trace for tools/traceReplay.cpp, empty when tracing is off
+    uint64_t traceFirstFrame = 0;
+    uint32_t traceFrameCount = 1;
+    bool scoreDevices = false; //pick the device by measured fill rate and compute instead of by memory size
+    std::string deviceScoreCachePath; //empty uses defaultDeviceScoreCachePath()
+    QueueConfig queueConfig; //queues per role and their priorities, clamped to what the families have
+    for (int i = 1; i < argc; ++i)
     {
-        for (size_t i = 0; i < cnt; ++i)
+        std::string arg = argv[i];
+        if (arg == "--bench-pixels")
         {
-            _props.emplace_back(props[i]);
+            benchmarkPixelConversion();
+            return 0;
         }
-    }
-    const char** getProps() {
-        return _props.data();
-    }
-    size_t getPropCnt() {
-        return _props.size();
-    }
-};
-
- static VkBool32 debugCallback(
-    VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
-    VkDebugUtilsMessageTypeFlagsEXT messageType,
-    const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
-    void* /*pUserData*/) {
-
-    bool loaderError = false;
-    if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) {
-        if (messageType & VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT &&
-            strcmp(pCallbackData->pMessageIdName, "Loader Message") == 0)
+        else if (arg == "--mesh" && i + 1 < argc)
+            meshPath = argv[++i];
+        else if (arg == "--texture" && i + 1 < argc)
+            texturePaths.push_back(argv[++i]);
+        else if (arg == "--capture" && i + 1 < argc)
+            captureFolder = argv[++i];
+        else if (arg == "--capture-format" && i + 1 < argc)
+            captureFormat = std::string(argv[++i]) == "ppm" ? FrameCapture::FileFormat::PPM : FrameCapture::FileFormat::PNG;
+        else if (arg == "--headless")
+            headless = true;
+        else if (arg == "--frames" && i + 1 < argc)
+            frameLimit = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--golden" && i + 1 < argc)
+            goldenPath = argv[++i];
+        else if (arg == "--update-golden")
+            updateGolden = true;
+        else if (arg == "--tolerance" && i + 1 < argc)
+            goldenTolerance = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--max-mismatch" && i + 1 < argc)
+            maxMismatch = std::strtod(argv[++i], nullptr);
+        else if (arg == "--max-frame-ms" && i + 1 < argc)
+            maxFrameMs = std::strtod(argv[++i], nullptr);
+        else if (arg == "--memory-log-s" && i + 1 < argc)
+            memoryLogSeconds = std::strtod(argv[++i], nullptr);
+        else if (arg == "--on-demand")
+            onDemand = true;
+        else if (arg == "--dynamic-resolution" && i + 1 < argc)
+            dynamicResolutionMs = std::strtod(argv[++i], nullptr);
+        else if (arg == "--min-scale" && i + 1 < argc)
+            minRenderScale = std::clamp(std::strtof(argv[++i], nullptr), 0.1f, 1.0f);
+        else if (arg == "--trace" && i + 1 < argc)
+            tracePath = argv[++i];
+        else if (arg == "--trace-first" && i + 1 < argc)
+            traceFirstFrame = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--trace-frames" && i + 1 < argc)
+            traceFrameCount = std::max(1u, (uint32_t)std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--score-devices")
+            scoreDevices = true;
+        else if (arg == "--device-score-cache" && i + 1 < argc)
+            deviceScoreCachePath = argv[++i];
+        else if ((arg == "--graphics-queues" || arg == "--compute-queues" || arg == "--transfer-queues") && i + 1 < argc)
         {
-            loaderError = true; // Vulkan loader prijavljuje fatalnu gresku kad ne moze pravilno da ucita neki layer i ako se uopste ne koristi. Ovo je dodano kako bi se te gre�ke ignorisale
+            std::vector<float>& priorities = arg == "--graphics-queues" ? queueConfig.graphics :
+                arg == "--compute-queues" ? queueConfig.compute : queueConfig.transfer;
+            if (!parseQueuePriorities(argv[++i], priorities))
+                std::cout << "Ignoring " << arg << " \"" << argv[i] << "\", expected priorities between 0 and 1 like 1,0.5\n";
         }
+        else if (arg == "--sim-load-ms" && i + 1 < argc)
+            simulationLoadMs = std::strtod(argv[++i], nullptr);
+        else if (arg == "--resize-every" && i + 1 < argc)
+            resizeInterval = std::strtoull(argv[++i], nullptr, 10);
+        else
+            std::cout << "Unknown argument \"" << arg << "\" ignored\n";
     }
 
-    std::ostringstream errText;
-    if ((messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT) ||
-        (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT) ||
-        loaderError)
-    {
-        if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT)
-            return VK_FALSE;
-        std::cout << "Vulkan debug layer info: " << pCallbackData->pMessage << "\n";
-        return VK_FALSE;
+    if (!goldenPath.empty())
+    {//the golden check reads back the last frame as PPM
+        if (frameLimit == 0)
+            frameLimit = 60;
+        if (captureFolder.empty())
+            captureFolder = ".";
+        captureFormat = FrameCapture::FileFormat::PPM;
     }
 
-
-    errText << "Error severity: " << messageSeverity << "\n";
-    errText << "Error message: " << pCallbackData->pMessage;
-    exitWithError(errText.str().c_str(), pCallbackData->messageIdNumber);
-    return VK_FALSE;
-}
-
- template<typename T>
- T loadVkFunc(VkInstance instance, const char* name) {
-     static auto func = reinterpret_cast<T>(vkGetInstanceProcAddr(instance, name));
-
-     if (!func) {
-         std::ostringstream errText;
-         errText << "Failed to load Vulkan function: " << name;
-         exitWithError(errText.str().c_str());
-     }
-     return func;
- }
-
- struct SwapChainSupportDetails {
-     VkSurfaceCapabilitiesKHR capabilities;
-     std::vector<VkSurfaceFormatKHR> formats;
-     std::vector<VkPresentModeKHR> presentModes;
- };
-
- static SwapChainSupportDetails querySwapChainSupport(const VkPhysicalDevice &device, const VkSurfaceKHR &surface)
- {
-     SwapChainSupportDetails details;
-     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
-
-     uint32_t formatCount;
-     vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, nullptr);
-
-     if (formatCount != 0) {
-         details.formats.resize(formatCount);
-         vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, details.formats.data());
-     }
-
-     uint32_t presentModeCount;
-     vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, nullptr);
-
-     if (presentModeCount != 0) {
-         details.presentModes.resize(presentModeCount);
-         vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, details.presentModes.data());
-     }
-
-     return details;
- }
-
- struct SwapChainProfile
- {
-     VkSurfaceTransformFlagBitsKHR surfaceTransform;
-     int imgCount;
-     VkExtent2D extent;
-     VkSurfaceFormatKHR format;
-     VkPresentModeKHR presentMode;
- };
-
-
- static SwapChainProfile getSwapChainProfile(const VkPhysicalDevice& device, const VkSurfaceKHR& surface, int windowWidth, int windowHeight)
- {
-     SwapChainSupportDetails allOptions = querySwapChainSupport(device, surface);
-     SwapChainProfile profile;
-
-     //vector store colors and formats and tries to choose the color and format with the smallest index possible
-     const std::vector<VkColorSpaceKHR> preferredColorSpace = { VK_COLOR_SPACE_SRGB_NONLINEAR_KHR , VK_COLOR_SPACE_EXTENDED_SRGB_LINEAR_EXT, VK_COLOR_SPACE_HDR10_ST2084_EXT };
-     const std::vector<VkFormat> preferredFormats =
-     { VK_FORMAT_B8G8R8A8_SRGB, VK_FORMAT_R8G8B8A8_SRGB, VK_FORMAT_B8G8R8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R16G16B16A16_SFLOAT,
-       VK_FORMAT_A2B10G10R10_UNORM_PACK32, VK_FORMAT_A2B10G10R10_UNORM_PACK32 };
-
-     if (allOptions.formats.empty() || allOptions.presentModes.empty())
-         exitWithError("getSwapChainProfile called with incompatible device and surface combination");
-     
-     std::vector<VkSurfaceFormatKHR> surfaceFormats;
-     std::vector<VkSurfaceFormatKHR>::iterator surfaceFormatIterator;
-
-     //find preffered colorSpace
-     for (const VkColorSpaceKHR& colorSpace : preferredColorSpace)
-     {
-         surfaceFormatIterator = std::find_if(allOptions.formats.begin(), allOptions.formats.end(), [&colorSpace](VkSurfaceFormatKHR sFormat) {return sFormat.colorSpace == colorSpace; });
-         if (surfaceFormatIterator != allOptions.formats.end())
-             surfaceFormats.push_back(*surfaceFormatIterator);
-     }
-     
-     //if wanted colorSpace not found then every surface format is a valid choice
-     if (surfaceFormats.size() == 0)
-     {
-         surfaceFormats = std::move(allOptions.formats);
-     }
-
-     bool found = false;
-
-     //out of all valid surfaceFormats find the one with prefferd memory layout
-     for (const VkFormat& format : preferredFormats)
-     {
-         surfaceFormatIterator = std::find_if(surfaceFormats.begin(), surfaceFormats.end(), [&format](VkSurfaceFormatKHR sFormat) {return sFormat.format == format; });
-         if (surfaceFormatIterator != surfaceFormats.end()) {
-             found = true;
-             profile.format = *surfaceFormatIterator;
-             break;
-         }
-     }
-
-     
-     //if preffered format was not found pick any
-     if (!found)
-         profile.format = surfaceFormats.at(0);
-
-
-     //sorted from pick first to pick last (same as before)
-     std::vector<VkPresentModeKHR> preferredPresentations =
-     { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
-     //VK_PRESENT_MODE_FIFO_KHR is guaranteed to be abiable but other format are listed in case vector is reordered in future implementations
-
-     auto presentationIterator = std::find_first_of(
-         preferredPresentations.begin(), preferredPresentations.end(),
-         allOptions.presentModes.begin(), allOptions.presentModes.end());
-
-     if (presentationIterator == preferredPresentations.end())
-         presentationIterator = allOptions.presentModes.begin();
-
-     profile.presentMode = *presentationIterator;
-
-
-     if (allOptions.capabilities.currentExtent.width !=
-         std::numeric_limits<uint32_t>::max()) {
-         profile.extent = allOptions.capabilities.currentExtent;
-     }
-     else {
-
-         VkExtent2D actualExtent = {
-             static_cast<uint32_t>(windowWidth),
-             static_cast<uint32_t>(windowHeight)
-         };
-         
-         actualExtent.width = std::clamp(actualExtent.width,
-             allOptions.capabilities.minImageExtent.width,
-             allOptions.capabilities.maxImageExtent.width);
-         
-         actualExtent.height = std::clamp(actualExtent.height,
-             allOptions.capabilities.minImageExtent.height,
-             allOptions.capabilities.maxImageExtent.height);
-             
-         profile.extent = actualExtent;
-     }
-
-     if(allOptions.capabilities.maxImageCount != 0)
-        profile.imgCount = std::clamp(allOptions.capabilities.minImageCount + 1,
-            allOptions.capabilities.minImageCount,
-            allOptions.capabilities.maxImageCount);
-        else
-            profile.imgCount = allOptions.capabilities.minImageCount + 1;
-
-     profile.surfaceTransform = allOptions.capabilities.currentTransform;
-
-     return profile;
- }
-
- static SwapChainProfile getSwapChainProfile(const VkPhysicalDevice& device, const VkSurfaceKHR& surface, GLFWwindow *window)
- {
-     int width, height;
-     glfwGetFramebufferSize(window, &width, &height);
-     return getSwapChainProfile(device, surface, width, height);
- }
-
- static VkPhysicalDevice pickPhysicalDevice(VkInstance &instance, const VkSurfaceKHR& surface, std::vector<VkPhysicalDevice> dissalowedDevices = {})
-{
-     uint32_t deviceCount = 0;
-     vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
-     std::vector<VkPhysicalDevice> devs(deviceCount);
-     vkEnumeratePhysicalDevices(instance, &deviceCount, devs.data());
-
-     if (deviceCount == 0)
-         exitWithError("No Vulkan GPU devices found");
-     
-     VkPhysicalDeviceProperties deviceProperties;
-     VkPhysicalDeviceFeatures deviceFeatures;
-     VkPhysicalDeviceMemoryProperties memProps;
-     std::vector<long long int> points(deviceCount);
-     for (uint32_t i = 0; i < deviceCount; ++i) 
-     {
-         points[i] = 1;
-         vkGetPhysicalDeviceProperties(devs[i], &deviceProperties);
-         vkGetPhysicalDeviceFeatures(devs[i], &deviceFeatures);
-         vkGetPhysicalDeviceMemoryProperties(devs[i], &memProps);
-
-
-         for (uint32_t j = 0; j < memProps.memoryHeapCount; ++j) {
-             points[i] += memProps.memoryHeaps[j].size / (1024 * 1024); //mb
-         }
-
-         points[i] *= (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) ? 10 : 1;
-         points[i] *= (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU) ? 3 : 1;
-
-         if (std::find(dissalowedDevices.begin(), dissalowedDevices.end(), devs[i]) != dissalowedDevices.end())
-             points[i] *= 0;
-
-         uint32_t extensionCount = 0;
-         vkEnumerateDeviceExtensionProperties(devs[i], nullptr, &extensionCount, nullptr);
-         std::vector<VkExtensionProperties> deviceExtensions(extensionCount);
-         vkEnumerateDeviceExtensionProperties(devs[i], nullptr, &extensionCount, deviceExtensions.data());
-
-         //make device that does not have VK_KHR_SWAPCHAIN_EXTENSION_NAME extension unsuitable
-         if (std::find_if(deviceExtensions.begin(), deviceExtensions.end(),
-             [](const VkExtensionProperties& prop)->bool {return strcmp(prop.extensionName, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0; }) == deviceExtensions.end())
-         {//VK_KHR_SWAPCHAIN extension is not supported
-             points[i] *= 0;
-         }
-         else 
-         {
-             SwapChainSupportDetails swapDet = querySwapChainSupport(devs[i], surface);
-             if (swapDet.presentModes.empty() || swapDet.formats.empty())
-             { //swap chain is not capable to present on this surface
-                points[i] *= 0;
-             }
-         }
-     }
-
-     auto it = std::max_element(points.begin(), points.end()); //deviceCount is checked > 0 so points has at least one element
-     if (*it <= 0) 
-     {
-         //exitWithError("No suitable GPU device found");
-         return nullptr;
-     }
-
-     return devs[it - points.begin()];
- }
-
- struct QueueFamily {
-     int graphics = -1;
-     int compute = -1;
-     int transfer = -1;
-     int presentation = -1;
- };
-
- static QueueFamily getQueueFamily(const VkPhysicalDevice& device, const VkSurfaceKHR &surface)
- {
-     QueueFamily queueInd{};
-     uint32_t cnt;
-     vkGetPhysicalDeviceQueueFamilyProperties(device, &cnt, nullptr);
-     std::vector<VkQueueFamilyProperties> props(cnt);
-     vkGetPhysicalDeviceQueueFamilyProperties(device, &cnt, props.data());
-
-     auto findDedicatedFamily = [&cnt, &props](VkQueueFlagBits required, const std::vector<VkQueueFlagBits>& disallowed) -> int{
-         std::vector<int> foundQueue;
-         for (uint32_t i = 0; i < cnt; ++i)
-         {
-             if (props[i].queueFlags & required)
-             {
-                 for (const auto flag : disallowed) 
-                 {
-                     if (props[i].queueFlags & flag)
-                         goto CONTINUE_LOOP;
-                 }
-                foundQueue.push_back(i);
-             }
-         CONTINUE_LOOP:
-             ;
-         }
-         if (foundQueue.empty())
-             return -1;
-         return *std::max_element(foundQueue.begin(), foundQueue.end(), 
-             [&props](int ind1, int ind2)->bool{return props[ind1].queueCount < props[ind2].queueCount; });
-     };
-
-     auto findBiggestFamily = [&cnt, &props](VkQueueFlagBits requiredFlag) -> int { //TODO add second argument that lists families to skip if possible (another match can be found)
-         uint32_t max_queues = 0;
-         int index = -1;
-         for (uint32_t i = 0; i < cnt; ++i)
-         {
-             if (props[i].queueFlags & requiredFlag)
-             {
-                 if (props[i].queueCount > max_queues)
-                 {
-                     max_queues = props[i].queueCount;
-                     index = i;
-                 }
-             }
-         }
-         return index;
-         };
-
-     //find a family with most queues that has DMA transfer; chosen to be transfer queue
-     {
-         int found = findBiggestFamily(VK_QUEUE_TRANSFER_BIT);
-         if (found != -1)
-             queueInd.transfer = found;
-     }
-
-
-
-     //find dedicated graphics family, if not found then pick the one with most queues
-     {
-         int found = findDedicatedFamily(VK_QUEUE_GRAPHICS_BIT, {VK_QUEUE_COMPUTE_BIT, VK_QUEUE_TRANSFER_BIT});
-         if (found == -1)
-         {//dedicated graphics family not found
-             found = findBiggestFamily(VK_QUEUE_GRAPHICS_BIT); //TODO: if found family is the same as the tranfer family then TRY to find second largest family
-         }
-         if (found != -1)
-             queueInd.graphics = found;
-     }
-
-     //check if graphics queue supports presentation, if not set presentation to the first family that does
-     VkBool32 supported = false;
-     if (queueInd.graphics >= 0)
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, queueInd.graphics, surface, &supported);
-
-     if(supported)
-     {//graphics family supports presentation
-        queueInd.presentation = queueInd.graphics;
-     }
-     else {
-         VkBool32 supported;
-         for (uint32_t i = 0; i < cnt; ++i)
-         {
-             vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &supported);
-             if (supported)
-             {
-                 queueInd.presentation = i;
-                 break;
-             }
-         }
-     }
-
-     //find dedicated compute family, if not found then pick the one with most queues
-     {
-         int found = findDedicatedFamily(VK_QUEUE_COMPUTE_BIT, { VK_QUEUE_GRAPHICS_BIT, VK_QUEUE_TRANSFER_BIT });
-         if (found == -1)
-         {//dedicated compute family not found
-             found = findBiggestFamily(VK_QUEUE_COMPUTE_BIT); //TODO: try to find family that has not been already chosen
-         }
-         if (found != -1)
-             queueInd.compute = found;
-     }
-
-     return queueInd;
- }
-
-
-
-int main()
-{
-    GLFWwindow* window;
-    window = initGLFW();
-    if (window == nullptr)
-        exitWithError("glfw cant initialize");
-    
-
-    VkDebugUtilsMessengerCreateInfoEXT vkDebugCreateInfo{}; // for "VK_EXT_debug_utils" extensions
-    vkDebugCreateInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-    vkDebugCreateInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
-    vkDebugCreateInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
-    vkDebugCreateInfo.pfnUserCallback = debugCallback;
-    vkDebugCreateInfo.pUserData = nullptr;
-
-    VkApplicationInfo appInfo{};
-    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-    appInfo.pApplicationName = "Hello Triangle";
-    appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.pEngineName = "No Engine";
-    appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
-
-
-    VkInstanceCreateInfo vkInfo{};
-    vkInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-    vkInfo.pNext = &vkDebugCreateInfo;
-    vkInfo.pApplicationInfo = &appInfo;
-
-    
-
-    PropList extensions;
+    if (resizeInterval != 0 && !goldenPath.empty())
     {
-        uint32_t extensions_cnt;
-        const char** extensions_list;
-        extensions_list = glfwGetRequiredInstanceExtensions(&extensions_cnt);
-        extensions.addProps(extensions_list, extensions_cnt);
+        std::cout << "--resize-every ignored, the golden image check needs a fixed window size\n";
+        resizeInterval = 0;
     }
-    
-    extensions.addProp("VK_EXT_debug_utils");
 
-    {
-        
-        std::vector<VkExtensionProperties> aviableExtensions;
-        uint32_t aviableExtensionsCnt = 0;
-        vkEnumerateInstanceExtensionProperties(nullptr, &aviableExtensionsCnt, nullptr);
-        aviableExtensions.resize(aviableExtensionsCnt);
-
-        vkEnumerateInstanceExtensionProperties(nullptr, &aviableExtensionsCnt, aviableExtensions.data());
-
-        //check if any requested extensions are not aviable
-        const auto requestedExtensions = extensions.getProps();
-        for (int i = 0; i < extensions.getPropCnt(); ++i) {
-            int j = 0;
-            for (; j < aviableExtensions.size(); ++j) {
-                if (std::strcmp(requestedExtensions[i], aviableExtensions[j].extensionName) == 0)
-                    break;
-            }
-            if (j == aviableExtensions.size()) {
-                std::ostringstream error;
-                error << "Extension \"" << requestedExtensions[i] << "\" not found";
-                
-                exitWithError(error.str().c_str(), VK_ERROR_INITIALIZATION_FAILED);
-            }
-        }
+    if (onDemand && (frameLimit != 0 || !captureFolder.empty()))
+    {//those count on a steady stream of frames
+        std::cout << "On-demand rendering disabled, --frames, --capture and --golden need continuous rendering\n";
+        onDemand = false;
     }
-
-    vkInfo.enabledExtensionCount = (uint32_t)extensions.getPropCnt();
-    vkInfo.ppEnabledExtensionNames = extensions.getProps();
-  
-
-    PropList layers;
-
-    layers.addProp("VK_LAYER_KHRONOS_validation");
-
+    if (onDemand && dynamicResolutionMs > 0.0)
     {
-        uint32_t aviableLayerCnt;
-        std::vector<VkLayerProperties> aviableLayers;
-        vkEnumerateInstanceLayerProperties(&aviableLayerCnt, nullptr);
-        aviableLayers.resize(aviableLayerCnt);
-        vkEnumerateInstanceLayerProperties(&aviableLayerCnt, aviableLayers.data());
-
-        //check if any requested layers are not aviable
-        const auto requestedLayers = layers.getProps();
-        for (int i = 0; i < layers.getPropCnt(); ++i) {
-            int j = 0;
-            for (; j < aviableLayers.size(); ++j) {
-                if (std::strcmp(requestedLayers[i], aviableLayers[j].layerName) == 0)
-                    break;
-            }
-            if (j == aviableLayers.size()) {
-                std::ostringstream error;
-                error << "Layer \"" << requestedLayers[i] << "\" not found";
-                exitWithError(error.str().c_str(), VK_ERROR_INITIALIZATION_FAILED);
-            }
-        }
+        std::cout << "On-demand rendering disabled, dynamic resolution redraws the whole frame and needs a steady stream of timings\n";
+        onDemand = false;
     }
 
-    vkInfo.ppEnabledLayerNames = layers.getProps();
-    vkInfo.enabledLayerCount = (uint32_t)layers.getPropCnt();
+    GLFWwindow* window;
+    window = initGLFW(headless);
+    if (window == nullptr)
+        exitWithError("glfw cant initialize");
+    //objects that are not device children are released by scope guards, declared so they go in reverse creation order
+    ScopeExit windowGuard([window] { glfwDestroyWindow(window); glfwTerminate(); });
 
-    VkInstance vkInstance{};
-    auto code = vkCreateInstance(&vkInfo, nullptr, &vkInstance);
-    if (code != VK_SUCCESS) 
-    {
-        exitWithError("Vulkan init error", code);
-    }
+    VkInstance vkInstance = createInstance(true);
+    ScopeExit instanceGuard([vkInstance] { vkDestroyInstance(vkInstance, nullptr); });
 
     VkSurfaceKHR surface;
     {
@@ -563,8 +209,18 @@ int main()
         if (code != VK_SUCCESS)
             exitWithError("Error in creating surface");
     }
+    ScopeExit surfaceGuard([vkInstance, surface] { vkDestroySurfaceKHR(vkInstance, surface, nullptr); });
 
-    VkPhysicalDevice device = pickPhysicalDevice(vkInstance, surface);
+    VkPhysicalDevice device;
+    if (scoreDevices)
+    {
+        DeviceScoreCache scoreCache(deviceScoreCachePath.empty() ? defaultDeviceScoreCachePath() : deviceScoreCachePath);
+        device = pickPhysicalDeviceByBenchmark(vkInstance, surface, scoreCache);
+    }
+    else
+        device = pickPhysicalDevice(vkInstance, surface);
+    if (device == VK_NULL_HANDLE)
+        exitWithError("No device can render and present to the window");
     QueueFamily queueIndices = getQueueFamily(device, surface);
 
     if (queueIndices.graphics < 0)
@@ -572,91 +228,67 @@ int main()
     if (queueIndices.presentation < 0)
         exitWithError("no presentation queue family");
 
-    std::set<uint32_t> uniqueIndices; 
-    for (int i : {queueIndices.compute, queueIndices.graphics, queueIndices.presentation, queueIndices.transfer})
-        if (i >= 0) uniqueIndices.insert(i);
-
-
-    std::vector<VkDeviceQueueCreateInfo> queueCreateInfo(uniqueIndices.size());
+    //separate queues for graphics, uploads and compute when the families have them, see QueueConfig
+    const QueuePlan queuePlan = planQueues(device, queueIndices, queueConfig);
+    std::cout << "Queues:";
+    for (const FamilyQueues& family : queuePlan)
     {
-        int i = 0;
-        for (int index : uniqueIndices)
-        {
-            queueCreateInfo.at(i).sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-            queueCreateInfo.at(i).queueFamilyIndex = index;
-            queueCreateInfo.at(i).queueCount = 1;
-            queueCreateInfo.at(i).pQueuePriorities = []()->const float *{static constexpr float queuePriority = 1.0f; return &queuePriority;}();
-            ++i;
-        }
-    }
-
-    VkPhysicalDeviceFeatures deviceFeatures{};
-
-    VkDeviceCreateInfo deviceInfo{};
-    deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    deviceInfo.queueCreateInfoCount = (uint32_t)queueCreateInfo.size();
-    deviceInfo.pQueueCreateInfos = queueCreateInfo.data();
-    deviceInfo.pEnabledFeatures = &deviceFeatures;
-
-    deviceInfo.enabledLayerCount = 0; //DEPRECATED, IGNORED BY VULKAN
-
-    
-    std::vector<const char*> deviceExtentions{ VK_KHR_SWAPCHAIN_EXTENSION_NAME};
-    //VK_KHR_SWAPCHAIN_EXTENSION_NAME checked for avilability by pickPhysicalDevice()
-    deviceInfo.enabledExtensionCount = (uint32_t)deviceExtentions.size();
-    deviceInfo.ppEnabledExtensionNames = deviceExtentions.data();
-    
-
-    VkDevice logicalDevice;
-    {
-        auto code = vkCreateDevice(device, &deviceInfo, nullptr, &logicalDevice);
-        if (code != VK_SUCCESS)
-            exitWithError("Cant create logical device");
-    }
-
-    VkQueue graphQueue, presentQueue;
-
-    vkGetDeviceQueue(logicalDevice, queueIndices.graphics, 0, &graphQueue);
-    vkGetDeviceQueue(logicalDevice, queueIndices.presentation, 0, &presentQueue);
+        std::cout << " family " << family.family << " priorities";
+        for (float priority : family.priorities)
+            std::cout << " " << priority;
+        std::cout << ";";
+    }
+    std::cout << "\n";
+    VkDevice logicalDevice = createLogicalDevice(device, queuePlan);
+    ScopeExit deviceGuard([logicalDevice] { vkDestroyDevice(logicalDevice, nullptr); });
+    memoryTelemetry().init(device);
+    memoryTelemetry().setLogInterval(std::chrono::milliseconds(static_cast<int64_t>(memoryLogSeconds * 1000.0)));
+    QueuePool queuePool(logicalDevice, queuePlan);
+
+    //every graphics/compute/transfer submit signals the next value of its queue's timeline semaphore,
+    //frame retirement and cross queue waits compare against those counters; graphics stands in for missing families
+    DeviceTimelines timelines(logicalDevice, queuePool, queueIndices.graphics,
+        queueIndices.compute >= 0 ? queueIndices.compute : queueIndices.graphics,
+        queueIndices.transfer >= 0 ? queueIndices.transfer : queueIndices.graphics);
+    if (!timelines.valid())
+        exitWithError("cant create timeline semaphores");
+    QueueTimeline& graphicsTimeline = timelines.graphics();
+    //objects replaced while frames are in flight are destroyed here once the graphics timeline passed them
+    DeletionQueue deletionQueue(graphicsTimeline);
+
+    QueuePool::Queue* presentQueue = queueIndices.presentation == queueIndices.graphics ?
+        &graphicsTimeline.queue() : queuePool.acquire(queueIndices.presentation);
+
+    TextureLoader textures(device, logicalDevice, { &graphicsTimeline, &timelines.transfer() });
+    for (const std::string& path : texturePaths)
+        textures.load(path);
+    if (!texturePaths.empty())
+        std::cout << "--texture exercises decode, upload and mip generation only, no pipeline samples the textures\n";
 
     SwapChainProfile swapchainProfile = getSwapChainProfile(device, surface, window);
 
-    VkSwapchainCreateInfoKHR swapchainInfo{};
-    swapchainInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-    swapchainInfo.imageArrayLayers = 1;
-    swapchainInfo.imageColorSpace = swapchainProfile.format.colorSpace;
-    swapchainInfo.imageExtent = swapchainProfile.extent;
-    swapchainInfo.imageFormat = swapchainProfile.format.format;
-    swapchainInfo.surface = surface;
-    swapchainInfo.minImageCount = swapchainProfile.imgCount;
-    swapchainInfo.presentMode = swapchainProfile.presentMode;
-    swapchainInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-    swapchainInfo.preTransform = swapchainProfile.surfaceTransform;
-    swapchainInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-    swapchainInfo.clipped = VK_TRUE;
-
-    swapchainInfo.oldSwapchain = VK_NULL_HANDLE; //TODO
-
-    uint32_t queueFamilyIndicesUi32[] = { (uint32_t)queueIndices.graphics, (uint32_t)queueIndices.presentation };
-
-    if (queueIndices.graphics == queueIndices.presentation)
+    VkImageUsageFlags swapchainUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    if (!captureFolder.empty())
     {
-        swapchainInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    }
-    else 
-    {
-        swapchainInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
-        swapchainInfo.queueFamilyIndexCount = 2;
-        swapchainInfo.pQueueFamilyIndices = queueFamilyIndicesUi32;
+        if (swapchainProfile.supportedUsage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)
+            swapchainUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT; //frame capture copies out of the swapchain images
+        else
+        {
+            std::cout << "Frame capture disabled, surface does not support VK_IMAGE_USAGE_TRANSFER_SRC_BIT\n";
+            captureFolder.clear();
+        }
     }
-
-    VkSwapchainKHR swapChain;
-
+    if (dynamicResolutionMs > 0.0)
     {
-        auto code = vkCreateSwapchainKHR(logicalDevice, &swapchainInfo, nullptr, &swapChain);
-        if (code != VK_SUCCESS)
-            exitWithError("Swapchain creation failed");
+        if (swapchainProfile.supportedUsage & VK_IMAGE_USAGE_TRANSFER_DST_BIT)
+            swapchainUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT; //the scaled scene is blitted into the swapchain images
+        else
+        {
+            std::cout << "Dynamic resolution disabled, surface does not support VK_IMAGE_USAGE_TRANSFER_DST_BIT\n";
+            dynamicResolutionMs = 0.0;
+        }
     }
+    SwapchainHandle swapChain(logicalDevice, createSwapchain(logicalDevice, surface, swapchainProfile, queueIndices, swapchainUsage));
 
     uint32_t swapchainImgCnt;
     vkGetSwapchainImagesKHR(logicalDevice, swapChain, &swapchainImgCnt, nullptr);
@@ -664,77 +296,50 @@ int main()
     std::vector<VkImage> swapChainImages(swapchainImgCnt);
     vkGetSwapchainImagesKHR(logicalDevice, swapChain, &swapchainImgCnt, swapChainImages.data());
 
-    std::vector<VkImageView> swapchaingImageView(swapchainImgCnt);
-    for (int i = 0; i<swapchainImgCnt; ++i)
+    std::unique_ptr<FrameCapture> frameCapture;
+    if (!captureFolder.empty())
     {
-        VkImageViewCreateInfo viewInfo{};
-        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-        viewInfo.format = swapchainProfile.format.format;
-        viewInfo.image = swapChainImages[i];
-        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-
-        viewInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-        viewInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-        viewInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-        viewInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-
-        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        viewInfo.subresourceRange.baseMipLevel = 0;
-        viewInfo.subresourceRange.levelCount = 1;
-        viewInfo.subresourceRange.baseArrayLayer = 0;
-        viewInfo.subresourceRange.layerCount = 1;
-
-        auto code = vkCreateImageView(logicalDevice, &viewInfo, nullptr, &swapchaingImageView[i]);
-        if (code != VK_SUCCESS)
-            exitWithError("failed to create imageView with index ${error_code}", i);
+        frameCapture = std::make_unique<FrameCapture>(device, logicalDevice, swapchainProfile.extent, swapchainProfile.format.format,
+            captureFolder, captureFormat);
+        if (!frameCapture->valid())
+            frameCapture.reset();
+    }
+    if (!goldenPath.empty())
+    {
+        if (!frameCapture)
+            exitWithError("golden image check needs frame capture");
+        frameCapture->setFirstFrame(frameLimit - 1);
     }
 
+    std::vector<VkImageView> swapchaingImageView = createSwapchainImageViews(logicalDevice, swapChainImages, swapchainProfile.format.format);
+    std::vector<ImageViewHandle> imageViewHandles = adoptHandles<ImageViewHandle>(logicalDevice, swapchaingImageView);
+
     
 
     VkShaderModule vertexShader;
     VkShaderModule fragmentShader;
 
     {
-        std::string path = SHADERS_FOLDER_LOCATION;
+        const auto loadStart = std::chrono::steady_clock::now();
+#ifdef EMBED_SHADERS
+        const char* shaderOrigin = "embedded SPIR-V";
+        for (auto [module, name] : { std::pair{&vertexShader, "shader.vert"}, std::pair{&fragmentShader, "shader.frag"} })
+        {
+            const EmbeddedShader* embedded = findEmbeddedShader(name);
+            if (embedded == nullptr)
+                exitWithError((std::string("shader not embedded: ") + name).c_str());
+            *module = createShader(logicalDevice, embedded->code, embedded->size, name);
+        }
+#else
+        const char* shaderOrigin = "files";
+        std::string path = SPIRV_FOLDER_LOCATION;
         vertexShader = createShader(logicalDevice, path + "/vert.spv");
         fragmentShader = createShader(logicalDevice, path + "/frag.spv");
+#endif
+        const auto loadTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - loadStart);
+        std::cout << "Shaders loaded from " << shaderOrigin << " in " << loadTime.count() << " us\n"; //compare builds with EMBED_SHADERS ON/OFF
     }
 
-    VkPipelineShaderStageCreateInfo shaderStages[2]{};
-
-    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    shaderStages[0].module = vertexShader;
-    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-    shaderStages[0].pName = "main";
-
-    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    shaderStages[1].module = fragmentShader;
-    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    shaderStages[1].pName = "main";
-
-    std::vector<VkDynamicState> dynamicStates = {
-        VK_DYNAMIC_STATE_VIEWPORT,
-        VK_DYNAMIC_STATE_SCISSOR
-    };
-
-    VkPipelineDynamicStateCreateInfo dynamicState{};
-    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
-    dynamicState.pDynamicStates = dynamicStates.data();
-
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 0;
-    vertexInputInfo.pVertexBindingDescriptions = nullptr;
-    vertexInputInfo.vertexAttributeDescriptionCount = 0;
-    vertexInputInfo.pVertexAttributeDescriptions = nullptr;
-
-    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-    
     VkViewport viewport{};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
@@ -743,147 +348,25 @@ int main()
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
 
-    VkRect2D scissor{};
-    scissor.offset = { 0, 0 };
-    scissor.extent = swapchainProfile.extent;
-
-    VkPipelineViewportStateCreateInfo viewportState{};
-    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
-    viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
-    
+    //frames the CPU may record ahead of the GPU, every per frame resource below exists this many times
+    constexpr uint32_t maxFramesInFlight = 2;
 
-    VkPipelineRasterizationStateCreateInfo rasterizer{};
-    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer.depthClampEnable = VK_FALSE;
-    rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-
-    rasterizer.depthBiasEnable = VK_FALSE;
-    rasterizer.depthBiasConstantFactor = 0.0f; // ignored
-    rasterizer.depthBiasClamp = 0.0f;          // ignored
-    rasterizer.depthBiasSlopeFactor = 0.0f;    // ignored
-
-    VkPipelineMultisampleStateCreateInfo multisampling{};
-    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = VK_FALSE;
-    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-    multisampling.minSampleShading = 1.0f; // Optional
-    multisampling.pSampleMask = nullptr; // Optional
-    multisampling.alphaToCoverageEnable = VK_FALSE; // Optional
-    multisampling.alphaToOneEnable = VK_FALSE; // Optional
-
-
-    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_TRUE;
-    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-
-    VkPipelineColorBlendStateCreateInfo colorBlending{};
-    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlending.logicOpEnable = VK_FALSE;                
-    colorBlending.logicOp = VK_LOGIC_OP_COPY;   // ignored 
-    colorBlending.attachmentCount = 1;
-    colorBlending.pAttachments = &colorBlendAttachment;
-    //ignored since no blend attacment is using constants
-    colorBlending.blendConstants[0] = 0.0f;   // R
-    colorBlending.blendConstants[1] = 0.0f;   // G
-    colorBlending.blendConstants[2] = 0.0f;   // B
-    colorBlending.blendConstants[3] = 0.0f;   // A
-
-    VkRenderPass renderPass;
-    VkPipelineLayout pipelineLayout;
-
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 0;
-    pipelineLayoutInfo.pSetLayouts = nullptr;
-    pipelineLayoutInfo.pushConstantRangeCount = 0;
-    pipelineLayoutInfo.pPushConstantRanges = nullptr;
-
-    if (vkCreatePipelineLayout(logicalDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
-    {
-        exitWithError("cant create pipelineLayout");
-    }
+    //per frame uniform/storage data, selected with dynamic offsets
+    FrameAllocator frameData(device, logicalDevice, maxFramesInFlight, 64 * 1024);
+    if (!frameData.valid())
+        exitWithError("cant create frame allocator");
 
-    VkAttachmentDescription colorAttachment{};
-    colorAttachment.format = swapchainProfile.format.format;
-    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    PipelineLayoutHandle pipelineLayout(logicalDevice, createPipelineLayout(logicalDevice, frameData.setLayout()));
 
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    RenderPassHandle renderPass(logicalDevice, createRenderPass(logicalDevice, swapchainProfile.format.format));
+    //partial redraws load the previous contents of the swapchain image and only clear and draw the damaged area
+    RenderPassHandle preservingRenderPass(logicalDevice, createRenderPass(logicalDevice, swapchainProfile.format.format, true));
 
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
-
-    VkAttachmentReference colorAttachmentRef{};
-    colorAttachmentRef.attachment = 0;
-    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpass{};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorAttachmentRef;
-    
-
-    VkSubpassDependency dependency{}; //make sure load operations are done just before frame write
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-    
-    // Create the render pass info structure
-    VkRenderPassCreateInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = 1;            // Only one attachment (color attachment)
-    renderPassInfo.pAttachments = &colorAttachment; // Pointer to your color attachment description
-    renderPassInfo.subpassCount = 1;                // One subpass
-    renderPassInfo.pSubpasses = &subpass;           // Pointer to your subpass description
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
-
-    // Create the render pass
-    if (vkCreateRenderPass(logicalDevice, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
-        exitWithError("failed to create render pass!");
-    }
-
-
-    VkGraphicsPipelineCreateInfo pipelineInfo{};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
-    pipelineInfo.pStages = shaderStages;
-
-    pipelineInfo.pVertexInputState = &vertexInputInfo;
-    pipelineInfo.pInputAssemblyState = &inputAssembly;
-    pipelineInfo.pViewportState = &viewportState;
-    pipelineInfo.pRasterizationState = &rasterizer;
-    pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = nullptr; 
-    pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = &dynamicState;
-
-    pipelineInfo.layout = pipelineLayout;
-    pipelineInfo.renderPass = renderPass;
-    pipelineInfo.subpass = 0;
-
-    VkPipeline graphicsPipeline;
-    if (vkCreateGraphicsPipelines(logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+    //hot reload replaces the pipeline while frames using the old one are in flight, it is retired to the deletion queue
+    PipelineHandle graphicsPipeline(logicalDevice,
+        createGraphicsPipeline(logicalDevice, renderPass, pipelineLayout, vertexShader, fragmentShader), &deletionQueue);
+    if (!graphicsPipeline)
     {
        exitWithError("failed to create graphics pipeline!");
     }
@@ -892,130 +375,202 @@ int main()
     vkDestroyShaderModule(logicalDevice, vertexShader, nullptr);
     vkDestroyShaderModule(logicalDevice, fragmentShader, nullptr);
 
-
-
-    std::vector<VkFramebuffer> swapChainFramebuffers;
-    swapChainFramebuffers.resize(swapchaingImageView.size());
-    for (int i = 0; i < swapchaingImageView.size(); ++i)
+    //pipelines are rebuilt on a worker thread when a shader changes and swapped in by the render loop,
+    //the recompiled SPIR-V goes to the build folder's cache, never over the build's or the source tree's shaders
+    ShaderHotReload shaderReload(logicalDevice, SHADERS_FOLDER_LOCATION, SHADER_CACHE_FOLDER_LOCATION, GLSLC_EXECUTABLE);
+    shaderReload.addPipeline({ "shader.vert", "vert.spv" }, { "shader.frag", "frag.spv" }, &graphicsPipeline,
+        [logicalDevice, renderPass = renderPass.get(), pipelineLayout = pipelineLayout.get()](VkShaderModule vert, VkShaderModule frag) {
+            return createGraphicsPipeline(logicalDevice, renderPass, pipelineLayout, vert, frag);
+        });
+
+    //the mesh is mapped and uploaded before the render thread owns the graphics timeline; its shaders are optional,
+    //without their SPIR-V the triangle is drawn instead
+    Mesh mesh;
+    ScopeExit meshGuard([logicalDevice, &mesh] { destroyMesh(logicalDevice, mesh); });
+    PipelineHandle meshPipeline(logicalDevice, VK_NULL_HANDLE, &deletionQueue);
+    if (!meshPath.empty())
     {
-        VkImageView attachments[] = { swapchaingImageView[i] };
+        const auto loadStart = std::chrono::steady_clock::now();
+        if (loadMesh(device, logicalDevice, graphicsTimeline, meshPath, mesh))
+        {
+            const auto loadTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - loadStart);
+            std::cout << "Mesh " << meshPath << " loaded in " << loadTime.count() << " us: " << mesh.vertexCount << " vertices, "
+                << mesh.indexCount / 3 << " triangles, " << mesh.indexOffset + VkDeviceSize(mesh.indexCount) * mesh.header.indexSize << " bytes\n";
+
+            VkShaderModule meshVertex = VK_NULL_HANDLE;
+            VkShaderModule meshFragment = VK_NULL_HANDLE;
+#ifdef EMBED_SHADERS
+            const EmbeddedShader* embeddedVertex = findEmbeddedShader("mesh.vert");
+            const EmbeddedShader* embeddedFragment = findEmbeddedShader("mesh.frag");
+            if (embeddedVertex != nullptr && embeddedFragment != nullptr)
+            {
+                meshVertex = createShader(logicalDevice, embeddedVertex->code, embeddedVertex->size, "mesh.vert");
+                meshFragment = createShader(logicalDevice, embeddedFragment->code, embeddedFragment->size, "mesh.frag");
+            }
+#else
+            const std::string path = SPIRV_FOLDER_LOCATION;
+            if (std::ifstream(path + "/mesh.vert.spv").good() && std::ifstream(path + "/mesh.frag.spv").good())
+            {
+                meshVertex = createShader(logicalDevice, path + "/mesh.vert.spv");
+                meshFragment = createShader(logicalDevice, path + "/mesh.frag.spv");
+            }
+#endif
+            if (meshVertex != VK_NULL_HANDLE)
+            {
+                meshPipeline.reset(createGraphicsPipeline(logicalDevice, renderPass, pipelineLayout, meshVertex, meshFragment,
+                    meshVertexBindings(), meshVertexAttributes()));
+                vkDestroyShaderModule(logicalDevice, meshVertex, nullptr);
+                vkDestroyShaderModule(logicalDevice, meshFragment, nullptr);
+            }
+            if (meshPipeline)
+                shaderReload.addPipeline({ "mesh.vert", "mesh.vert.spv" }, { "mesh.frag", "mesh.frag.spv" }, &meshPipeline,
+                    [logicalDevice, renderPass = renderPass.get(), pipelineLayout = pipelineLayout.get()](VkShaderModule vert, VkShaderModule frag) {
+                        return createGraphicsPipeline(logicalDevice, renderPass, pipelineLayout, vert, frag, meshVertexBindings(), meshVertexAttributes());
+                    });
+            else
+                std::cout << "Mesh not drawn, no SPIR-V for mesh.vert/mesh.frag\n";
+        }
+    }
+    const bool drawMesh = static_cast<bool>(meshPipeline); //hot reload swaps the pipeline but never removes it
+    shaderReload.start();
 
-        VkFramebufferCreateInfo framebufferInfo{};
-        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass = renderPass;
-        framebufferInfo.attachmentCount = 1;
-        framebufferInfo.pAttachments = attachments;
-        framebufferInfo.width = swapchainProfile.extent.width;
-        framebufferInfo.height = swapchainProfile.extent.height;
-        framebufferInfo.layers = 1;
 
-        if (vkCreateFramebuffer(logicalDevice, &framebufferInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS)
-            exitWithError("failed to create framebuffer!", i);
 
-    }
+    std::vector<FramebufferHandle> swapChainFramebuffers = adoptHandles<FramebufferHandle>(logicalDevice,
+        createFramebuffers(logicalDevice, renderPass, swapchaingImageView, swapchainProfile.extent));
 
-    VkCommandPool commandPool;
-    VkCommandPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
-    poolInfo.queueFamilyIndex = queueIndices.graphics;
-    if (vkCreateCommandPool(logicalDevice, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+    //command buffers come from a ring sized to the frames in flight, recording goes through the Metal style encoder
+    Device mtlDevice(device, logicalDevice);
+    std::unique_ptr<CommandQueue> commandQueue = mtlDevice.newCommandQueue(graphicsTimeline, maxFramesInFlight);
+    if (!commandQueue->valid())
+        exitWithError("failed to create command queue!");
+
+    //the scene renders offscreen at a scale the GPU timestamps pick and is upscaled into the swapchain image
+    std::unique_ptr<DynamicResolution> dynamicResolution;
+    if (dynamicResolutionMs > 0.0)
     {
-        exitWithError("failed to create command pool!");
+        dynamicResolution = std::make_unique<DynamicResolution>(device, logicalDevice, graphicsTimeline.family(), swapchainProfile.extent,
+            swapchainProfile.format.format, maxFramesInFlight, ResolutionController(dynamicResolutionMs, minRenderScale));
+        if (!dynamicResolution->valid())
+            dynamicResolution.reset();
     }
 
-    VkCommandBuffer commandBuffer;
-
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = commandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = 1;
-
-    if (vkAllocateCommandBuffers(logicalDevice, &allocInfo, &commandBuffer) != VK_SUCCESS) {
-        exitWithError("failed to allocate command buffers!");
+    //the encoder commands of the traced frames plus the SPIR-V and buffer contents they use, replayed by tools/traceReplay.cpp
+    //the dynamic resolution blit and frame capture copies are recorded outside the encoder and not part of the trace
+    std::unique_ptr<MappedFile> tracedMeshFile; //the mesh contents are copied into the trace from the file
+    std::unique_ptr<CommandTraceWriter> commandTrace;
+    if (!tracePath.empty())
+    {
+        commandTrace = std::make_unique<CommandTraceWriter>(tracePath, swapchainProfile.format.format, swapchainProfile.extent,
+            traceFirstFrame, traceFrameCount);
+        commandTrace->setFrameData(&frameData);
+        const auto spirv = [](const char* source, const char* file) {
+            std::vector<uint32_t> words;
+#ifdef EMBED_SHADERS
+            (void)file;
+            if (const EmbeddedShader* embedded = findEmbeddedShader(source))
+                words.assign(embedded->code, embedded->code + embedded->size / sizeof(uint32_t));
+#else
+            (void)source;
+            const std::vector<char> bytes = readFile(std::string(SPIRV_FOLDER_LOCATION) + "/" + file);
+            words.resize(bytes.size() / sizeof(uint32_t));
+            std::memcpy(words.data(), bytes.data(), words.size() * sizeof(uint32_t));
+#endif
+            return words;
+        };
+        //read before the render thread starts, pipelines hot reloaded later are not in the trace
+        commandTrace->addPipeline(graphicsPipeline, { spirv("shader.vert", "vert.spv"), spirv("shader.frag", "frag.spv"), {}, {} });
+        if (drawMesh)
+        {
+            commandTrace->addPipeline(meshPipeline, { spirv("mesh.vert", "mesh.vert.spv"), spirv("mesh.frag", "mesh.frag.spv"),
+                meshVertexBindings(), meshVertexAttributes() });
+            tracedMeshFile = std::make_unique<MappedFile>(meshPath);
+            if (tracedMeshFile->valid())
+                commandTrace->addBuffer(mesh.buffer, tracedMeshFile->data() + mesh.header.vertexOffset,
+                    mesh.indexOffset + VkDeviceSize(mesh.indexCount) * mesh.header.indexSize);
+        }
+        commandQueue->setCommandTrace(commandTrace.get());
     }
 
-
-
-
-
-    const auto setUpCommand = [&renderPass, &swapChainFramebuffers, &swapchainProfile, &graphicsPipeline, &viewport, &scissor](int imageIndex, const VkCommandBuffer &cmdBuffer)
+    const auto setUpCommand = [&renderPass, &swapChainFramebuffers, &graphicsPipeline, &pipelineLayout, &frameData,
+        &viewport, &preservingRenderPass, &frameCapture, &swapChainImages, &dynamicResolution, &mesh, &meshPipeline, drawMesh]
+        (int imageIndex, uint32_t frameSlot, CommandBuffer& commandBuffer, const FramePacket& packet, bool preserveContents)
         {
-            VkCommandBufferBeginInfo beginInfo{};
-            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-            beginInfo.flags = 0;
-            beginInfo.pInheritanceInfo = nullptr;
+            RenderPassDescriptor pass;
+            pass.renderPass = preserveContents ? preservingRenderPass : renderPass;
+            pass.framebuffer = swapChainFramebuffers[imageIndex];
+            pass.renderArea = packet.damage;
+            VkViewport sceneViewport = viewport;
+            if (dynamicResolution)
+            {//whole frame every time, the target is cleared and the scene squeezed into its top left corner
+                dynamicResolution->beginScene(commandBuffer.handle(), frameSlot);
+                pass.renderPass = dynamicResolution->renderPass();
+                pass.framebuffer = dynamicResolution->framebuffer();
+                pass.renderArea = { { 0, 0 }, dynamicResolution->renderExtent() };
+                sceneViewport.width = static_cast<float>(pass.renderArea.extent.width);
+                sceneViewport.height = static_cast<float>(pass.renderArea.extent.height);
+            }
 
-            if (vkBeginCommandBuffer(cmdBuffer, &beginInfo) != VK_SUCCESS)
+            RenderCommandEncoder* encoder = commandBuffer.renderCommandEncoder(pass);
+            if (encoder == nullptr)
                 exitWithError("failed to begin recording command buffer!");
-
-            VkRenderPassBeginInfo renderPassInfo{};
-            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            renderPassInfo.renderPass = renderPass;
-            renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
-
-            renderPassInfo.renderArea.offset = { 0, 0 };
-            renderPassInfo.renderArea.extent = swapchainProfile.extent;
-            VkClearValue clearColor = { { {0.0f, 0.0f, 0.0f, 1.0f} } };
-            renderPassInfo.clearValueCount = 1;
-            renderPassInfo.pClearValues = &clearColor;
-
-            vkCmdBeginRenderPass(cmdBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-            vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
-
-            vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
-            vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
-            vkCmdDraw(cmdBuffer, 3, 1, 0, 0);
-            vkCmdEndRenderPass(cmdBuffer);
-            if (vkEndCommandBuffer(cmdBuffer) != VK_SUCCESS)
-                exitWithError("Failed to create command buffer");
-
+            encoder->setRenderPipelineState({ drawMesh ? meshPipeline.get() : graphicsPipeline.get(), pipelineLayout });
+            encoder->setViewport(sceneViewport);
+            encoder->setScissorRect(pass.renderArea);
+
+            //one offset per dynamic binding: uniform, storage (unused by the current shaders)
+            uint32_t dynamicOffsets[2] = { 0, 0 };
+            if (!frameData.push(packet.uniforms, dynamicOffsets[0]))
+                exitWithError("frame allocator out of space");
+            encoder->setDescriptorSet(0, frameData.descriptorSet(), dynamicOffsets, 2);
+
+            encoder->setBytes(&packet.draw, sizeof(packet.draw), drawPushConstantStages);
+            if (drawMesh)
+            {//vertices and indices share one buffer
+                encoder->setVertexBuffer(mesh.buffer, 0, 0);
+                encoder->drawIndexedPrimitives(mesh.indexCount, mesh.indexType, mesh.buffer, mesh.indexOffset);
+            }
+            else
+                encoder->drawPrimitives(0, 3);
+            encoder->endEncoding();
+            if (dynamicResolution)
+                dynamicResolution->upscale(commandBuffer.handle(), frameSlot, swapChainImages[imageIndex]);
+            if (frameCapture)
+                frameCapture->record(commandBuffer.handle(), swapChainImages[imageIndex], packet.frame);
         };
 
-
-
-
-
-    VkSemaphore imageAvailableSemaphore{};
-    VkFence inFlightFence{};
+    //binary semaphores are only left for the swapchain, which cannot wait on or signal timelines
+    SemaphoreHandle imageAvailableSemaphores[maxFramesInFlight];
+    //graphics timeline value each slot's last frame signals, 0 is reached from the start
+    uint64_t frameTimelineValues[maxFramesInFlight]{};
 
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    VkFenceCreateInfo fenceInfo{};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-    
-    if (vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS ||
-        vkCreateFence(logicalDevice, &fenceInfo, nullptr, &inFlightFence) != VK_SUCCESS) {
-        exitWithError("failed to create synchronisation objects!");
+    for (uint32_t i = 0; i < maxFramesInFlight; ++i)
+    {
+        VkSemaphore semaphore;
+        if (vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+            exitWithError("failed to create synchronisation objects!");
+        }
+        imageAvailableSemaphores[i] = SemaphoreHandle(logicalDevice, semaphore);
     }
 
-
-
-    VkSemaphore waitSemaphores[] = { imageAvailableSemaphore };
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-
-
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
-
-    submitInfo.signalSemaphoreCount = 1;
-
-    std::vector<VkSemaphore> renderFinishedSemaphore(swapchainProfile.imgCount);
-    for (int i = 0; i < renderFinishedSemaphore.size(); ++i) 
-    {
-        if (vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &renderFinishedSemaphore[i]) != VK_SUCCESS)
+    //one per swapchain image, signaled by the frame drawn into it and waited for by its present
+    const auto createRenderFinishedSemaphores = [logicalDevice, &semaphoreInfo](size_t count) {
+        std::vector<SemaphoreHandle> semaphores;
+        for (size_t i = 0; i < count; ++i)
         {
-            exitWithError("failed to create semaphore!");
+            VkSemaphore semaphore;
+            if (vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+            {
+                exitWithError("failed to create semaphore!");
+            }
+            semaphores.emplace_back(logicalDevice, semaphore);
         }
-    }
+        return semaphores;
+    };
+    std::vector<SemaphoreHandle> renderFinishedSemaphore = createRenderFinishedSemaphores(swapChainImages.size());
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.waitSemaphoreCount = 1;
@@ -1024,105 +579,304 @@ int main()
 
     uint32_t imageIndex = 0;
 
-    VkSwapchainKHR swapChains[] = { swapChain };
     presentInfo.swapchainCount = 1;
-    presentInfo.pSwapchains = swapChains;
+    presentInfo.pSwapchains = swapChain.address();
     presentInfo.pImageIndices = &imageIndex;
-    while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents(); 
-
-        vkWaitForFences(logicalDevice, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
-        vkResetFences(logicalDevice, 1, &inFlightFence);
-        vkAcquireNextImageKHR(logicalDevice, swapChain, UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
-        vkResetCommandBuffer(commandBuffer, 0);
-        setUpCommand(imageIndex, commandBuffer);
-        submitInfo.pSignalSemaphores = &renderFinishedSemaphore[imageIndex];
-        if (vkQueueSubmit(graphQueue, 1, &submitInfo, inFlightFence) != VK_SUCCESS)
-            exitWithError("cmd buffer failed to submit");
-
-        presentInfo.pWaitSemaphores = &renderFinishedSemaphore[imageIndex];
-        vkQueuePresentKHR(presentQueue, &presentInfo);
-    }
+    //the render thread owns every submit and present, this thread only handles events and builds frame packets
+    //two packets let the simulation run one frame ahead without adding more latency than that
+    SpscQueue<FramePacket, 2> framePackets;
+
+    //wait to wait time of every frame after the warmup, shader compilation and first uses skew the early ones
+    constexpr uint64_t warmupFrames = 3;
+    std::vector<double> frameTimesMs;
+    std::vector<double> inputLatenciesMs; //input sample to present of the frame using it
+    std::thread renderThread([&]() {
+        uint64_t frameNumber = 0; //frames submitted so far
+        auto lastFrameEnd = std::chrono::steady_clock::now();
+        //damage each swapchain image missed since it was last drawn, images start out with undefined contents
+        std::vector<VkRect2D> imageDamage(swapChainImages.size(), { { 0, 0 }, swapchainProfile.extent });
+        std::vector<bool> imageDrawn(swapChainImages.size(), false);
+
+        //a resize, or a surface reporting the swapchain out of date, rebuilds everything sized to the swapchain images
+        //once the GPU and the presentation engine are done with the old ones
+        VkExtent2D requestedExtent = swapchainProfile.extent; //window size the swapchain was last made for
+        bool swapchainStale = false;
+        const auto recreateSwapchain = [&](VkExtent2D extent) {
+            if (!graphicsTimeline.waitIdle() || presentQueue->waitIdle() != VK_SUCCESS)
+                exitWithError("device lost while recreating the swapchain");
+            const SwapChainProfile profile = getSwapChainProfile(device, surface, int(extent.width), int(extent.height));
+            if (profile.format.format != swapchainProfile.format.format)
+                exitWithError("surface format changed, the render passes do not match the new swapchain");
+            swapChainFramebuffers.clear();
+            imageViewHandles.clear();
+            swapChain.reset(createSwapchain(logicalDevice, surface, profile, queueIndices, swapchainUsage, swapChain.get()));
+            swapchainProfile = profile;
+            requestedExtent = extent;
+            swapchainStale = false;
+
+            uint32_t imageCount;
+            vkGetSwapchainImagesKHR(logicalDevice, swapChain, &imageCount, nullptr);
+            swapChainImages.resize(imageCount);
+            vkGetSwapchainImagesKHR(logicalDevice, swapChain, &imageCount, swapChainImages.data());
+            const std::vector<VkImageView> views = createSwapchainImageViews(logicalDevice, swapChainImages, profile.format.format);
+            imageViewHandles = adoptHandles<ImageViewHandle>(logicalDevice, views);
+            swapChainFramebuffers = adoptHandles<FramebufferHandle>(logicalDevice, createFramebuffers(logicalDevice, renderPass, views, profile.extent));
+            renderFinishedSemaphore = createRenderFinishedSemaphores(imageCount);
+            imageDamage.assign(imageCount, { { 0, 0 }, profile.extent });
+            imageDrawn.assign(imageCount, false);
+            viewport.width = static_cast<float>(profile.extent.width);
+            viewport.height = static_cast<float>(profile.extent.height);
+
+            if (frameCapture)
+            {//its readback buffers have the old size
+                frameCapture->shutdown();
+                frameCapture.reset();
+                std::cout << "Frame capture stopped, the swapchain was resized\n";
+            }
+            if (dynamicResolution)
+            {//the scale the controller settled on carries over
+                dynamicResolution = std::make_unique<DynamicResolution>(device, logicalDevice, graphicsTimeline.family(), profile.extent,
+                    profile.format.format, maxFramesInFlight, dynamicResolution->controller());
+                if (!dynamicResolution->valid())
+                    dynamicResolution.reset();
+            }
+        };
 
-    vkDeviceWaitIdle(logicalDevice);
+        FramePacket packet;
+        for (;;)
+        {
+            framePackets.pop(packet);
+            if (packet.last)
+                break;
+
+            const uint32_t frameSlot = frameNumber % maxFramesInFlight;
+            if (!graphicsTimeline.wait(frameTimelineValues[frameSlot]))
+                exitWithError("device lost while waiting for a frame");
+            const auto frameEnd = std::chrono::steady_clock::now();
+            if (frameNumber > warmupFrames)
+                frameTimesMs.push_back(std::chrono::duration<double, std::milli>(frameEnd - lastFrameEnd).count());
+            lastFrameEnd = frameEnd;
+            //frames finish in submission order, count up to the oldest one still running on the GPU
+            uint64_t completedFrames = frameNumber >= maxFramesInFlight ? frameNumber - maxFramesInFlight + 1 : 0;
+            while (completedFrames < frameNumber && graphicsTimeline.isComplete(frameTimelineValues[completedFrames % maxFramesInFlight]))
+                ++completedFrames;
+            shaderReload.applyPending();
+            deletionQueue.collect();
+            textures.update();
+            memoryTelemetry().update();
+            if (frameCapture)
+                frameCapture->collect(completedFrames);
+
+            if (swapchainStale || packet.extent.width != requestedExtent.width || packet.extent.height != requestedExtent.height)
+                recreateSwapchain(packet.extent);
+            VkResult acquired = vkAcquireNextImageKHR(logicalDevice, swapChain, UINT64_MAX, imageAvailableSemaphores[frameSlot], VK_NULL_HANDLE, &imageIndex);
+            if (acquired == VK_ERROR_OUT_OF_DATE_KHR)
+            {//the semaphore was not signaled, it can be used for the retry
+                recreateSwapchain(packet.extent);
+                acquired = vkAcquireNextImageKHR(logicalDevice, swapChain, UINT64_MAX, imageAvailableSemaphores[frameSlot], VK_NULL_HANDLE, &imageIndex);
+            }
+            if (acquired == VK_ERROR_OUT_OF_DATE_KHR)
+            {//resized again in between, the damage stays with the images and the next packet draws it
+                swapchainStale = true;
+                continue;
+            }
+            if (acquired != VK_SUCCESS && acquired != VK_SUBOPTIMAL_KHR)
+                exitWithError("failed to acquire a swapchain image", acquired);
+            if (acquired == VK_SUBOPTIMAL_KHR)
+                swapchainStale = true; //still presentable, recreated before the next frame
+            for (VkRect2D& damage : imageDamage)
+                damage = unionRect(damage, clampRect(packet.damage, swapchainProfile.extent));
+
+            frameData.beginFrame(frameSlot);
+            if (dynamicResolution)
+                dynamicResolution->beginFrame(frameSlot);
+            CommandBuffer* commandBuffer = commandQueue->commandBuffer(); //the slot waited for above, never blocks
+            if (commandBuffer == nullptr)
+                exitWithError("failed to begin recording command buffer!");
+            packet.damage = imageDamage[imageIndex];
+            setUpCommand(imageIndex, frameSlot, *commandBuffer, packet, imageDrawn[imageIndex]);
+            imageDamage[imageIndex] = {};
+            imageDrawn[imageIndex] = true;
+            //with dynamic resolution only the upscale blit touches the swapchain image, the scene runs before it is acquired
+            commandBuffer->waitForSemaphore(imageAvailableSemaphores[frameSlot],
+                dynamicResolution ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+            commandBuffer->signalSemaphore(renderFinishedSemaphore[imageIndex]);
+            frameTimelineValues[frameSlot] = commandBuffer->commit();
+            if (frameTimelineValues[frameSlot] == 0)
+                exitWithError("cmd buffer failed to submit");
+
+            presentInfo.pWaitSemaphores = renderFinishedSemaphore[imageIndex].address();
+            const VkResult presented = presentQueue->present(&presentInfo);
+            if (presented == VK_ERROR_OUT_OF_DATE_KHR || presented == VK_SUBOPTIMAL_KHR)
+                swapchainStale = true;
+            else if (presented != VK_SUCCESS)
+                exitWithError("failed to present", presented);
+            if (frameNumber > warmupFrames)
+                inputLatenciesMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - packet.inputTime).count());
+            ++frameNumber;
+        }
+        graphicsTimeline.waitIdle();
+    });
+
+    //dragging with the left button moves the triangle, otherwise it stays centered (golden images rely on that)
+    const auto simulate = [window, simulationLoadMs](FramePacket& packet) {
+        packet.inputTime = std::chrono::steady_clock::now();
+        packet.draw = DrawPushConstants{};
+        if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS)
+        {
+            double x, y;
+            int width, height;
+            glfwGetCursorPos(window, &x, &y);
+            glfwGetWindowSize(window, &width, &height);
+            if (width > 0 && height > 0)
+            {
+                packet.draw.offset[0] = static_cast<float>(2.0 * x / width - 1.0);
+                packet.draw.offset[1] = static_cast<float>(2.0 * y / height - 1.0);
+            }
+        }
+        if (simulationLoadMs > 0.0)
+        {
+            const auto until = packet.inputTime + std::chrono::duration<double, std::milli>(simulationLoadMs);
+            while (std::chrono::steady_clock::now() < until)
+                ;
+        }
+    };
 
-    vkDestroySemaphore(logicalDevice, imageAvailableSemaphore, nullptr);
-    for(int i = 0; i<renderFinishedSemaphore.size(); ++i)
-        vkDestroySemaphore(logicalDevice, renderFinishedSemaphore[i], nullptr);
-    vkDestroyFence(logicalDevice, inFlightFence, nullptr);
+    //on demand the thread sleeps in glfwWaitEventsTimeout and only sends a packet when something invalidated the image:
+    //a resize, a changed draw (damage = old and new triangle bounds) or a hot reloaded pipeline
+    constexpr double idleTimeoutSeconds = 0.25; //upper bound on how late a hot reload shows up without events
+    static bool framebufferResized = false;
+    glfwSetFramebufferSizeCallback(window, [](GLFWwindow*, int, int) { framebufferResized = true; });
+    FramePacket previous;
+    uint64_t seenReloads = shaderReload.publishedCount();
+
+    const auto cpuStart = std::clock();
+    const auto wallStart = std::chrono::steady_clock::now();
+    uint64_t framesProduced = 0;
+    while (!glfwWindowShouldClose(window) && (frameLimit == 0 || framesProduced < frameLimit)) {
+        if (onDemand)
+            glfwWaitEventsTimeout(idleTimeoutSeconds);
+        else
+            glfwPollEvents();
 
-    vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
+        if (resizeInterval != 0 && framesProduced != 0 && framesProduced % resizeInterval == 0)
+        {//alternates between the startup size and a smaller one, the new size is read back below like a user resize
+            const bool shrink = (framesProduced / resizeInterval) % 2 == 1;
+            glfwSetWindowSize(window, shrink ? 640 : 800, shrink ? 480 : 600);
+        }
 
-    for (auto framebuffer : swapChainFramebuffers) 
-    {
-        vkDestroyFramebuffer(logicalDevice, framebuffer, nullptr);
-    }
-    
-    vkDestroyPipeline(logicalDevice, graphicsPipeline, nullptr);
-    vkDestroyPipelineLayout(logicalDevice, pipelineLayout, nullptr);
-    vkDestroyRenderPass(logicalDevice, renderPass, nullptr);
+        //the swapchain follows the framebuffer size, the render thread recreates it when a packet carries a new one
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        if (framebufferWidth == 0 || framebufferHeight == 0)
+        {//minimized, nothing can be presented until the window is restored
+            glfwWaitEvents();
+            continue;
+        }
+
+        FramePacket packet;
+        packet.frame = framesProduced;
+        packet.extent = { uint32_t(framebufferWidth), uint32_t(framebufferHeight) };
+        const VkRect2D fullFrame = { { 0, 0 }, packet.extent };
+        simulate(packet);
+        packet.damage = fullFrame;
+        if (onDemand && framesProduced > 0)
+        {
+            const uint64_t reloads = shaderReload.publishedCount();
+            const bool fullInvalidation = framebufferResized || reloads != seenReloads ||
+                std::memcmp(&packet.uniforms, &previous.uniforms, sizeof(FrameUniforms)) != 0;
+            framebufferResized = false;
+            seenReloads = reloads;
+            const bool drawChanged = std::memcmp(&packet.draw, &previous.draw, sizeof(DrawPushConstants)) != 0;
+            if (!fullInvalidation && !drawChanged)
+                continue;
+            if (!fullInvalidation && !drawMesh) //the damage rects only know the triangle's bounds
+                packet.damage = unionRect(triangleBounds(previous.draw, packet.extent), triangleBounds(packet.draw, packet.extent));
+        }
 
-    for (const auto& view : swapchaingImageView)
+        //render thread is behind: keep handling events and resample so the packet carries the newest input
+        while (!framePackets.tryPush(packet) && !glfwWindowShouldClose(window))
+        {
+            glfwWaitEventsTimeout(0.001);
+            simulate(packet);
+            if (packet.damage.extent.width != fullFrame.extent.width || packet.damage.extent.height != fullFrame.extent.height)
+                packet.damage = unionRect(packet.damage, triangleBounds(packet.draw, packet.extent));
+        }
+        previous = packet;
+        ++framesProduced;
+    }
+    FramePacket last;
+    last.last = true;
+    framePackets.push(last);
+    renderThread.join();
     {
-        vkDestroyImageView(logicalDevice, view, nullptr);
+        const double cpuSeconds = double(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+        const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+        std::cout << (onDemand ? "On-demand" : "Continuous") << " rendering: " << framesProduced << " frames, CPU time " << cpuSeconds
+            << " s over " << wallSeconds << " s (" << (wallSeconds > 0.0 ? 100.0 * cpuSeconds / wallSeconds : 0.0) << "% of a core)\n";
     }
 
-    vkDestroySwapchainKHR(logicalDevice, swapChain, nullptr);
-    vkDestroyDevice(logicalDevice, nullptr);
-    vkDestroySurfaceKHR(vkInstance, surface, nullptr);
-    vkDestroyInstance(vkInstance, nullptr);
-    glfwDestroyWindow(window);
-    glfwTerminate();
-
-    return 0;
-}
-
-
-
+    vkDeviceWaitIdle(logicalDevice);
 
-static std::vector<char> readFile(const std::string& filename)
-{
-    // Open the file in binary mode and set the read position to the end (ate)
-    std::ifstream shaderFile(filename, std::ios::ate | std::ios::binary); //filename is allowed to use "/" on windows
-    if (!shaderFile.is_open()) {
-        std::string err = "failed to open file \"";
-        err += filename;
-        err += "\"";
-        exitWithError(err.c_str());
+    shaderReload.shutdown();
+    textures.shutdown();
+    if (frameCapture)
+    {
+        frameCapture->shutdown();
+        std::cout << "Captured " << frameCapture->capturedFrames() << " frames, dropped " << frameCapture->droppedFrames() << "\n";
     }
+    if (commandTrace)
+        commandTrace->finish(); //a no-op if the last traced frame already wrote it
 
-    // Get the size of the file
-    std::size_t fileSize = static_cast<std::size_t>(shaderFile.tellg());
-    // Allocate a buffer to hold the file contents
-    std::vector<char> buffer(fileSize);
-
-
-    shaderFile.seekg(0);
-    shaderFile.read(buffer.data(), fileSize);
+    std::cout << memoryTelemetry().summary() << "\n";
 
+    if (dynamicResolution && dynamicResolution->stats().samples > 0)
+    {
+        const DynamicResolution::Stats& stats = dynamicResolution->stats();
+        std::cout << "Dynamic resolution over " << stats.samples << " frames: scene GPU time avg " << stats.gpuMsTotal / stats.samples
+            << " ms (target " << dynamicResolution->controller().targetMs() << " ms), scale avg " << stats.scaleTotal / stats.samples
+            << ", lowest " << stats.lowestScale << ", last " << dynamicResolution->scale() << "\n";
+    }
 
-    shaderFile.close();
-
-    return buffer;
-}
-
-static VkShaderModule createShader(const VkDevice &device, const std::string& filePath) 
-{
-    std::vector<char> code = readFile(filePath);
-
-    VkShaderModuleCreateInfo createInfo{};
-    createInfo.codeSize = code.size();
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data()); //vector properly aligns data to be accessable by uint32_t so access is optimized
-
-    VkShaderModule shader;
-    auto returnCode = vkCreateShaderModule(device, &createInfo, nullptr, &shader);
-    if (returnCode != VK_SUCCESS) {
-        std::string error = "Cant create shader: ";
-        error += filePath;
-        exitWithError(error.c_str());
+    bool regressionFailed = false;
+    if (!frameTimesMs.empty())
+    {
+        std::sort(frameTimesMs.begin(), frameTimesMs.end());
+        double total = 0.0;
+        for (double ms : frameTimesMs)
+            total += ms;
+        const double average = total / frameTimesMs.size();
+        const double p95 = frameTimesMs[frameTimesMs.size() * 95 / 100];
+        std::cout << "Frame time over " << frameTimesMs.size() << " frames: avg " << average << " ms, p95 " << p95
+            << " ms, max " << frameTimesMs.back() << " ms\n";
+        double variance = 0.0;
+        for (double ms : frameTimesMs)
+            variance += (ms - average) * (ms - average);
+        std::cout << "Frame time jitter (stddev): " << std::sqrt(variance / frameTimesMs.size()) << " ms\n";
+        if (maxFrameMs > 0.0 && average > maxFrameMs)
+        {
+            std::cout << "Frame time FAIL: avg " << average << " ms is over the " << maxFrameMs << " ms limit\n";
+            regressionFailed = true;
+        }
+    }
+    if (!inputLatenciesMs.empty())
+    {
+        std::sort(inputLatenciesMs.begin(), inputLatenciesMs.end());
+        double total = 0.0;
+        for (double ms : inputLatenciesMs)
+            total += ms;
+        std::cout << "Input latency (sample to present): avg " << total / inputLatenciesMs.size() << " ms, p95 "
+            << inputLatenciesMs[inputLatenciesMs.size() * 95 / 100] << " ms, max " << inputLatenciesMs.back() << " ms"
+            << (simulationLoadMs > 0.0 ? " under " + std::to_string(simulationLoadMs) + " ms simulation load" : std::string()) << "\n";
+    }
+    if (!goldenPath.empty() && !frameCapture)
+    {
+        std::cout << "Golden image FAIL: frame capture stopped before the last frame (window resized)\n";
+        regressionFailed = true;
     }
+    else if (!goldenPath.empty() && !checkGoldenImage(frameCapture->framePath(frameLimit - 1), goldenPath, goldenTolerance, maxMismatch, updateGolden))
+        regressionFailed = true;
 
-    return shader;
-    //its ok to delete vector code now
-}
\ No newline at end of file
+    //device children are released by their handles, then the deletion queue, timelines, device and the scope guards
+    return regressionFailed ? 1 : 0; //nonzero fails the run when used as a test command
+}
@@ -0,0 +1,241 @@
+#include "memoryHeap.hpp"
+
+#include "vulkanUtils.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+
+MemoryHeap::MemoryHeap(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize size, uint32_t memoryTypeBits,
+    VkMemoryPropertyFlags properties, MemoryCategory category)
+    : _device(device), _size(size)
+{
+    if (size == 0)
+    {//vkAllocateMemory does not take a zero size
+        std::cout << "MemoryHeap: empty heap requested\n";
+        return;
+    }
+    _memoryType = findMemoryType(physicalDevice, memoryTypeBits, properties);
+    if (_memoryType == UINT32_MAX)
+    {
+        std::cout << "MemoryHeap: no memory type with the requested properties\n";
+        return;
+    }
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = _memoryType;
+    if (memoryTelemetry().allocate(_device, allocInfo, category, _memory) != VK_SUCCESS)
+    {
+        std::cout << "MemoryHeap: cant allocate " << size << " bytes\n";
+        _memory = VK_NULL_HANDLE;
+    }
+}
+
+MemoryHeap::~MemoryHeap()
+{
+    memoryTelemetry().free(_device, _memory);
+}
+
+bool MemoryHeap::fits(const VkMemoryRequirements& requirements, VkDeviceSize offset) const
+{
+    return valid() && (requirements.memoryTypeBits & (1u << _memoryType)) && offset % requirements.alignment == 0 &&
+        offset + requirements.size <= _size;
+}
+
+bool MemoryHeap::bind(VkBuffer buffer, VkDeviceSize offset)
+{
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(_device, buffer, &requirements);
+    return fits(requirements, offset) && vkBindBufferMemory(_device, buffer, _memory, offset) == VK_SUCCESS;
+}
+
+bool MemoryHeap::bind(VkImage image, VkDeviceSize offset)
+{
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(_device, image, &requirements);
+    return fits(requirements, offset) && vkBindImageMemory(_device, image, _memory, offset) == VK_SUCCESS;
+}
+
+VkBuffer MemoryHeap::newBuffer(const VkBufferCreateInfo& info, VkDeviceSize offset)
+{
+    VkBuffer buffer;
+    if (vkCreateBuffer(_device, &info, nullptr, &buffer) != VK_SUCCESS)
+        return VK_NULL_HANDLE;
+    if (!bind(buffer, offset))
+    {
+        vkDestroyBuffer(_device, buffer, nullptr);
+        return VK_NULL_HANDLE;
+    }
+    return buffer;
+}
+
+VkImage MemoryHeap::newImage(const VkImageCreateInfo& info, VkDeviceSize offset)
+{
+    VkImage image;
+    if (vkCreateImage(_device, &info, nullptr, &image) != VK_SUCCESS)
+        return VK_NULL_HANDLE;
+    if (!bind(image, offset))
+    {
+        vkDestroyImage(_device, image, nullptr);
+        return VK_NULL_HANDLE;
+    }
+    return image;
+}
+
+TransientImages::TransientImages(VkPhysicalDevice physicalDevice, VkDevice device)
+    : _physicalDevice(physicalDevice), _device(device)
+{
+}
+
+TransientImages::~TransientImages()
+{
+    destroy();
+}
+
+uint32_t TransientImages::add(const Desc& desc)
+{
+    _images.push_back({ desc });
+    return static_cast<uint32_t>(_images.size() - 1);
+}
+
+bool TransientImages::livesOverlap(const Image& a, const Image& b) const
+{
+    return a.desc.firstPass <= b.desc.lastPass && b.desc.firstPass <= a.desc.lastPass;
+}
+
+bool TransientImages::bytesOverlap(const Image& a, const Image& b) const
+{
+    return a.offset < b.offset + b.requirements.size && b.offset < a.offset + a.requirements.size;
+}
+
+bool TransientImages::build()
+{
+    if (_images.empty())
+        return true; //nothing to place, and no heap to allocate
+    uint32_t typeBits = ~0u;
+    for (Image& image : _images)
+    {
+        if (vkCreateImage(_device, &image.desc.info, nullptr, &image.image) != VK_SUCCESS)
+        {
+            image.image = VK_NULL_HANDLE;
+            std::cout << "TransientImages: cant create image\n";
+            destroy();
+            return false;
+        }
+        vkGetImageMemoryRequirements(_device, image.image, &image.requirements);
+        typeBits &= image.requirements.memoryTypeBits;
+    }
+
+    //greedy placement, biggest first: lowest aligned offset that does not touch any placed image alive at the same time
+    std::vector<size_t> order(_images.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b) { return _images[a].requirements.size > _images[b].requirements.size; });
+
+    VkDeviceSize heapSize = 0;
+    std::vector<size_t> placed;
+    for (size_t index : order)
+    {
+        Image& image = _images[index];
+        std::vector<VkDeviceSize> candidates = { 0 };
+        for (size_t other : placed)
+            if (livesOverlap(image, _images[other]))
+                candidates.push_back(_images[other].offset + _images[other].requirements.size);
+        std::sort(candidates.begin(), candidates.end());
+
+        for (VkDeviceSize candidate : candidates)
+        {
+            const VkDeviceSize alignment = image.requirements.alignment;
+            image.offset = (candidate + alignment - 1) / alignment * alignment;
+            const bool free = std::none_of(placed.begin(), placed.end(), [this, &image](size_t other) {
+                return livesOverlap(image, _images[other]) && bytesOverlap(image, _images[other]);
+                });
+            if (free)
+                break;
+        }
+        heapSize = std::max(heapSize, image.offset + image.requirements.size);
+        placed.push_back(index);
+    }
+
+    for (Image& image : _images)
+    {
+        image.aliasStages = image.desc.lastStages;
+        image.aliasAccess = image.desc.lastAccess;
+        for (const Image& other : _images)
+            if (&other != &image && bytesOverlap(image, other))
+            {
+                image.aliasStages |= other.desc.lastStages;
+                image.aliasAccess |= other.desc.lastAccess;
+                image.aliased = true;
+            }
+    }
+
+    if (heapSize == 0)
+        return true; //no images, a zero sized allocation is invalid usage
+
+    _heap = std::make_unique<MemoryHeap>(_physicalDevice, _device, heapSize, typeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    bool bound = _heap->valid();
+    for (Image& image : _images)
+        bound = bound && _heap->bind(image.image, image.offset);
+    if (!bound)
+    {
+        std::cout << "TransientImages: cant allocate and bind a " << heapSize << " byte heap\n";
+        destroy();
+        return false;
+    }
+    return true;
+}
+
+void TransientImages::beginPass(VkCommandBuffer cmd, uint32_t pass) const
+{
+    std::vector<VkImageMemoryBarrier> barriers;
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+    for (const Image& image : _images)
+    {
+        if (image.desc.firstPass != pass)
+            continue;
+        //UNDEFINED discards the contents, the bytes belonged to another image (or to last frame's use of this one)
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = image.aliasAccess;
+        barrier.dstAccessMask = image.desc.firstAccess;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = image.desc.firstLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image.image;
+        barrier.subresourceRange = { image.desc.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+        barriers.push_back(barrier);
+        srcStages |= image.aliasStages;
+        dstStages |= image.desc.firstStages;
+    }
+    if (barriers.empty())
+        return;
+    vkCmdPipelineBarrier(cmd, srcStages, dstStages, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+}
+
+VkDeviceSize TransientImages::separateBytes() const
+{
+    VkDeviceSize total = 0;
+    for (const Image& image : _images)
+        total += image.requirements.size;
+    return total;
+}
+
+uint32_t TransientImages::aliasedCount() const
+{
+    return static_cast<uint32_t>(std::count_if(_images.begin(), _images.end(), [](const Image& image) { return image.aliased; }));
+}
+
+void TransientImages::destroy()
+{
+    for (Image& image : _images)
+    {
+        if (image.image != VK_NULL_HANDLE)
+            vkDestroyImage(_device, image.image, nullptr);
+        image.image = VK_NULL_HANDLE;
+    }
+    _heap.reset();
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "memoryTelemetry.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+//MTLHeap: one VkDeviceMemory block that placement buffers and images are bound into at explicit offsets
+//resources placed over the same bytes alias each other; the heap does not track them, destroy them before the heap
+//optimal tiling images next to buffers or linear images need bufferImageGranularity between them, callers choose offsets
+class MemoryHeap
+{
+public:
+    //the memory type is the first one in memoryTypeBits with all properties, pass the intersection of the
+    //memoryTypeBits of the resources meant for the heap
+    MemoryHeap(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize size, uint32_t memoryTypeBits,
+        VkMemoryPropertyFlags properties, MemoryCategory category = MemoryCategory::Image);
+    ~MemoryHeap();
+
+    MemoryHeap(const MemoryHeap&) = delete;
+    MemoryHeap& operator=(const MemoryHeap&) = delete;
+
+    bool valid() const { return _memory != VK_NULL_HANDLE; }
+    VkDeviceSize size() const { return _size; }
+    uint32_t memoryType() const { return _memoryType; }
+    VkDeviceMemory memory() const { return _memory; }
+
+    //creates the resource and binds it at offset; VK_NULL_HANDLE if it cant live in the heap there
+    VkBuffer newBuffer(const VkBufferCreateInfo& info, VkDeviceSize offset);
+    VkImage newImage(const VkImageCreateInfo& info, VkDeviceSize offset);
+
+    //binds an existing resource at offset, false if its requirements dont fit the heap there
+    bool bind(VkBuffer buffer, VkDeviceSize offset);
+    bool bind(VkImage image, VkDeviceSize offset);
+
+    bool fits(const VkMemoryRequirements& requirements, VkDeviceSize offset) const;
+
+private:
+    VkDevice _device;
+    VkDeviceSize _size = 0;
+    uint32_t _memoryType = UINT32_MAX;
+    VkDeviceMemory _memory = VK_NULL_HANDLE;
+};
+
+//transient render targets of a frame packed into one MemoryHeap: images whose pass ranges do not overlap share memory
+//passes are numbered in recording order, beginPass() emits the aliasing barriers so each image starts from the
+//previous user of its bytes (in this frame or the last one) being done
+class TransientImages
+{
+public:
+    struct Desc
+    {
+        VkImageCreateInfo info{}; //initialLayout must be UNDEFINED
+        uint32_t firstPass = 0;
+        uint32_t lastPass = 0; //inclusive
+        //how the first pass uses the image, the barrier transitions it there from UNDEFINED
+        VkImageLayout firstLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        VkPipelineStageFlags firstStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        VkAccessFlags firstAccess = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        //how the last pass uses it, the next image over the same bytes waits for that
+        VkPipelineStageFlags lastStages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        VkAccessFlags lastAccess = VK_ACCESS_SHADER_READ_BIT;
+        VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    };
+
+    TransientImages(VkPhysicalDevice physicalDevice, VkDevice device);
+    ~TransientImages();
+
+    TransientImages(const TransientImages&) = delete;
+    TransientImages& operator=(const TransientImages&) = delete;
+
+    //before build(), returns the id of the image
+    uint32_t add(const Desc& desc);
+
+    //creates the images, places them and allocates the heap; false if any step fails (nothing is left allocated)
+    bool build();
+
+    uint32_t count() const { return static_cast<uint32_t>(_images.size()); }
+    VkImage image(uint32_t id) const { return _images[id].image; }
+    VkDeviceSize offset(uint32_t id) const { return _images[id].offset; }
+
+    //records the barriers of every image whose first pass is pass, before that pass begins
+    void beginPass(VkCommandBuffer cmd, uint32_t pass) const;
+
+    //footprint with aliasing and with one allocation per image
+    VkDeviceSize heapBytes() const { return _heap ? _heap->size() : 0; }
+    VkDeviceSize separateBytes() const;
+    //images sharing memory with at least one other
+    uint32_t aliasedCount() const;
+
+    //device must be idle
+    void destroy();
+
+private:
+    struct Image
+    {
+        Desc desc;
+        VkImage image = VK_NULL_HANDLE;
+        VkMemoryRequirements requirements{};
+        VkDeviceSize offset = 0;
+        //union over the images sharing its bytes and itself, the barrier's source scope
+        VkPipelineStageFlags aliasStages = 0;
+        VkAccessFlags aliasAccess = 0;
+        bool aliased = false;
+    };
+
+    bool livesOverlap(const Image& a, const Image& b) const;
+    bool bytesOverlap(const Image& a, const Image& b) const;
+
+    VkPhysicalDevice _physicalDevice;
+    VkDevice _device;
+    std::vector<Image> _images;
+    std::unique_ptr<MemoryHeap> _heap;
+};
@@ -0,0 +1,218 @@
+#include "memoryTelemetry.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+static const char* categoryNames[size_t(MemoryCategory::Count)] = { "buffers", "images", "staging" };
+
+//without VK_EXT_memory_budget the whole heap is never ours, leave room for other processes and the driver
+static constexpr double fallbackBudgetFraction = 0.8;
+static constexpr auto budgetRefreshInterval = std::chrono::milliseconds(250);
+
+MemoryTelemetry& memoryTelemetry()
+{
+    static MemoryTelemetry telemetry;
+    return telemetry;
+}
+
+bool MemoryTelemetry::supportsBudget(VkPhysicalDevice physicalDevice)
+{
+    uint32_t count = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &count, nullptr);
+    std::vector<VkExtensionProperties> extensions(count);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &count, extensions.data());
+    return std::any_of(extensions.begin(), extensions.end(),
+        [](const VkExtensionProperties& e) {return std::strcmp(e.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0; });
+}
+
+void MemoryTelemetry::init(VkPhysicalDevice physicalDevice)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _physicalDevice = physicalDevice;
+    _budgetExtension = supportsBudget(physicalDevice);
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &_memProps);
+
+    _heaps.assign(_memProps.memoryHeapCount, HeapStats{});
+    _trackedAtRefresh.assign(_memProps.memoryHeapCount, 0);
+    for (uint32_t i = 0; i < _memProps.memoryHeapCount; ++i)
+    {
+        _heaps[i].size = _memProps.memoryHeaps[i].size;
+        _heaps[i].deviceLocal = (_memProps.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+    }
+    _allocations.clear();
+    _categoryBytes.fill(0);
+    _pipelines = 0;
+    _refused = 0;
+    _initialized = true;
+    refreshBudget();
+    _lastLog = std::chrono::steady_clock::now();
+}
+
+void MemoryTelemetry::refreshBudget()
+{
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+    budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    if (_budgetExtension)
+    {
+        VkPhysicalDeviceMemoryProperties2 props{};
+        props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        props.pNext = &budget;
+        vkGetPhysicalDeviceMemoryProperties2(_physicalDevice, &props);
+    }
+
+    for (uint32_t i = 0; i < _heaps.size(); ++i)
+    {
+        HeapStats& heap = _heaps[i];
+        if (_budgetExtension)
+        {
+            heap.budget = budget.heapBudget[i];
+            heap.usage = budget.heapUsage[i];
+        }
+        else
+        {
+            heap.budget = VkDeviceSize(double(heap.size) * fallbackBudgetFraction);
+            heap.usage = heap.tracked;
+        }
+        _trackedAtRefresh[i] = heap.tracked;
+        heap.peak = std::max(heap.peak, heap.usage);
+    }
+    _lastRefresh = std::chrono::steady_clock::now();
+    updatePressure();
+}
+
+VkDeviceSize MemoryTelemetry::predictedUsage(uint32_t heap) const
+{
+    //driver usage from the last refresh plus what we allocated or freed since
+    const HeapStats& stats = _heaps[heap];
+    const int64_t delta = int64_t(stats.tracked) - int64_t(_trackedAtRefresh[heap]);
+    return VkDeviceSize(std::max<int64_t>(int64_t(stats.usage) + delta, 0));
+}
+
+void MemoryTelemetry::updatePressure()
+{
+    bool pressure = false;
+    for (uint32_t i = 0; i < _heaps.size(); ++i)
+        pressure |= double(predictedUsage(i)) > double(_heaps[i].budget) * _threshold;
+    _underPressure.store(pressure, std::memory_order_relaxed);
+}
+
+void MemoryTelemetry::record(uint32_t heap, MemoryCategory category, int64_t bytes)
+{
+    _categoryBytes[size_t(category)] += bytes;
+    if (heap == UINT32_MAX)
+        return;
+    HeapStats& stats = _heaps[heap];
+    stats.tracked += bytes;
+    if (!_budgetExtension)
+        stats.usage = stats.tracked;
+    stats.peak = std::max(stats.peak, predictedUsage(heap));
+}
+
+VkResult MemoryTelemetry::allocate(VkDevice device, const VkMemoryAllocateInfo& allocInfo, MemoryCategory category, VkDeviceMemory& memory)
+{
+    const int64_t size = int64_t(allocInfo.allocationSize);
+    uint32_t heap = UINT32_MAX;
+    {//reserve before calling the driver so concurrent allocations cannot overshoot the budget together
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_initialized && allocInfo.memoryTypeIndex < _memProps.memoryTypeCount)
+        {
+            heap = _memProps.memoryTypes[allocInfo.memoryTypeIndex].heapIndex;
+            if (double(predictedUsage(heap) + allocInfo.allocationSize) > double(_heaps[heap].budget) * _threshold)
+            {
+                if (_refused++ == 0)
+                    std::cout << "Memory telemetry: refusing " << allocInfo.allocationSize / 1024 << " KB of " << categoryNames[size_t(category)]
+                        << ", heap " << heap << " is at " << predictedUsage(heap) / (1024 * 1024) << " of "
+                        << _heaps[heap].budget / (1024 * 1024) << " MB budget\n";
+                _underPressure.store(true, std::memory_order_relaxed);
+                memory = VK_NULL_HANDLE;
+                return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+            }
+        }
+        record(heap, category, size);
+    }
+
+    const VkResult result = vkAllocateMemory(device, &allocInfo, nullptr, &memory);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (result != VK_SUCCESS)
+    {
+        record(heap, category, -size);
+        memory = VK_NULL_HANDLE;
+    }
+    else
+        _allocations[memory] = { allocInfo.allocationSize, heap, category };
+    if (_initialized)
+        updatePressure();
+    return result;
+}
+
+void MemoryTelemetry::free(VkDevice device, VkDeviceMemory memory)
+{
+    if (memory == VK_NULL_HANDLE)
+        return;
+    {//forget the handle before the driver can hand it out again to an allocate() on another thread
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _allocations.find(memory);
+        if (it != _allocations.end()) //not found when allocated before init() reset the statistics
+        {
+            record(it->second.heap, it->second.category, -int64_t(it->second.size));
+            _allocations.erase(it);
+            if (_initialized)
+                updatePressure();
+        }
+    }
+    vkFreeMemory(device, memory, nullptr);
+}
+
+void MemoryTelemetry::update()
+{
+    const auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_initialized)
+            return;
+        if (now - _lastRefresh >= budgetRefreshInterval)
+            refreshBudget();
+        if (_logInterval.count() <= 0 || now - _lastLog < _logInterval)
+            return;
+        _lastLog = now;
+    }
+    std::cout << summary() << "\n";
+}
+
+std::vector<MemoryTelemetry::HeapStats> MemoryTelemetry::heaps() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<HeapStats> heaps = _heaps;
+    for (uint32_t i = 0; i < heaps.size(); ++i)
+        heaps[i].usage = predictedUsage(i);
+    return heaps;
+}
+
+VkDeviceSize MemoryTelemetry::categoryBytes(MemoryCategory category) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _categoryBytes[size_t(category)];
+}
+
+std::string MemoryTelemetry::summary() const
+{
+    const std::vector<HeapStats> stats = heaps();
+    constexpr double mb = 1024.0 * 1024.0;
+    std::ostringstream out;
+    out.precision(1);
+    out << std::fixed << "GPU memory" << (_budgetExtension ? "" : " (no VK_EXT_memory_budget, heap size budgets)") << ":";
+    for (uint32_t i = 0; i < stats.size(); ++i)
+    {
+        out << " heap" << i << (stats[i].deviceLocal ? "[device]" : "[host]") << " " << stats[i].usage / mb << "/" << stats[i].budget / mb
+            << " MB (ours " << stats[i].tracked / mb << ", peak " << stats[i].peak / mb << ");";
+    }
+    for (size_t c = 0; c < size_t(MemoryCategory::Count); ++c)
+        out << " " << categoryNames[c] << " " << categoryBytes(MemoryCategory(c)) / mb << " MB,";
+    out << " pipelines " << pipelineCount();
+    if (refusedAllocations() > 0)
+        out << ", refused allocations " << refusedAllocations();
+    return out.str();
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class MemoryCategory
+{
+    Buffer,
+    Image,
+    Staging, //upload and readback buffers
+    Count
+};
+
+//process wide record of every VkDeviceMemory the application allocates, per heap and per category
+//budgets come from VK_EXT_memory_budget when the device has it, otherwise a fraction of the heap size
+//allocations that would push a heap past the pressure threshold of its budget are refused before the driver starts paging,
+//producers like the texture loader check underPressure() and hold back instead
+class MemoryTelemetry
+{
+public:
+    struct HeapStats
+    {
+        VkDeviceSize size = 0;
+        VkDeviceSize budget = 0;
+        VkDeviceSize usage = 0; //whole process as reported by the driver, or only our allocations without the extension
+        VkDeviceSize tracked = 0; //our allocations
+        VkDeviceSize peak = 0; //highest usage seen
+        bool deviceLocal = false;
+    };
+
+    //true if physicalDevice has VK_EXT_memory_budget, createLogicalDevice enables it then
+    static bool supportsBudget(VkPhysicalDevice physicalDevice);
+
+    //call after device creation, resets the statistics
+    void init(VkPhysicalDevice physicalDevice);
+
+    //vkAllocateMemory with tracking; VK_ERROR_OUT_OF_DEVICE_MEMORY without calling the driver when the heap is under pressure
+    //works before init() too, only without budgets
+    VkResult allocate(VkDevice device, const VkMemoryAllocateInfo& allocInfo, MemoryCategory category, VkDeviceMemory& memory);
+    //vkFreeMemory with tracking, null handles are ignored
+    void free(VkDevice device, VkDeviceMemory memory);
+
+    //live pipelines, their memory is owned by the driver and not visible through heaps
+    void pipelineCreated() { ++_pipelines; }
+    void pipelineDestroyed() { --_pipelines; }
+
+    //render thread, once per frame: refreshes the driver budget a few times a second and prints a log line every logInterval
+    void update();
+    void setLogInterval(std::chrono::milliseconds interval) { _logInterval = interval; }
+    //fraction of the budget at which allocations are refused, 0.9 by default
+    void setPressureThreshold(double fraction) { _threshold = fraction; }
+
+    bool underPressure() const { return _underPressure.load(std::memory_order_relaxed); }
+    bool hasBudgetExtension() const { return _budgetExtension; }
+    std::vector<HeapStats> heaps() const;
+    VkDeviceSize categoryBytes(MemoryCategory category) const;
+    int64_t pipelineCount() const { return _pipelines; }
+    uint64_t refusedAllocations() const { return _refused; }
+
+    std::string summary() const;
+
+private:
+    struct Allocation
+    {
+        VkDeviceSize size;
+        uint32_t heap;
+        MemoryCategory category;
+    };
+
+    void refreshBudget(); //_mutex held
+    VkDeviceSize predictedUsage(uint32_t heap) const; //_mutex held
+    void updatePressure(); //_mutex held
+    void record(uint32_t heap, MemoryCategory category, int64_t bytes); //_mutex held
+
+    mutable std::mutex _mutex; //allocations come from worker threads too
+    VkPhysicalDevice _physicalDevice = VK_NULL_HANDLE;
+    bool _initialized = false;
+    bool _budgetExtension = false;
+    VkPhysicalDeviceMemoryProperties _memProps{};
+    std::vector<HeapStats> _heaps;
+    std::vector<VkDeviceSize> _trackedAtRefresh; //tracked bytes when the driver usage was read, per heap
+    std::unordered_map<VkDeviceMemory, Allocation> _allocations;
+    std::array<VkDeviceSize, size_t(MemoryCategory::Count)> _categoryBytes{};
+
+    std::atomic<int64_t> _pipelines{ 0 };
+    std::atomic<uint64_t> _refused{ 0 };
+    std::atomic<bool> _underPressure{ false };
+    double _threshold = 0.9;
+
+    std::chrono::steady_clock::time_point _lastRefresh;
+    std::chrono::steady_clock::time_point _lastLog;
+    std::chrono::milliseconds _logInterval{ 5000 };
+};
+
+MemoryTelemetry& memoryTelemetry();
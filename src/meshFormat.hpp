@@ -0,0 +1,35 @@
+#pragma once
+
+#include "shaderInterface.hpp"
+
+#include <cstdint>
+
+//packed mesh file written by the mesh packer tool and mapped as is by loadMesh():
+//MeshFileHeader, MeshVertex[vertexCount] at vertexOffset, indices right after the vertices
+//everything is little endian and aligned for the GPU, the payload from vertexOffset to the end is uploaded with one copy
+//triangles are clockwise seen from +z, the front face of createGraphicsPipeline; vertices are in first use order
+
+constexpr uint32_t meshFileMagic = 0x4853454d; //"MESH"
+constexpr uint32_t meshFileVersion = 1;
+
+struct MeshFileHeader
+{
+    uint32_t magic = meshFileMagic;
+    uint32_t version = meshFileVersion;
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    uint32_t indexSize = 4; //2 when every index fits 16 bits
+    uint32_t reserved = 0;
+    uint64_t vertexOffset = 0;
+    uint64_t indexOffset = 0;
+    //position = snorm position * radius + center, one radius for all axes so the shape keeps its proportions
+    float center[3] = { 0.0f, 0.0f, 0.0f };
+    float radius = 1.0f;
+    //uv = unorm uv * uvScale + uvMin
+    float uvMin[2] = { 0.0f, 0.0f };
+    float uvScale[2] = { 1.0f, 1.0f };
+};
+static_assert(sizeof(MeshFileHeader) == 72);
+
+//vertices start at the first 16 byte boundary after the header
+constexpr uint64_t meshFileVertexOffset = (sizeof(MeshFileHeader) + 15) / 16 * 16;
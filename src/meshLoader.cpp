@@ -0,0 +1,238 @@
+#include "meshLoader.hpp"
+
+#include "vulkanUtils.hpp"
+
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path)
+{
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return;
+    _file = file;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+        return;
+    _mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (_mapping == nullptr)
+        return;
+    _data = static_cast<const uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (_data != nullptr)
+        _size = static_cast<size_t>(size.QuadPart);
+}
+
+MappedFile::~MappedFile()
+{
+    if (_data != nullptr)
+        UnmapViewOfFile(_data);
+    if (_mapping != nullptr)
+        CloseHandle(_mapping);
+    if (_file != nullptr)
+        CloseHandle(_file);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path)
+{
+    const int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return;
+    struct stat info;
+    if (fstat(file, &info) == 0 && info.st_size > 0)
+    {
+        void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        if (data != MAP_FAILED)
+        {
+            //read front to back once into the staging buffer
+            madvise(data, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+            _data = static_cast<const uint8_t*>(data);
+            _size = static_cast<size_t>(info.st_size);
+        }
+    }
+    close(file); //the mapping keeps its own reference
+}
+
+MappedFile::~MappedFile()
+{
+    if (_data != nullptr)
+        munmap(const_cast<uint8_t*>(_data), _size);
+}
+
+#endif
+
+bool uploadMesh(VkPhysicalDevice physicalDevice, VkDevice device, QueueTimeline& timeline, const void* vertices, VkDeviceSize vertexBytes,
+    const void* indices, VkDeviceSize indexBytes, Mesh& mesh)
+{
+    const VkDeviceSize size = vertexBytes + indexBytes;
+    VkBuffer staging;
+    VkDeviceMemory stagingMemory;
+    if (!createBuffer(physicalDevice, device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging, stagingMemory, MemoryCategory::Staging))
+    {
+        std::cout << "uploadMesh: cant allocate a " << size << " byte staging buffer\n";
+        return false;
+    }
+    void* mapped;
+    if (vkMapMemory(device, stagingMemory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+    {
+        std::cout << "uploadMesh: cant map the staging buffer\n";
+        vkDestroyBuffer(device, staging, nullptr);
+        memoryTelemetry().free(device, stagingMemory);
+        return false;
+    }
+    std::memcpy(mapped, vertices, static_cast<size_t>(vertexBytes));
+    std::memcpy(static_cast<uint8_t*>(mapped) + vertexBytes, indices, static_cast<size_t>(indexBytes));
+    vkUnmapMemory(device, stagingMemory);
+
+    bool uploaded = createBuffer(physicalDevice, device, size,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh.buffer, mesh.memory);
+    if (!uploaded)
+        std::cout << "uploadMesh: cant allocate a " << size << " byte vertex buffer\n";
+
+    VkCommandPool pool = VK_NULL_HANDLE;
+    if (uploaded)
+    {
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = timeline.family();
+        VkCommandBuffer cmd;
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        uploaded = vkCreateCommandPool(device, &poolInfo, nullptr, &pool) == VK_SUCCESS;
+        allocInfo.commandPool = pool;
+        uploaded = uploaded && vkAllocateCommandBuffers(device, &allocInfo, &cmd) == VK_SUCCESS &&
+            vkBeginCommandBuffer(cmd, &beginInfo) == VK_SUCCESS;
+        if (uploaded)
+        {
+            VkBufferCopy region{ 0, 0, size };
+            vkCmdCopyBuffer(cmd, staging, mesh.buffer, 1, &region);
+
+            VkBufferMemoryBarrier toVertexInput{};
+            toVertexInput.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            toVertexInput.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            toVertexInput.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+            toVertexInput.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            toVertexInput.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            toVertexInput.buffer = mesh.buffer;
+            toVertexInput.offset = 0;
+            toVertexInput.size = VK_WHOLE_SIZE;
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0,
+                0, nullptr, 1, &toVertexInput, 0, nullptr);
+
+            const uint64_t value = vkEndCommandBuffer(cmd) == VK_SUCCESS ? timeline.submit(&cmd, 1) : 0;
+            uploaded = value != 0 && timeline.wait(value);
+        }
+        if (!uploaded)
+            std::cout << "uploadMesh: copy to the vertex buffer failed\n";
+    }
+
+    if (pool != VK_NULL_HANDLE)
+        vkDestroyCommandPool(device, pool, nullptr);
+    vkDestroyBuffer(device, staging, nullptr);
+    memoryTelemetry().free(device, stagingMemory);
+    if (!uploaded)
+    {
+        destroyMesh(device, mesh);
+        return false;
+    }
+    mesh.indexOffset = vertexBytes;
+    return true;
+}
+
+template<typename Index>
+static bool indicesBelow(const uint8_t* indices, uint32_t indexCount, uint32_t vertexCount)
+{
+    for (uint32_t i = 0; i < indexCount; ++i)
+    {
+        Index index;
+        std::memcpy(&index, indices + size_t(i) * sizeof(Index), sizeof(Index));
+        if (index >= vertexCount)
+            return false;
+    }
+    return true;
+}
+
+bool loadMesh(VkPhysicalDevice physicalDevice, VkDevice device, QueueTimeline& timeline, const std::string& path, Mesh& mesh)
+{
+    MappedFile file(path);
+    if (!file.valid())
+    {
+        std::cout << "loadMesh: cant map \"" << path << "\"\n";
+        return false;
+    }
+
+    MeshFileHeader header;
+    if (file.size() < sizeof(header))
+    {
+        std::cout << "loadMesh: \"" << path << "\" is too small for a mesh header\n";
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != meshFileMagic || header.version != meshFileVersion)
+    {
+        std::cout << "loadMesh: \"" << path << "\" is not a version " << meshFileVersion << " packed mesh\n";
+        return false;
+    }
+    const uint64_t vertexBytes = uint64_t(header.vertexCount) * sizeof(MeshVertex);
+    const uint64_t indexBytes = uint64_t(header.indexCount) * header.indexSize;
+    //offsets and sizes come from the file, compare them against what is left instead of adding them so nothing wraps
+    const bool consistent = (header.indexSize == 2 || header.indexSize == 4) && header.vertexOffset >= sizeof(header) &&
+        header.vertexOffset % 16 == 0 && header.vertexOffset <= file.size() && vertexBytes <= file.size() - header.vertexOffset &&
+        header.indexOffset >= header.vertexOffset && header.indexOffset - header.vertexOffset == vertexBytes &&
+        indexBytes <= file.size() - header.indexOffset && header.indexCount % 3 == 0 && header.indexCount > 0;
+    if (!consistent)
+    {
+        std::cout << "loadMesh: \"" << path << "\" has a header that does not match its contents\n";
+        return false;
+    }
+
+    const uint8_t* payload = file.data();
+    //robustBufferAccess is not enabled, an index past the vertices would read outside the buffer on the GPU
+    const bool indicesInRange = header.indexSize == 2 ?
+        indicesBelow<uint16_t>(payload + header.indexOffset, header.indexCount, header.vertexCount) :
+        indicesBelow<uint32_t>(payload + header.indexOffset, header.indexCount, header.vertexCount);
+    if (!indicesInRange)
+    {
+        std::cout << "loadMesh: \"" << path << "\" has indices past its " << header.vertexCount << " vertices\n";
+        return false;
+    }
+    if (!uploadMesh(physicalDevice, device, timeline, payload + header.vertexOffset, vertexBytes, payload + header.indexOffset, indexBytes, mesh))
+        return false;
+    mesh.indexType = header.indexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    mesh.vertexCount = header.vertexCount;
+    mesh.indexCount = header.indexCount;
+    mesh.header = header;
+    return true;
+}
+
+void destroyMesh(VkDevice device, Mesh& mesh)
+{
+    if (mesh.buffer != VK_NULL_HANDLE)
+        vkDestroyBuffer(device, mesh.buffer, nullptr);
+    memoryTelemetry().free(device, mesh.memory);
+    mesh.buffer = VK_NULL_HANDLE;
+    mesh.memory = VK_NULL_HANDLE;
+}
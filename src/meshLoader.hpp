@@ -0,0 +1,58 @@
+#pragma once
+
+#include "meshFormat.hpp"
+#include "queueTimeline.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//read only view of a whole file, mmap on POSIX and a file mapping on Windows
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool valid() const { return _data != nullptr; }
+    const uint8_t* data() const { return _data; }
+    size_t size() const { return _size; }
+
+private:
+    const uint8_t* _data = nullptr;
+    size_t _size = 0;
+#ifdef _WIN32
+    void* _file = nullptr;
+    void* _mapping = nullptr;
+#endif
+};
+
+//vertices and indices in one device local buffer, bind it as both
+struct Mesh
+{
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize indexOffset = 0;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    MeshFileHeader header; //bounds and uv range for dequantizing on the CPU
+};
+
+//copies vertexBytes then indexBytes into a staging buffer and from there into mesh.buffer on timeline's queue,
+//returns once the copy finished; indexBytes must start 4 byte aligned after the vertices
+//false with a message on std::cout on failure, nothing is left allocated then
+bool uploadMesh(VkPhysicalDevice physicalDevice, VkDevice device, QueueTimeline& timeline, const void* vertices, VkDeviceSize vertexBytes,
+    const void* indices, VkDeviceSize indexBytes, Mesh& mesh);
+
+//maps a packed mesh file, checks the header against the file size and the indices against the vertex count,
+//then uploads the payload as is
+bool loadMesh(VkPhysicalDevice physicalDevice, VkDevice device, QueueTimeline& timeline, const std::string& path, Mesh& mesh);
+
+//GPU must be done with the mesh
+void destroyMesh(VkDevice device, Mesh& mesh);
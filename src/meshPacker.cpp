@@ -0,0 +1,500 @@
+#include "meshPacker.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+namespace
+{
+struct CornerKey
+{
+    int32_t position;
+    int32_t uv;     //-1 when the face has none
+    int32_t normal; //-1 when the face has none
+
+    bool operator==(const CornerKey& other) const
+    {
+        return position == other.position && uv == other.uv && normal == other.normal;
+    }
+};
+
+struct CornerKeyHash
+{
+    size_t operator()(const CornerKey& key) const
+    {
+        return (size_t(uint32_t(key.position)) * 73856093u) ^ (size_t(uint32_t(key.uv)) * 19349663u) ^ (size_t(uint32_t(key.normal)) * 83492791u);
+    }
+};
+
+//OBJ indices are 1 based, negative ones count back from the last element read so far; -1 if out of range
+int32_t resolveIndex(long index, size_t count)
+{
+    const long resolved = index < 0 ? long(count) + index : index - 1;
+    return resolved >= 0 && resolved < long(count) ? int32_t(resolved) : -1;
+}
+
+const char* skipSpaces(const char* c)
+{
+    while (*c == ' ' || *c == '\t')
+        ++c;
+    return c;
+}
+
+//reads up to count floats, the ones missing stay 0
+void readFloats(const char* c, float* out, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        char* end;
+        out[i] = std::strtof(c, &end);
+        if (end == c)
+            return;
+        c = end;
+    }
+}
+
+constexpr uint32_t forsythCacheSize = 32;
+
+float vertexScore(int32_t cachePosition, uint32_t remaining)
+{
+    if (remaining == 0)
+        return -1.0f;
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+            score = 0.75f; //vertices of the triangle just emitted, fixed so the next one does not always share an edge with it
+        else
+            score = std::pow(1.0f - float(cachePosition - 3) / (forsythCacheSize - 3), 1.5f);
+    }
+    //vertices with few triangles left get finished instead of being left behind to miss later
+    return score + 2.0f / std::sqrt(float(remaining));
+}
+
+int16_t toSnorm16(float value)
+{
+    return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+uint16_t toUnorm16(float value)
+{
+    return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+//same conversion as the VK_FORMAT_*_SNORM vertex fetch
+float fromSnorm16(int16_t value)
+{
+    return std::max(float(value) / 32767.0f, -1.0f);
+}
+}
+
+bool loadObj(const std::string& path, MeshData& mesh)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cout << "loadObj: cant open \"" << path << "\"\n";
+        return false;
+    }
+
+    mesh = {};
+    std::vector<float> positions;
+    std::vector<float> uvs;
+    std::vector<float> normals;
+    std::unordered_map<CornerKey, uint32_t, CornerKeyHash> lookup;
+    std::vector<int32_t> vertexPosition; //position index of every vertex, for the normals computed from faces
+    bool missingNormals = false;
+
+    std::string line;
+    std::vector<uint32_t> face;
+    size_t lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        ++lineNumber;
+        const char* c = skipSpaces(line.c_str());
+        if (c[0] == 'v' && (c[1] == ' ' || c[1] == '\t'))
+        {
+            positions.resize(positions.size() + 3);
+            readFloats(c + 1, &positions[positions.size() - 3], 3);
+        }
+        else if (c[0] == 'v' && c[1] == 't' && (c[2] == ' ' || c[2] == '\t'))
+        {
+            uvs.resize(uvs.size() + 2);
+            readFloats(c + 2, &uvs[uvs.size() - 2], 2);
+        }
+        else if (c[0] == 'v' && c[1] == 'n' && (c[2] == ' ' || c[2] == '\t'))
+        {
+            normals.resize(normals.size() + 3);
+            readFloats(c + 2, &normals[normals.size() - 3], 3);
+        }
+        else if (c[0] == 'f' && (c[1] == ' ' || c[1] == '\t'))
+        {
+            face.clear();
+            c = skipSpaces(c + 1);
+            while (*c != '\0' && *c != '\r' && *c != '#')
+            {
+                char* end;
+                CornerKey key{ resolveIndex(std::strtol(c, &end, 10), positions.size() / 3), -1, -1 };
+                bool valid = end != c && key.position >= 0;
+                c = end;
+                if (*c == '/')
+                {
+                    ++c;
+                    if (*c != '/')
+                    {//a/b or a/b/c
+                        key.uv = resolveIndex(std::strtol(c, &end, 10), uvs.size() / 2);
+                        valid = valid && end != c && key.uv >= 0;
+                        c = end;
+                    }
+                    if (*c == '/')
+                    {
+                        ++c;
+                        key.normal = resolveIndex(std::strtol(c, &end, 10), normals.size() / 3);
+                        valid = valid && end != c && key.normal >= 0;
+                        c = end;
+                    }
+                }
+                if (!valid)
+                {
+                    std::cout << "loadObj: bad face index in \"" << path << "\" line " << lineNumber << "\n";
+                    return false;
+                }
+
+                auto [it, inserted] = lookup.try_emplace(key, static_cast<uint32_t>(mesh.vertices.size()));
+                if (inserted)
+                {
+                    FloatVertex vertex{};
+                    std::copy_n(&positions[3 * key.position], 3, vertex.position);
+                    if (key.uv >= 0)
+                        std::copy_n(&uvs[2 * key.uv], 2, vertex.uv);
+                    if (key.normal >= 0)
+                        std::copy_n(&normals[3 * key.normal], 3, vertex.normal);
+                    else
+                        missingNormals = true;
+                    mesh.vertices.push_back(vertex);
+                    vertexPosition.push_back(key.normal >= 0 ? -1 : key.position);
+                }
+                face.push_back(it->second);
+                c = skipSpaces(c);
+            }
+            for (size_t k = 1; k + 1 < face.size(); ++k)
+                mesh.indices.insert(mesh.indices.end(), { face[0], face[k], face[k + 1] });
+        }
+    }
+
+    if (mesh.indices.empty())
+    {
+        std::cout << "loadObj: no triangles in \"" << path << "\"\n";
+        return false;
+    }
+
+    if (missingNormals)
+    {//area weighted face normals summed per position, so vertices split by uv seams still share one normal
+        std::vector<float> sums(positions.size(), 0.0f);
+        for (size_t i = 0; i < mesh.indices.size(); i += 3)
+        {
+            const float* a = mesh.vertices[mesh.indices[i]].position;
+            const float* b = mesh.vertices[mesh.indices[i + 1]].position;
+            const float* c = mesh.vertices[mesh.indices[i + 2]].position;
+            const float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            const float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+            const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            for (size_t k = 0; k < 3; ++k)
+            {
+                const int32_t position = vertexPosition[mesh.indices[i + k]];
+                if (position >= 0)
+                    for (int axis = 0; axis < 3; ++axis)
+                        sums[3 * position + axis] += n[axis];
+            }
+        }
+        for (size_t v = 0; v < mesh.vertices.size(); ++v)
+            if (vertexPosition[v] >= 0)
+                std::copy_n(&sums[3 * vertexPosition[v]], 3, mesh.vertices[v].normal);
+    }
+    return true;
+}
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    //triangles of every vertex, the first remaining[v] entries of its range are the ones not emitted yet
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+        ++remaining[indices[i]];
+    std::vector<uint32_t> firstTriangle(vertexCount + 1, 0);
+    for (uint32_t v = 0; v < vertexCount; ++v)
+        firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    {
+        std::vector<uint32_t> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; ++i)
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<int32_t> cachePosition(vertexCount, -1);
+    std::vector<float> score(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; ++v)
+        score[v] = vertexScore(-1, remaining[v]);
+    std::vector<float> triangleScore(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t)
+        triangleScore[t] = score[indices[3 * t]] + score[indices[3 * t + 1]] + score[indices[3 * t + 2]];
+    std::vector<bool> emitted(triangleCount, false);
+
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> nextCache;
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+    size_t cursor = 0; //input order fallback when no triangle touches the cache
+    int64_t best = -1;
+    while (output.size() < triangleCount * 3)
+    {
+        if (best < 0)
+        {
+            while (emitted[cursor])
+                ++cursor;
+            best = static_cast<int64_t>(cursor);
+        }
+        const uint32_t triangle[3] = { indices[3 * best], indices[3 * best + 1], indices[3 * best + 2] };
+        emitted[best] = true;
+        output.insert(output.end(), triangle, triangle + 3);
+
+        nextCache.clear();
+        for (uint32_t v : triangle)
+        {
+            uint32_t* first = &adjacency[firstTriangle[v]];
+            uint32_t* last = first + remaining[v];
+            uint32_t* found = std::find(first, last, static_cast<uint32_t>(best));
+            if (found != last)
+            {
+                std::swap(*found, *(last - 1));
+                --remaining[v];
+            }
+            if (std::find(nextCache.begin(), nextCache.end(), v) == nextCache.end())
+                nextCache.push_back(v);
+        }
+        for (uint32_t v : cache)
+            if (std::find(nextCache.begin(), nextCache.end(), v) == nextCache.end())
+                nextCache.push_back(v);
+
+        //vertices pushed past the end fall out of the cache, their triangles are rescored too
+        for (size_t i = 0; i < nextCache.size(); ++i)
+        {
+            const uint32_t v = nextCache[i];
+            cachePosition[v] = i < forsythCacheSize ? static_cast<int32_t>(i) : -1;
+            score[v] = vertexScore(cachePosition[v], remaining[v]);
+        }
+        best = -1;
+        float bestScore = -1.0f;
+        for (uint32_t v : nextCache)
+        {
+            for (uint32_t i = firstTriangle[v]; i < firstTriangle[v] + remaining[v]; ++i)
+            {
+                const uint32_t t = adjacency[i];
+                triangleScore[t] = score[indices[3 * t]] + score[indices[3 * t + 1]] + score[indices[3 * t + 2]];
+                if (triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+        if (nextCache.size() > forsythCacheSize)
+            nextCache.resize(forsythCacheSize);
+        cache.swap(nextCache);
+    }
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+void optimizeVertexFetch(MeshData& mesh)
+{
+    std::vector<uint32_t> remap(mesh.vertices.size(), UINT32_MAX);
+    uint32_t next = 0;
+    for (uint32_t& index : mesh.indices)
+    {
+        if (remap[index] == UINT32_MAX)
+            remap[index] = next++;
+        index = remap[index];
+    }
+    //vertices no triangle uses are dropped
+    std::vector<FloatVertex> vertices(next);
+    for (size_t v = 0; v < mesh.vertices.size(); ++v)
+        if (remap[v] != UINT32_MAX)
+            vertices[remap[v]] = mesh.vertices[v];
+    mesh.vertices.swap(vertices);
+}
+
+double averageCacheMissRatio(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+    if (indices.size() < 3)
+        return 0.0;
+    //FIFO: a vertex is cached while fewer than cacheSize others were inserted after it
+    std::vector<uint64_t> inserted(vertexCount, 0);
+    uint64_t time = uint64_t(cacheSize) + 1;
+    uint64_t misses = 0;
+    for (uint32_t index : indices)
+    {
+        if (time - inserted[index] > cacheSize)
+        {
+            inserted[index] = time++;
+            ++misses;
+        }
+    }
+    return double(misses) / double(indices.size() / 3);
+}
+
+void octEncode(const float normal[3], float encoded[2])
+{
+    const float l1 = std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+    if (l1 == 0.0f)
+    {
+        encoded[0] = encoded[1] = 0.0f;
+        return;
+    }
+    float x = normal[0] / l1;
+    float y = normal[1] / l1;
+    if (normal[2] < 0.0f)
+    {//lower hemisphere folded over the diagonals
+        const float foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float foldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+    encoded[0] = x;
+    encoded[1] = y;
+}
+
+void octDecode(const float encoded[2], float normal[3])
+{
+    float n[3] = { encoded[0], encoded[1], 1.0f - std::abs(encoded[0]) - std::abs(encoded[1]) };
+    const float t = std::max(-n[2], 0.0f);
+    n[0] += n[0] >= 0.0f ? -t : t;
+    n[1] += n[1] >= 0.0f ? -t : t;
+    const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    for (int axis = 0; axis < 3; ++axis)
+        normal[axis] = n[axis] / length;
+}
+
+PackedMesh packMesh(const MeshData& mesh)
+{
+    PackedMesh packed;
+    MeshFileHeader& header = packed.header;
+
+    float low[3] = { INFINITY, INFINITY, INFINITY };
+    float high[3] = { -INFINITY, -INFINITY, -INFINITY };
+    float uvLow[2] = { INFINITY, INFINITY };
+    float uvHigh[2] = { -INFINITY, -INFINITY };
+    for (const FloatVertex& vertex : mesh.vertices)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            low[axis] = std::min(low[axis], vertex.position[axis]);
+            high[axis] = std::max(high[axis], vertex.position[axis]);
+        }
+        for (int axis = 0; axis < 2; ++axis)
+        {
+            uvLow[axis] = std::min(uvLow[axis], vertex.uv[axis]);
+            uvHigh[axis] = std::max(uvHigh[axis], vertex.uv[axis]);
+        }
+    }
+    header.radius = 0.0f;
+    for (int axis = 0; axis < 3 && !mesh.vertices.empty(); ++axis)
+    {
+        header.center[axis] = (low[axis] + high[axis]) * 0.5f;
+        header.radius = std::max(header.radius, (high[axis] - low[axis]) * 0.5f);
+    }
+    if (header.radius <= 0.0f)
+        header.radius = 1.0f;
+    for (int axis = 0; axis < 2 && !mesh.vertices.empty(); ++axis)
+    {
+        header.uvMin[axis] = uvLow[axis];
+        header.uvScale[axis] = uvHigh[axis] > uvLow[axis] ? uvHigh[axis] - uvLow[axis] : 1.0f;
+    }
+
+    packed.vertices.resize(mesh.vertices.size());
+    for (size_t v = 0; v < mesh.vertices.size(); ++v)
+    {
+        const FloatVertex& source = mesh.vertices[v];
+        MeshVertex& vertex = packed.vertices[v];
+        for (int axis = 0; axis < 3; ++axis)
+            vertex.position[axis] = toSnorm16((source.position[axis] - header.center[axis]) / header.radius);
+        vertex.position[3] = 0;
+        float encoded[2];
+        octEncode(source.normal, encoded);
+        vertex.normal[0] = toSnorm16(encoded[0]);
+        vertex.normal[1] = toSnorm16(encoded[1]);
+        for (int axis = 0; axis < 2; ++axis)
+            vertex.uv[axis] = toUnorm16((source.uv[axis] - header.uvMin[axis]) / header.uvScale[axis]);
+    }
+
+    packed.indices.reserve(mesh.indices.size());
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        packed.indices.insert(packed.indices.end(), { mesh.indices[i], mesh.indices[i + 2], mesh.indices[i + 1] });
+
+    header.vertexCount = static_cast<uint32_t>(packed.vertices.size());
+    header.indexCount = static_cast<uint32_t>(packed.indices.size());
+    header.indexSize = packed.vertices.size() <= 0x10000 ? 2 : 4;
+    header.vertexOffset = meshFileVertexOffset;
+    header.indexOffset = header.vertexOffset + uint64_t(header.vertexCount) * sizeof(MeshVertex);
+    return packed;
+}
+
+void quantizationError(const MeshData& mesh, const PackedMesh& packed, double& positionError, double& normalErrorDegrees)
+{
+    const MeshFileHeader& header = packed.header;
+    positionError = 0.0;
+    normalErrorDegrees = 0.0;
+    for (size_t v = 0; v < mesh.vertices.size() && v < packed.vertices.size(); ++v)
+    {
+        const FloatVertex& source = mesh.vertices[v];
+        const MeshVertex& vertex = packed.vertices[v];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const double decoded = fromSnorm16(vertex.position[axis]) * header.radius + header.center[axis];
+            positionError = std::max(positionError, std::abs(decoded - source.position[axis]) / header.radius);
+        }
+
+        const float length = std::sqrt(source.normal[0] * source.normal[0] + source.normal[1] * source.normal[1] + source.normal[2] * source.normal[2]);
+        if (length == 0.0f)
+            continue;
+        const float encoded[2] = { fromSnorm16(vertex.normal[0]), fromSnorm16(vertex.normal[1]) };
+        float decoded[3];
+        octDecode(encoded, decoded);
+        const double cosine = (decoded[0] * source.normal[0] + decoded[1] * source.normal[1] + decoded[2] * source.normal[2]) / length;
+        normalErrorDegrees = std::max(normalErrorDegrees, std::acos(std::clamp(cosine, -1.0, 1.0)) * 180.0 / 3.14159265358979);
+    }
+}
+
+bool writePackedMesh(const std::string& path, const PackedMesh& packed)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cout << "writePackedMesh: cant create \"" << path << "\"\n";
+        return false;
+    }
+    const MeshFileHeader& header = packed.header;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    const char padding[meshFileVertexOffset - sizeof(MeshFileHeader)]{};
+    file.write(padding, sizeof(padding));
+    file.write(reinterpret_cast<const char*>(packed.vertices.data()), packed.vertices.size() * sizeof(MeshVertex));
+    if (header.indexSize == 2)
+    {
+        std::vector<uint16_t> narrow(packed.indices.begin(), packed.indices.end());
+        file.write(reinterpret_cast<const char*>(narrow.data()), narrow.size() * sizeof(uint16_t));
+    }
+    else
+        file.write(reinterpret_cast<const char*>(packed.indices.data()), packed.indices.size() * sizeof(uint32_t));
+    if (!file)
+    {
+        std::cout << "writePackedMesh: cant write \"" << path << "\"\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "meshFormat.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//offline side of the packed mesh format, used by tools/meshPacker.cpp and the benchmarks
+
+//the unpacked vertex, also the naive 32 byte layout the packed one is measured against
+struct FloatVertex
+{
+    float position[3];
+    float normal[3];
+    float uv[2];
+};
+
+struct MeshData
+{
+    std::vector<FloatVertex> vertices;
+    std::vector<uint32_t> indices; //triangle list, counter clockwise like OBJ
+};
+
+//Wavefront OBJ: v, vt, vn and f (polygons are fanned, negative indices allowed); everything else is skipped
+//vertices are deduplicated per position/uv/normal triple, missing normals are averaged from the faces
+//returns false with a message on std::cout if the file cant be read or has no triangles
+bool loadObj(const std::string& path, MeshData& mesh);
+
+//reorders triangles for the post transform vertex cache (Forsyth's linear speed optimizer), the mesh stays the same
+void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount);
+//renumbers vertices in first use order so the vertex fetch walks the buffer forwards; call after optimizeVertexCache
+void optimizeVertexFetch(MeshData& mesh);
+
+//transformed vertices per triangle with a FIFO cache of cacheSize entries: 3 without reuse, about 0.5 at best on a grid
+double averageCacheMissRatio(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = 16);
+
+//octahedral normal encoding in -1..1, decode is the same math as mesh.vert
+void octEncode(const float normal[3], float encoded[2]);
+void octDecode(const float encoded[2], float normal[3]);
+
+struct PackedMesh
+{
+    MeshFileHeader header;
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices; //written as 16 bit when header.indexSize is 2; clockwise
+};
+
+//quantizes the vertices and flips the winding to the renderer's front face, the header offsets are filled in
+PackedMesh packMesh(const MeshData& mesh);
+
+//largest position error relative to the radius and largest normal error in degrees of a packed mesh against its source
+void quantizationError(const MeshData& mesh, const PackedMesh& packed, double& positionError, double& normalErrorDegrees);
+
+//false with a message on std::cout on failure
+bool writePackedMesh(const std::string& path, const PackedMesh& packed);
@@ -0,0 +1,282 @@
+#include "pixelConvert.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PIXEL_CONVERT_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+//GCC and clang only allow the intrinsics inside functions compiled for that instruction set, MSVC always allows them
+#if defined(PIXEL_CONVERT_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSSE3
+#define TARGET_AVX2
+#endif
+
+PixelKernelLevel detectPixelKernelLevel()
+{
+    static const PixelKernelLevel level = []() -> PixelKernelLevel {
+#if defined(PIXEL_CONVERT_X86) && (defined(__GNUC__) || defined(__clang__))
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return PixelKernelLevel::AVX2;
+        if (__builtin_cpu_supports("ssse3"))
+            return PixelKernelLevel::SSSE3;
+#elif defined(PIXEL_CONVERT_X86) && defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+        const bool ssse3 = (info[2] & (1 << 9)) != 0;
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        __cpuidex(info, 7, 0);
+        const bool avx2 = (info[1] & (1 << 5)) != 0;
+        if (avx2 && osxsave && (_xgetbv(0) & 6) == 6) //OS saves ymm registers
+            return PixelKernelLevel::AVX2;
+        if (ssse3)
+            return PixelKernelLevel::SSSE3;
+#endif
+        return PixelKernelLevel::Scalar;
+        }();
+    return level;
+}
+
+const char* pixelKernelLevelName(PixelKernelLevel level)
+{
+    switch (level)
+    {
+    case PixelKernelLevel::AVX2: return "AVX2";
+    case PixelKernelLevel::SSSE3: return "SSSE3";
+    default: return "Scalar";
+    }
+}
+
+//-------------------------------------------------- scalar
+
+//swapRB selects between rgb and bgr source order
+static void expand3To4Scalar(const uint8_t* src, uint8_t* dst, size_t pixelCount, bool swapRB)
+{
+    const int r = swapRB ? 2 : 0;
+    const int b = swapRB ? 0 : 2;
+    for (size_t i = 0; i < pixelCount; ++i)
+    {
+        dst[0] = src[r];
+        dst[1] = src[1];
+        dst[2] = src[b];
+        dst[3] = 255;
+        src += 3;
+        dst += 4;
+    }
+}
+
+static void swizzleRBScalar(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+{
+    for (size_t i = 0; i < pixelCount; ++i)
+    {
+        const uint8_t b = src[0]; //read everything first so src == dst works
+        const uint8_t g = src[1];
+        const uint8_t r = src[2];
+        const uint8_t a = src[3];
+        dst[0] = r;
+        dst[1] = g;
+        dst[2] = b;
+        dst[3] = a;
+        src += 4;
+        dst += 4;
+    }
+}
+
+#ifdef PIXEL_CONVERT_X86
+
+//-------------------------------------------------- SSSE3
+
+//16 pixels (48 bytes) per iteration, split into four registers holding 4 pixels each without reading past the source
+TARGET_SSSE3 static size_t expand3To4SSSE3(const uint8_t* src, uint8_t* dst, size_t pixelCount, bool swapRB)
+{
+    const __m128i mask = swapRB ?
+        _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+        _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+
+    size_t i = 0;
+    for (; i + 16 <= pixelCount; i += 16)
+    {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3 + 16));
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3 + 32));
+
+        const __m128i p0 = a;                           //bytes 0..11
+        const __m128i p1 = _mm_alignr_epi8(b, a, 12);   //bytes 12..23
+        const __m128i p2 = _mm_alignr_epi8(c, b, 8);    //bytes 24..35
+        const __m128i p3 = _mm_srli_si128(c, 4);        //bytes 36..47
+
+        __m128i* out = reinterpret_cast<__m128i*>(dst + i * 4);
+        _mm_storeu_si128(out + 0, _mm_or_si128(_mm_shuffle_epi8(p0, mask), alpha));
+        _mm_storeu_si128(out + 1, _mm_or_si128(_mm_shuffle_epi8(p1, mask), alpha));
+        _mm_storeu_si128(out + 2, _mm_or_si128(_mm_shuffle_epi8(p2, mask), alpha));
+        _mm_storeu_si128(out + 3, _mm_or_si128(_mm_shuffle_epi8(p3, mask), alpha));
+    }
+    return i;
+}
+
+TARGET_SSSE3 static size_t swizzleRBSSSE3(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+{
+    const __m128i mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+    size_t i = 0;
+    for (; i + 4 <= pixelCount; i += 4)
+    {
+        const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_shuffle_epi8(p, mask));
+    }
+    return i;
+}
+
+//-------------------------------------------------- AVX2
+
+//same split as the SSSE3 version, the 4 pixel groups are paired into ymm registers so the shuffle/or/store work is halved
+TARGET_AVX2 static size_t expand3To4AVX2(const uint8_t* src, uint8_t* dst, size_t pixelCount, bool swapRB)
+{
+    const __m256i mask = swapRB ?
+        _mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+                         2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+        _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                         0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+
+    size_t i = 0;
+    for (; i + 16 <= pixelCount; i += 16)
+    {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3 + 16));
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3 + 32));
+
+        const __m256i p01 = _mm256_set_m128i(_mm_alignr_epi8(b, a, 12), a);
+        const __m256i p23 = _mm256_set_m128i(_mm_srli_si128(c, 4), _mm_alignr_epi8(c, b, 8));
+
+        __m256i* out = reinterpret_cast<__m256i*>(dst + i * 4);
+        _mm256_storeu_si256(out + 0, _mm256_or_si256(_mm256_shuffle_epi8(p01, mask), alpha));
+        _mm256_storeu_si256(out + 1, _mm256_or_si256(_mm256_shuffle_epi8(p23, mask), alpha));
+    }
+    return i;
+}
+
+TARGET_AVX2 static size_t swizzleRBAVX2(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+{
+    const __m256i mask = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                          2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+    size_t i = 0;
+    for (; i + 16 <= pixelCount; i += 16)
+    {
+        const __m256i p0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+        const __m256i p1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4 + 32));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), _mm256_shuffle_epi8(p0, mask));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4 + 32), _mm256_shuffle_epi8(p1, mask));
+    }
+    return i;
+}
+
+#endif // PIXEL_CONVERT_X86
+
+//-------------------------------------------------- dispatch
+
+//vector kernels return how many pixels they converted, the scalar code finishes the tail
+static void expand3To4(const uint8_t* src, uint8_t* dst, size_t pixelCount, bool swapRB, PixelKernelLevel level)
+{
+    size_t done = 0;
+#ifdef PIXEL_CONVERT_X86
+    if (level == PixelKernelLevel::AVX2)
+        done = expand3To4AVX2(src, dst, pixelCount, swapRB);
+    else if (level == PixelKernelLevel::SSSE3)
+        done = expand3To4SSSE3(src, dst, pixelCount, swapRB);
+#endif
+    expand3To4Scalar(src + done * 3, dst + done * 4, pixelCount - done, swapRB);
+}
+
+void rgb8ToRgba8(const uint8_t* src, uint8_t* dst, size_t pixelCount, PixelKernelLevel level)
+{
+    expand3To4(src, dst, pixelCount, false, level);
+}
+
+void bgr8ToRgba8(const uint8_t* src, uint8_t* dst, size_t pixelCount, PixelKernelLevel level)
+{
+    expand3To4(src, dst, pixelCount, true, level);
+}
+
+void bgra8ToRgba8(const uint8_t* src, uint8_t* dst, size_t pixelCount, PixelKernelLevel level)
+{
+    size_t done = 0;
+#ifdef PIXEL_CONVERT_X86
+    if (level == PixelKernelLevel::AVX2)
+        done = swizzleRBAVX2(src, dst, pixelCount);
+    else if (level == PixelKernelLevel::SSSE3)
+        done = swizzleRBSSSE3(src, dst, pixelCount);
+#endif
+    swizzleRBScalar(src + done * 4, dst + done * 4, pixelCount - done);
+}
+
+void rgb8ToRgba8(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+{
+    rgb8ToRgba8(src, dst, pixelCount, detectPixelKernelLevel());
+}
+
+void bgr8ToRgba8(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+{
+    bgr8ToRgba8(src, dst, pixelCount, detectPixelKernelLevel());
+}
+
+void bgra8ToRgba8(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+{
+    bgra8ToRgba8(src, dst, pixelCount, detectPixelKernelLevel());
+}
+
+//-------------------------------------------------- benchmark
+
+void benchmarkPixelConversion()
+{
+    constexpr size_t pixelCount = 2048 * 2048;
+    constexpr int runs = 20;
+
+    std::vector<uint8_t> src(pixelCount * 4);
+    std::vector<uint8_t> dst(pixelCount * 4);
+    for (size_t i = 0; i < src.size(); ++i)
+        src[i] = static_cast<uint8_t>(i * 31 + 7);
+
+    using Kernel = void(*)(const uint8_t*, uint8_t*, size_t, PixelKernelLevel);
+    const std::pair<const char*, Kernel> kernels[] = {
+        { "rgb8ToRgba8", static_cast<Kernel>(rgb8ToRgba8) },
+        { "bgr8ToRgba8", static_cast<Kernel>(bgr8ToRgba8) },
+        { "bgra8ToRgba8", static_cast<Kernel>(bgra8ToRgba8) },
+    };
+
+    std::cout << "Pixel conversion throughput, " << pixelCount << " texels, best of " << runs << " runs\n";
+    const PixelKernelLevel best = detectPixelKernelLevel();
+    for (const auto& [name, kernel] : kernels)
+    {
+        for (PixelKernelLevel level : { PixelKernelLevel::Scalar, PixelKernelLevel::SSSE3, PixelKernelLevel::AVX2 })
+        {
+            if (level > best)
+                break;
+
+            double bestSeconds = 1e9;
+            for (int run = 0; run < runs; ++run)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                kernel(src.data(), dst.data(), pixelCount, level);
+                const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                bestSeconds = std::min(bestSeconds, elapsed.count());
+            }
+
+            std::cout << "  " << name << " " << pixelKernelLevelName(level) << ": "
+                << (pixelCount / bestSeconds) / 1e6 << " Mtexels/s\n";
+        }
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//CPU pixel format conversion used by the texture loader
+//every kernel has a scalar fallback, SSSE3 and AVX2 versions are picked at runtime when the CPU supports them
+
+enum class PixelKernelLevel
+{
+    Scalar,
+    SSSE3,
+    AVX2
+};
+
+//best level supported by this CPU (Scalar on non x86 builds)
+PixelKernelLevel detectPixelKernelLevel();
+const char* pixelKernelLevelName(PixelKernelLevel level);
+
+//3 bytes per pixel -> 4 bytes per pixel, alpha set to 255
+void rgb8ToRgba8(const uint8_t* src, uint8_t* dst, size_t pixelCount);
+void bgr8ToRgba8(const uint8_t* src, uint8_t* dst, size_t pixelCount);
+
+//swaps R and B channels, src and dst can be the same buffer
+void bgra8ToRgba8(const uint8_t* src, uint8_t* dst, size_t pixelCount);
+
+//same as above but forced to a specific level, level must not be above detectPixelKernelLevel()
+void rgb8ToRgba8(const uint8_t* src, uint8_t* dst, size_t pixelCount, PixelKernelLevel level);
+void bgr8ToRgba8(const uint8_t* src, uint8_t* dst, size_t pixelCount, PixelKernelLevel level);
+void bgra8ToRgba8(const uint8_t* src, uint8_t* dst, size_t pixelCount, PixelKernelLevel level);
+
+//prints texels/sec of every kernel at every supported level
+void benchmarkPixelConversion();
@@ -0,0 +1,67 @@
+#include "queuePool.hpp"
+
+#include <algorithm>
+
+VkResult QueuePool::Queue::submit(uint32_t submitCount, const VkSubmitInfo* submits, VkFence fence)
+{
+    std::lock_guard<std::mutex> lock(_submitMutex);
+    return vkQueueSubmit(_handle, submitCount, submits, fence);
+}
+
+VkResult QueuePool::Queue::present(const VkPresentInfoKHR* presentInfo)
+{
+    std::lock_guard<std::mutex> lock(_submitMutex);
+    return vkQueuePresentKHR(_handle, presentInfo);
+}
+
+VkResult QueuePool::Queue::waitIdle()
+{
+    std::lock_guard<std::mutex> lock(_submitMutex);
+    return vkQueueWaitIdle(_handle);
+}
+
+QueuePool::QueuePool(VkDevice device, const QueuePlan& plan)
+{
+    for (const FamilyQueues& family : plan)
+    {
+        const size_t first = _queues.size();
+        for (uint32_t i = 0; i < family.priorities.size(); ++i)
+        {
+            auto queue = std::make_unique<Queue>();
+            vkGetDeviceQueue(device, family.family, i, &queue->_handle);
+            queue->_family = family.family;
+            queue->_index = i;
+            queue->_priority = family.priorities[i];
+            _queues.push_back(std::move(queue));
+        }
+        std::stable_sort(_queues.begin() + first, _queues.end(),
+            [](const auto& a, const auto& b) {return a->_priority > b->_priority; });
+    }
+}
+
+QueuePool::Queue* QueuePool::acquire(uint32_t family)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    Queue* best = nullptr;
+    for (const auto& queue : _queues)
+    {
+        if (queue->_family == family && (best == nullptr || queue->_users < best->_users))
+            best = queue.get();
+    }
+    if (best != nullptr)
+        ++best->_users;
+    return best;
+}
+
+void QueuePool::release(Queue* queue)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (queue != nullptr && queue->_users > 0)
+        --queue->_users;
+}
+
+uint32_t QueuePool::queueCount(uint32_t family) const
+{
+    return static_cast<uint32_t>(std::count_if(_queues.begin(), _queues.end(),
+        [family](const auto& queue) {return queue->_family == family; }));
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//queues created for one family, one priority per queue
+struct FamilyQueues
+{
+    uint32_t family;
+    std::vector<float> priorities;
+};
+using QueuePlan = std::vector<FamilyQueues>;
+
+//owns every queue the device was created with and leases them to submitting threads
+//a thread with its own queue never contends with anyone, queues are only shared once a family runs out
+class QueuePool
+{
+public:
+    class Queue
+    {
+    public:
+        VkQueue handle() const { return _handle; }
+        uint32_t family() const { return _family; }
+        uint32_t index() const { return _index; }
+        float priority() const { return _priority; }
+        //more than one lease, submits then serialize on this queue's mutex (never on a pool wide one)
+        bool shared() const { return _users > 1; }
+
+        //vkQueueSubmit/vkQueuePresentKHR with the external synchronization the spec requires for the VkQueue
+        VkResult submit(uint32_t submitCount, const VkSubmitInfo* submits, VkFence fence);
+        VkResult present(const VkPresentInfoKHR* presentInfo);
+        //vkQueueWaitIdle, e.g. before destroying a swapchain whose presents may still be queued
+        VkResult waitIdle();
+
+    private:
+        friend class QueuePool;
+
+        VkQueue _handle = VK_NULL_HANDLE;
+        uint32_t _family = 0;
+        uint32_t _index = 0;
+        float _priority = 1.0f;
+        std::atomic<uint32_t> _users{ 0 }; //changed under the pool mutex
+        std::mutex _submitMutex; //uncontended unless shared
+    };
+
+    //plan must be the one the device was created with
+    QueuePool(VkDevice device, const QueuePlan& plan);
+
+    QueuePool(const QueuePool&) = delete;
+    QueuePool& operator=(const QueuePool&) = delete;
+
+    //an unused queue of family, else the least used one (shared from then on); nullptr if the family has no queues
+    //queues with a higher priority are handed out first
+    Queue* acquire(uint32_t family);
+    void release(Queue* queue);
+
+    uint32_t queueCount(uint32_t family) const;
+    uint32_t queueCount() const { return static_cast<uint32_t>(_queues.size()); }
+
+private:
+    std::mutex _mutex; //acquire/release only
+    std::vector<std::unique_ptr<Queue>> _queues; //grouped by family, highest priority first
+};
@@ -0,0 +1,172 @@
+#include "queueTimeline.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+QueueTimeline::QueueTimeline(VkDevice device, QueuePool::Queue& queue)
+    : _device(device), _queue(&queue)
+{
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+    if (vkCreateSemaphore(_device, &semaphoreInfo, nullptr, &_semaphore) != VK_SUCCESS)
+    {
+        std::cout << "QueueTimeline: cant create timeline semaphore for family " << queue.family() << "\n";
+        _semaphore = VK_NULL_HANDLE;
+    }
+}
+
+QueueTimeline::~QueueTimeline()
+{
+    destroy();
+}
+
+uint64_t QueueTimeline::submit(const VkCommandBuffer* cmdBuffers, uint32_t cmdBufferCount, const std::vector<Wait>& waits,
+    const std::vector<VkSemaphore>& binarySignals)
+{
+    const uint64_t signalValue = lastSubmitted() + 1;
+
+    //small fixed arrays, a submit has a handful of semaphores at most
+    constexpr size_t maxSemaphores = 8;
+    VkSemaphore waitSemaphores[maxSemaphores];
+    uint64_t waitValues[maxSemaphores];
+    VkPipelineStageFlags waitStages[maxSemaphores];
+    VkSemaphore signalSemaphores[maxSemaphores];
+    uint64_t signalValues[maxSemaphores];
+    if (waits.size() > maxSemaphores || binarySignals.size() + 1 > maxSemaphores)
+    {
+        std::cout << "QueueTimeline: too many semaphores in one submit\n";
+        return 0;
+    }
+
+    for (size_t i = 0; i < waits.size(); ++i)
+    {
+        waitSemaphores[i] = waits[i].semaphore;
+        waitValues[i] = waits[i].value; //ignored for binary semaphores
+        waitStages[i] = waits[i].stage;
+    }
+    signalSemaphores[0] = _semaphore;
+    signalValues[0] = signalValue;
+    for (size_t i = 0; i < binarySignals.size(); ++i)
+    {
+        signalSemaphores[i + 1] = binarySignals[i];
+        signalValues[i + 1] = 0;
+    }
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waits.size());
+    timelineInfo.pWaitSemaphoreValues = waitValues;
+    timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(binarySignals.size() + 1);
+    timelineInfo.pSignalSemaphoreValues = signalValues;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waits.size());
+    submitInfo.pWaitSemaphores = waitSemaphores;
+    submitInfo.pWaitDstStageMask = waitStages;
+    submitInfo.commandBufferCount = cmdBufferCount;
+    submitInfo.pCommandBuffers = cmdBuffers;
+    submitInfo.signalSemaphoreCount = static_cast<uint32_t>(binarySignals.size() + 1);
+    submitInfo.pSignalSemaphores = signalSemaphores;
+
+    if (_queue->submit(1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+        return 0;
+    _lastSubmitted.store(signalValue, std::memory_order_release);
+    return signalValue;
+}
+
+uint64_t QueueTimeline::completed()
+{
+    uint64_t value;
+    if (vkGetSemaphoreCounterValue(_device, _semaphore, &value) == VK_SUCCESS)
+        _completed = value;
+    return _completed;
+}
+
+bool QueueTimeline::isComplete(uint64_t value)
+{
+    return value <= _completed || value <= completed();
+}
+
+bool QueueTimeline::wait(uint64_t value, uint64_t timeoutNs)
+{
+    if (value <= _completed)
+        return true;
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &_semaphore;
+    waitInfo.pValues = &value;
+    if (vkWaitSemaphores(_device, &waitInfo, timeoutNs) != VK_SUCCESS)
+        return false;
+    _completed = std::max(_completed, value);
+    return true;
+}
+
+void QueueTimeline::destroy()
+{
+    if (_semaphore != VK_NULL_HANDLE)
+        vkDestroySemaphore(_device, _semaphore, nullptr);
+    _semaphore = VK_NULL_HANDLE;
+}
+
+DeviceTimelines::DeviceTimelines(VkDevice device, QueuePool& pool, uint32_t graphicsFamily, uint32_t computeFamily, uint32_t transferFamily)
+    : _pool(pool)
+{
+    _graphics = timelineFor(device, graphicsFamily);
+    _compute = timelineFor(device, computeFamily);
+    _transfer = timelineFor(device, transferFamily);
+}
+
+QueueTimeline* DeviceTimelines::timelineFor(VkDevice device, uint32_t family)
+{
+    QueuePool::Queue* queue = _pool.acquire(family);
+    if (queue == nullptr)
+        return nullptr;
+    for (const auto& timeline : _timelines)
+    {
+        if (&timeline->queue() == queue)
+        {
+            _pool.release(queue); //same queue as an earlier role, keep a single lease
+            return timeline.get();
+        }
+    }
+    _timelines.push_back(std::make_unique<QueueTimeline>(device, *queue));
+    return _timelines.back().get();
+}
+
+bool DeviceTimelines::valid() const
+{
+    if (_graphics == nullptr || _compute == nullptr || _transfer == nullptr)
+        return false;
+    for (const auto& timeline : _timelines)
+    {
+        if (!timeline->valid())
+            return false;
+    }
+    return true;
+}
+
+void DeviceTimelines::waitIdle()
+{
+    for (const auto& timeline : _timelines)
+        timeline->waitIdle();
+}
+
+void DeviceTimelines::destroy()
+{
+    for (const auto& timeline : _timelines)
+    {
+        if (timeline->valid())
+            _pool.release(&timeline->queue());
+        timeline->destroy();
+    }
+}
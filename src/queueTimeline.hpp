@@ -0,0 +1,99 @@
+#pragma once
+
+#include "queuePool.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+//one timeline semaphore per queue, every submit signals the next value
+//so "is this work done" is a counter comparison and cross queue dependencies are waits on another queue's value
+//not thread safe, one timeline belongs to one submitting thread; the queue itself may be shared through the pool
+class QueueTimeline
+{
+public:
+    //a wait on another queue's timeline (or a binary semaphore when value is 0)
+    struct Wait
+    {
+        VkSemaphore semaphore;
+        uint64_t value;
+        VkPipelineStageFlags stage;
+    };
+
+    QueueTimeline() = default;
+    QueueTimeline(VkDevice device, QueuePool::Queue& queue);
+    ~QueueTimeline();
+
+    QueueTimeline(const QueueTimeline&) = delete;
+    QueueTimeline& operator=(const QueueTimeline&) = delete;
+
+    bool valid() const { return _semaphore != VK_NULL_HANDLE; }
+
+    QueuePool::Queue& queue() const { return *_queue; }
+    uint32_t family() const { return _queue->family(); }
+    VkSemaphore semaphore() const { return _semaphore; }
+
+    //submits and returns the timeline value signaled when cmdBuffers finish, 0 on failure
+    //binarySignals are for the swapchain, which cannot use timeline semaphores
+    uint64_t submit(const VkCommandBuffer* cmdBuffers, uint32_t cmdBufferCount, const std::vector<Wait>& waits = {},
+        const std::vector<VkSemaphore>& binarySignals = {});
+
+    //wait for the value in another queue's command stream
+    Wait after(uint64_t value, VkPipelineStageFlags stage) const { return { _semaphore, value, stage }; }
+
+    //any thread
+    uint64_t lastSubmitted() const { return _lastSubmitted.load(std::memory_order_acquire); }
+
+    //cached, only queries the semaphore when value is beyond what was seen completed so far
+    bool isComplete(uint64_t value);
+    uint64_t completed();
+
+    //blocks until value is reached, false on timeout or device loss
+    bool wait(uint64_t value, uint64_t timeoutNs = UINT64_MAX);
+    bool waitIdle() { return wait(lastSubmitted()); }
+
+    //device must be idle
+    void destroy();
+
+private:
+    VkDevice _device = VK_NULL_HANDLE;
+    QueuePool::Queue* _queue = nullptr;
+    VkSemaphore _semaphore = VK_NULL_HANDLE;
+    std::atomic<uint64_t> _lastSubmitted{ 0 }; //written by the submitting thread, read by deletion queues on any thread
+    uint64_t _completed = 0;
+};
+
+//timelines of the graphics, compute and transfer roles, each role leases its queue from the pool
+//roles that end up on the same queue share one timeline, a queue must only ever signal its own counter in order
+class DeviceTimelines
+{
+public:
+    DeviceTimelines(VkDevice device, QueuePool& pool, uint32_t graphicsFamily, uint32_t computeFamily, uint32_t transferFamily);
+    ~DeviceTimelines() { destroy(); }
+
+    DeviceTimelines(const DeviceTimelines&) = delete;
+    DeviceTimelines& operator=(const DeviceTimelines&) = delete;
+
+    bool valid() const;
+
+    QueueTimeline& graphics() { return *_graphics; }
+    QueueTimeline& compute() { return *_compute; }
+    QueueTimeline& transfer() { return *_transfer; }
+
+    //blocks until everything submitted through any of the timelines finished
+    void waitIdle();
+    //device must be idle, the queues go back to the pool; no-op when already destroyed
+    void destroy();
+
+private:
+    QueueTimeline* timelineFor(VkDevice device, uint32_t family);
+
+    QueuePool& _pool;
+    std::vector<std::unique_ptr<QueueTimeline>> _timelines;
+    QueueTimeline* _graphics = nullptr;
+    QueueTimeline* _compute = nullptr;
+    QueueTimeline* _transfer = nullptr;
+};
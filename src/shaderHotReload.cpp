@@ -0,0 +1,326 @@
+#include "shaderHotReload.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <cstdlib>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+//editors usually save through several writes/renames, wait for the folder to settle before compiling
+static constexpr int debounceMs = 100;
+
+ShaderHotReload::ShaderHotReload(VkDevice device, std::string sourceFolder, std::string outputFolder, std::string compilerPath)
+    : _device(device), _sourceFolder(std::move(sourceFolder)), _outputFolder(std::move(outputFolder)), _compiler(std::move(compilerPath))
+{
+}
+
+ShaderHotReload::~ShaderHotReload()
+{
+    stopWorker();
+#ifdef __linux__
+    if (_wakeFd >= 0)
+        close(_wakeFd);
+#endif
+}
+
+void ShaderHotReload::addPipeline(ShaderSource vertex, ShaderSource fragment, PipelineHandle* target, PipelineBuilder builder)
+{
+    _entries.push_back({ std::move(vertex), std::move(fragment), target, std::move(builder) });
+}
+
+void ShaderHotReload::start()
+{
+#ifdef __linux__
+    if (_compiler.empty())
+    {
+        std::cout << "Shader hot reload disabled, no glslc found\n";
+        return;
+    }
+    if (!std::filesystem::is_directory(_sourceFolder))
+    {
+        std::cout << "Shader hot reload disabled, folder \"" << _sourceFolder << "\" not found\n";
+        return;
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(_outputFolder, ec);
+    if (ec)
+    {
+        std::cout << "Shader hot reload disabled, cant create \"" << _outputFolder << "\": " << ec.message() << "\n";
+        return;
+    }
+    //left over from an earlier run, maybe of older sources; stages are compiled again the first time they are needed
+    for (const Entry& e : _entries)
+    {
+        std::filesystem::remove(_outputFolder + "/" + e.vertex.spirv, ec);
+        std::filesystem::remove(_outputFolder + "/" + e.fragment.spirv, ec);
+    }
+    _wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (_wakeFd < 0)
+    {
+        std::cout << "Shader hot reload disabled, eventfd failed\n";
+        return;
+    }
+    _worker = std::thread(&ShaderHotReload::watchLoop, this);
+    std::cout << "Watching \"" << _sourceFolder << "\" for shader changes, compiling into \"" << _outputFolder << "\"\n";
+#else
+    std::cout << "Shader hot reload is only supported on Linux\n";
+#endif
+}
+
+void ShaderHotReload::applyPending()
+{
+    std::unique_lock<std::mutex> lock(_pendingMutex, std::try_to_lock);
+    if (!lock.owns_lock())
+        return;
+    for (const Pending& p : _pending)
+    {
+        //the old pipeline goes to the target's deletion queue, frames already submitted with it keep it alive
+        _entries[p.entry].target->reset(p.pipeline);
+        std::cout << "Shader hot reload: swapped pipeline " << p.entry << "\n";
+    }
+    _pending.clear();
+}
+
+void ShaderHotReload::shutdown()
+{
+    stopWorker();
+
+    std::lock_guard<std::mutex> lock(_pendingMutex);
+    for (const Pending& p : _pending)
+        destroyPipeline(_device, p.pipeline, nullptr);
+    _pending.clear();
+}
+
+void ShaderHotReload::stopWorker()
+{
+    _stop = true;
+#ifdef __linux__
+    if (_wakeFd >= 0)
+    {
+        uint64_t one = 1;
+        (void)!write(_wakeFd, &one, sizeof(one));
+    }
+#endif
+    if (_worker.joinable())
+        _worker.join();
+}
+
+void ShaderHotReload::watchLoop()
+{
+#ifdef __linux__
+    int inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0)
+    {
+        std::cout << "Shader hot reload: inotify_init1 failed, errno " << errno << "\n";
+        return;
+    }
+    //IN_MOVED_TO catches editors that save through a temporary file and rename
+    if (inotify_add_watch(inotifyFd, _sourceFolder.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        std::cout << "Shader hot reload: inotify_add_watch failed, errno " << errno << "\n";
+        close(inotifyFd);
+        return;
+    }
+
+    std::set<std::string> watched;
+    for (const Entry& e : _entries)
+    {
+        watched.insert(e.vertex.source);
+        watched.insert(e.fragment.source);
+    }
+
+    pollfd fds[2]{};
+    fds[0].fd = inotifyFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = _wakeFd;
+    fds[1].events = POLLIN;
+
+    std::set<std::string> changed;
+    alignas(inotify_event) char buffer[4096];
+
+    while (!_stop)
+    {
+        int ready = poll(fds, 2, changed.empty() ? -1 : debounceMs);
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (_stop || (fds[1].revents & POLLIN))
+            break;
+
+        if (ready == 0)
+        {//folder settled
+            rebuild(std::vector<std::string>(changed.begin(), changed.end()));
+            changed.clear();
+            continue;
+        }
+
+        ssize_t len;
+        while ((len = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+        {
+            for (char* ptr = buffer; ptr < buffer + len; )
+            {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+                if (event->len > 0 && watched.count(event->name))
+                    changed.insert(event->name);
+                ptr += sizeof(inotify_event) + event->len;
+            }
+        }
+    }
+
+    close(inotifyFd);
+#endif
+}
+
+void ShaderHotReload::rebuild(const std::vector<std::string>& changedFiles)
+{
+    auto isChanged = [&changedFiles](const ShaderSource& shader) -> bool {
+        return std::find(changedFiles.begin(), changedFiles.end(), shader.source) != changedFiles.end();
+        };
+
+    //compile each changed source once even if several pipelines share it
+    std::set<std::string> compiled, failed;
+    for (const Entry& e : _entries)
+    {
+        for (const ShaderSource* shader : { &e.vertex, &e.fragment })
+        {
+            if (!isChanged(*shader) || compiled.count(shader->source) || failed.count(shader->source))
+                continue;
+            if (compile(*shader))
+                compiled.insert(shader->source);
+            else
+                failed.insert(shader->source);
+        }
+    }
+
+    for (size_t i = 0; i < _entries.size(); ++i)
+    {
+        const Entry& e = _entries[i];
+        if (!isChanged(e.vertex) && !isChanged(e.fragment))
+            continue;
+        if (failed.count(e.vertex.source) || failed.count(e.fragment.source))
+        {
+            std::cout << "Shader hot reload: keeping old pipeline " << i << "\n";
+            continue;
+        }
+
+        //a pipeline with one changed stage needs the other one compiled into the output folder too
+        bool stagesReady = true;
+        for (const ShaderSource* shader : { &e.vertex, &e.fragment })
+        {
+            if (compiled.count(shader->source) || std::filesystem::exists(_outputFolder + "/" + shader->spirv))
+                continue;
+            if (compile(*shader))
+                compiled.insert(shader->source);
+            else
+                stagesReady = false;
+        }
+        if (!stagesReady)
+        {
+            std::cout << "Shader hot reload: keeping old pipeline " << i << "\n";
+            continue;
+        }
+
+        VkShaderModule vertexShader = loadModule(e.vertex.spirv);
+        VkShaderModule fragmentShader = loadModule(e.fragment.spirv);
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        if (vertexShader != VK_NULL_HANDLE && fragmentShader != VK_NULL_HANDLE)
+            pipeline = e.builder(vertexShader, fragmentShader);
+
+        if (vertexShader != VK_NULL_HANDLE)
+            vkDestroyShaderModule(_device, vertexShader, nullptr);
+        if (fragmentShader != VK_NULL_HANDLE)
+            vkDestroyShaderModule(_device, fragmentShader, nullptr);
+
+        if (pipeline == VK_NULL_HANDLE)
+        {
+            std::cout << "Shader hot reload: failed to rebuild pipeline " << i << ", keeping old one\n";
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(_pendingMutex);
+        auto it = std::find_if(_pending.begin(), _pending.end(), [i](const Pending& p) {return p.entry == i; });
+        if (it != _pending.end())
+        {//never bound by the render loop, safe to destroy right away
+            destroyPipeline(_device, it->pipeline, nullptr);
+            it->pipeline = pipeline;
+        }
+        else
+            _pending.push_back({ i, pipeline });
+        _published.fetch_add(1, std::memory_order_release);
+    }
+}
+
+bool ShaderHotReload::compile(const ShaderSource& shader) const
+{
+    const std::string source = _sourceFolder + "/" + shader.source;
+    const std::string output = _outputFolder + "/" + shader.spirv;
+    const std::string tmpOutput = output + ".tmp";
+
+    std::ostringstream command;
+    command << "\"" << _compiler << "\" \"" << source << "\" -o \"" << tmpOutput << "\"";
+
+    if (std::system(command.str().c_str()) != 0)
+    {
+        std::cout << "Shader hot reload: compiling \"" << shader.source << "\" failed\n";
+        std::error_code ec;
+        std::filesystem::remove(tmpOutput, ec);
+        return false;
+    }
+
+    //rename so the .spv is never observed half written
+    std::error_code ec;
+    std::filesystem::rename(tmpOutput, output, ec);
+    if (ec)
+    {
+        std::cout << "Shader hot reload: cant replace \"" << output << "\": " << ec.message() << "\n";
+        return false;
+    }
+    return true;
+}
+
+VkShaderModule ShaderHotReload::loadModule(const std::string& spirvFile) const
+{
+    std::ifstream file(_outputFolder + "/" + spirvFile, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cout << "Shader hot reload: cant open \"" << spirvFile << "\"\n";
+        return VK_NULL_HANDLE;
+    }
+
+    std::size_t fileSize = static_cast<std::size_t>(file.tellg());
+    if (fileSize == 0 || fileSize % sizeof(uint32_t) != 0)
+    {
+        std::cout << "Shader hot reload: \"" << spirvFile << "\" is not valid SPIR-V\n";
+        return VK_NULL_HANDLE;
+    }
+
+    std::vector<uint32_t> code(fileSize / sizeof(uint32_t));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(code.data()), fileSize);
+
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = fileSize;
+    createInfo.pCode = code.data();
+
+    VkShaderModule shader = VK_NULL_HANDLE;
+    if (vkCreateShaderModule(_device, &createInfo, nullptr, &shader) != VK_SUCCESS)
+    {
+        std::cout << "Shader hot reload: cant create shader module from \"" << spirvFile << "\"\n";
+        return VK_NULL_HANDLE;
+    }
+    return shader;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "deviceHandle.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//watches the GLSL source folder, recompiles changed sources on a worker thread and rebuilds every pipeline using them
+//the SPIR-V goes to a separate output folder so editing a shader never touches the source tree or the build's shaders
+//new pipelines are handed to the render loop which swaps them in at a frame boundary, so the loop never waits on the compiler or driver
+class ShaderHotReload
+{
+public:
+    struct ShaderSource
+    {
+        std::string source; //GLSL file name relative to the source folder, e.g. "shader.vert"
+        std::string spirv;  //compiled output relative to the output folder, e.g. "vert.spv"
+    };
+
+    //called on the worker thread; must return VK_NULL_HANDLE on failure instead of exiting
+    using PipelineBuilder = std::function<VkPipeline(VkShaderModule vertexShader, VkShaderModule fragmentShader)>;
+
+    //outputFolder is created by start(); with an empty compilerPath hot reload stays disabled
+    ShaderHotReload(VkDevice device, std::string sourceFolder, std::string outputFolder, std::string compilerPath);
+    ~ShaderHotReload();
+
+    ShaderHotReload(const ShaderHotReload&) = delete;
+    ShaderHotReload& operator=(const ShaderHotReload&) = delete;
+
+    //target is the pipeline the render loop binds, applyPending() resets it to the rebuilt pipeline; give it a deletion
+    //queue so the replaced pipeline outlives the frames still using it; must be called before start()
+    void addPipeline(ShaderSource vertex, ShaderSource fragment, PipelineHandle* target, PipelineBuilder builder);
+
+    void start();
+
+    //call once per frame on the render thread, before the frame is submitted
+    //never blocks, if the worker is publishing at the same moment the swap is simply picked up next frame
+    void applyPending();
+
+    //number of rebuilt pipelines handed to the render loop so far, any thread; a change means the next frame looks different
+    uint64_t publishedCount() const { return _published.load(std::memory_order_acquire); }
+
+    //stops the watcher and destroys the rebuilt pipelines that were never swapped in
+    void shutdown();
+
+private:
+    struct Entry
+    {
+        ShaderSource vertex;
+        ShaderSource fragment;
+        PipelineHandle* target;
+        PipelineBuilder builder;
+    };
+
+    struct Pending
+    {
+        size_t entry;
+        VkPipeline pipeline;
+    };
+
+    void stopWorker();
+    void watchLoop();
+    void rebuild(const std::vector<std::string>& changedFiles);
+    bool compile(const ShaderSource& shader) const;
+    VkShaderModule loadModule(const std::string& spirvFile) const;
+
+    VkDevice _device;
+    std::string _sourceFolder;
+    std::string _outputFolder;
+    std::string _compiler;
+
+    std::vector<Entry> _entries;
+
+    std::mutex _pendingMutex;
+    std::vector<Pending> _pending;
+    std::atomic<uint64_t> _published{ 0 };
+
+    std::thread _worker;
+    std::atomic<bool> _stop{ false };
+    int _wakeFd = -1;
+};
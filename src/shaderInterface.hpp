@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//CPU side of the data declared in src/shaders, keep both in sync
+
+//push_constant block of shader.vert, 128 bytes is the guaranteed minimum maxPushConstantsSize
+struct DrawPushConstants
+{
+    float offset[2] = { 0.0f, 0.0f };
+    float scale = 1.0f;
+};
+static_assert(sizeof(DrawPushConstants) <= 128);
+
+//set 0 binding 0 (std140) of shader.frag, one instance per frame from the FrameAllocator
+struct alignas(16) FrameUniforms
+{
+    float tint[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+};
+
+constexpr VkShaderStageFlags drawPushConstantStages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+//binding 0 of mesh.vert, quantized: 16 bytes where plain floats (position, normal, uv) take 32
+//the SNORM/UNORM formats expand the integers in the vertex fetch, the shader only decodes the octahedral normal
+struct MeshVertex
+{
+    int16_t position[4]; //inside the mesh bounds, see MeshFileHeader; w unused
+    int16_t normal[2];   //octahedral encoding
+    uint16_t uv[2];      //inside the mesh uv range
+};
+static_assert(sizeof(MeshVertex) == 16);
+
+inline std::vector<VkVertexInputBindingDescription> meshVertexBindings()
+{
+    return { { 0, sizeof(MeshVertex), VK_VERTEX_INPUT_RATE_VERTEX } };
+}
+
+//every format here has mandatory VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT support
+inline std::vector<VkVertexInputAttributeDescription> meshVertexAttributes()
+{
+    return {
+        { 0, 0, VK_FORMAT_R16G16B16A16_SNORM, offsetof(MeshVertex, position) },
+        { 1, 0, VK_FORMAT_R16G16_SNORM, offsetof(MeshVertex, normal) },
+        { 2, 0, VK_FORMAT_R16G16_UNORM, offsetof(MeshVertex, uv) },
+    };
+}
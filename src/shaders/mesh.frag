@@ -0,0 +1,17 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform FrameUniforms {
+    vec4 tint;
+} frame;
+
+layout(location = 0) in vec3 inNormal;
+layout(location = 1) in vec2 inUV;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    //fixed light from the upper left of the viewer, a faint uv checker shows the texture coordinates survived packing
+    float light = max(dot(normalize(inNormal), normalize(vec3(-0.4, 0.6, 0.7))), 0.0);
+    float checker = mod(floor(inUV.x * 16.0) + floor(inUV.y * 16.0), 2.0);
+    outColor = vec4(frame.tint.rgb * (0.25 + 0.75 * light) * (0.9 + 0.1 * checker), frame.tint.a);
+}
@@ -0,0 +1,29 @@
+#version 450
+
+layout(push_constant) uniform DrawPushConstants {
+    vec2 offset;
+    float scale;
+} draw;
+
+//MeshVertex, the SNORM/UNORM vertex formats already expanded the quantized values
+layout(location = 0) in vec4 inPosition; //-1..1 inside the mesh bounds
+layout(location = 1) in vec2 inNormal;   //octahedral
+layout(location = 2) in vec2 inUV;
+
+layout(location = 0) out vec3 outNormal;
+layout(location = 1) out vec2 outUV;
+
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main() {
+    //y is up in the file, down in clip space; there is no depth attachment, back face culling hides the far side
+    gl_Position = vec4(vec2(inPosition.x, -inPosition.y) * draw.scale + draw.offset, inPosition.z * 0.5 + 0.5, 1.0);
+    outNormal = octDecode(inNormal);
+    outUV = inUV;
+}
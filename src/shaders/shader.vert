@@ -1,5 +1,10 @@
 #version 450
 
+layout(push_constant) uniform DrawPushConstants {
+    vec2 offset;
+    float scale;
+} draw;
+
 vec2 positions[3] = vec2[](
     vec2(0.0, -0.5),
     vec2(0.5, 0.5),
@@ -7,5 +12,5 @@ vec2 positions[3] = vec2[](
 );
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
+    gl_Position = vec4(positions[gl_VertexIndex] * draw.scale + draw.offset, 0.0, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//lock-free bounded queue for exactly one producer thread and one consumer thread
+//head and tail are free running counters on separate cache lines, the blocking variants sleep on them with atomic wait
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+    //producer; false when full
+    bool tryPush(const T& value)
+    {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head.load(std::memory_order_acquire) == Capacity)
+            return false;
+        _items[tail & (Capacity - 1)] = value;
+        _tail.store(tail + 1, std::memory_order_release);
+        _tail.notify_one();
+        return true;
+    }
+
+    //producer; waits for the consumer to make room
+    void push(const T& value)
+    {
+        for (;;)
+        {
+            const size_t head = _head.load(std::memory_order_acquire);
+            if (tryPush(value))
+                return;
+            _head.wait(head, std::memory_order_acquire);
+        }
+    }
+
+    //consumer; false when empty
+    bool tryPop(T& value)
+    {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire))
+            return false;
+        value = _items[head & (Capacity - 1)];
+        _head.store(head + 1, std::memory_order_release);
+        _head.notify_one();
+        return true;
+    }
+
+    //consumer; waits for the producer
+    void pop(T& value)
+    {
+        for (;;)
+        {
+            const size_t tail = _tail.load(std::memory_order_acquire);
+            if (tryPop(value))
+                return;
+            _tail.wait(tail, std::memory_order_acquire);
+        }
+    }
+
+    //approximate unless called from the producer or consumer
+    size_t size() const { return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire); }
+
+private:
+    static constexpr size_t cacheLine = 64;
+
+    alignas(cacheLine) std::atomic<size_t> _head{ 0 }; //written by the consumer
+    alignas(cacheLine) std::atomic<size_t> _tail{ 0 }; //written by the producer
+    alignas(cacheLine) T _items[Capacity];
+};
@@ -0,0 +1,570 @@
+#include "texture.hpp"
+
+#include "imageWrite.hpp"
+#include "pixelConvert.hpp"
+#include "vulkanUtils.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static constexpr VkFormat textureFormat = VK_FORMAT_R8G8B8A8_SRGB;
+//longest a worker holds a decoded image back because of memory pressure before trying the allocation anyway
+static constexpr int stagingPressureWaitMs = 2000;
+
+static bool readWholeFile(const std::string& path, std::vector<uint8_t>& data)
+{
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+        return false;
+    data.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(data.data()), data.size());
+    return static_cast<bool>(file);
+}
+
+//layout of the decoded file pixels before conversion
+struct RawImage
+{
+    enum class Layout { RGB, BGR, BGRA } layout;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    const uint8_t* pixels = nullptr;
+    bool bottomUp = false;
+};
+
+static bool parsePPM(const std::vector<uint8_t>& data, RawImage& image)
+{
+    PpmHeader header;
+    if (!parsePPM(data.data(), data.size(), header))
+        return false;
+
+    image.layout = RawImage::Layout::RGB;
+    image.width = header.width;
+    image.height = header.height;
+    image.pixels = data.data() + header.pixelOffset;
+    image.bottomUp = false;
+    return true;
+}
+
+static bool parseTGA(const std::vector<uint8_t>& data, RawImage& image)
+{
+    constexpr size_t headerSize = 18;
+    if (data.size() < headerSize)
+        return false;
+
+    const uint8_t idLength = data[0];
+    const uint8_t colorMapType = data[1];
+    const uint8_t imageType = data[2];
+    const uint32_t width = data[12] | (data[13] << 8);
+    const uint32_t height = data[14] | (data[15] << 8);
+    const uint8_t depth = data[16];
+    const uint8_t descriptor = data[17];
+
+    //only uncompressed true color without a palette
+    if (colorMapType != 0 || imageType != 2 || (depth != 24 && depth != 32) || width == 0 || height == 0)
+        return false;
+
+    const size_t offset = headerSize + idLength;
+    if (data.size() < offset + size_t(width) * height * (depth / 8))
+        return false;
+
+    image.layout = depth == 32 ? RawImage::Layout::BGRA : RawImage::Layout::BGR;
+    image.width = width;
+    image.height = height;
+    image.pixels = data.data() + offset;
+    image.bottomUp = (descriptor & 0x20) == 0;
+    return true;
+}
+
+TextureLoader::TextureLoader(VkPhysicalDevice physicalDevice, VkDevice device, Queues queues, unsigned workerCount)
+    : _physicalDevice(physicalDevice), _device(device), _queues(queues)
+{
+    //mip generation blits need linear filtering support, otherwise textures get a single level
+    VkFormatProperties formatProps;
+    vkGetPhysicalDeviceFormatProperties(_physicalDevice, textureFormat, &formatProps);
+    const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    _canBlit = (formatProps.optimalTilingFeatures & blitFeatures) == blitFeatures;
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = _queues.transfer->family();
+    if (vkCreateCommandPool(_device, &poolInfo, nullptr, &_transferPool) != VK_SUCCESS)
+        std::cout << "TextureLoader: failed to create transfer command pool\n";
+
+    poolInfo.queueFamilyIndex = _queues.graphics->family();
+    if (vkCreateCommandPool(_device, &poolInfo, nullptr, &_graphicsPool) != VK_SUCCESS)
+        std::cout << "TextureLoader: failed to create graphics command pool\n";
+
+    if (workerCount == 0)
+        workerCount = std::max(1u, std::thread::hardware_concurrency() / 2);
+    for (unsigned i = 0; i < workerCount; ++i)
+        _workers.emplace_back(&TextureLoader::workerLoop, this);
+}
+
+TextureLoader::~TextureLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(_jobMutex);
+        _stop = true;
+    }
+    _jobCv.notify_all();
+    for (std::thread& worker : _workers)
+        if (worker.joinable())
+            worker.join();
+}
+
+uint32_t TextureLoader::load(const std::string& path)
+{
+    const uint32_t id = static_cast<uint32_t>(_entries.size());
+    Entry& entry = _entries.emplace_back();
+    entry.path = path;
+    entry.requested = std::chrono::steady_clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(_jobMutex);
+        _jobs.push_back({ id, path });
+    }
+    _jobCv.notify_one();
+    return id;
+}
+
+TextureState TextureLoader::state(uint32_t id) const
+{
+    return id < _entries.size() ? _entries[id].state : TextureState::Failed;
+}
+
+const Texture* TextureLoader::get(uint32_t id) const
+{
+    if (id >= _entries.size() || _entries[id].state != TextureState::Ready)
+        return nullptr;
+    return &_entries[id].texture;
+}
+
+void TextureLoader::workerLoop()
+{
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(_jobMutex);
+            _jobCv.wait(lock, [this] {return _stop || !_jobs.empty(); });
+            if (_stop)
+                return;
+            job = std::move(_jobs.front());
+            _jobs.pop_front();
+        }
+
+        Decoded decoded = decode(job);
+
+        std::lock_guard<std::mutex> lock(_decodedMutex);
+        _decoded.push_back(decoded);
+    }
+}
+
+TextureLoader::Decoded TextureLoader::decode(const Job& job) const
+{
+    Decoded result{};
+    result.id = job.id;
+    result.failed = true;
+
+    std::vector<uint8_t> data;
+    if (!readWholeFile(job.path, data))
+    {
+        std::cout << "TextureLoader: cant read \"" << job.path << "\"\n";
+        return result;
+    }
+
+    RawImage image{};
+    if (!parsePPM(data, image) && !parseTGA(data, image))
+    {
+        std::cout << "TextureLoader: unsupported image format \"" << job.path << "\"\n";
+        return result;
+    }
+
+    //hold back while a heap is close to its budget, uploads in flight free their staging memory when they finish
+    for (int waited = 0; memoryTelemetry().underPressure() && waited < stagingPressureWaitMs && !_stop; waited += 5)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    //buffer and memory creation is thread safe, mapping only needs the memory object to be externally synchronized
+    const VkDeviceSize size = VkDeviceSize(image.width) * image.height * 4;
+    if (!createBuffer(_physicalDevice, _device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, result.staging, result.stagingMemory, MemoryCategory::Staging))
+    {
+        std::cout << "TextureLoader: cant allocate staging buffer for \"" << job.path << "\"\n";
+        return result;
+    }
+
+    void* mapped = nullptr;
+    if (vkMapMemory(_device, result.stagingMemory, 0, size, 0, &mapped) != VK_SUCCESS)
+    {
+        vkDestroyBuffer(_device, result.staging, nullptr);
+        memoryTelemetry().free(_device, result.stagingMemory);
+        result.staging = VK_NULL_HANDLE;
+        result.stagingMemory = VK_NULL_HANDLE;
+        return result;
+    }
+
+    //convert straight into the staging memory, rows are flipped on the fly for bottom up images
+    auto convert = [&image](const uint8_t* src, uint8_t* dst, size_t pixels) {
+        switch (image.layout)
+        {
+        case RawImage::Layout::RGB: rgb8ToRgba8(src, dst, pixels); break;
+        case RawImage::Layout::BGR: bgr8ToRgba8(src, dst, pixels); break;
+        case RawImage::Layout::BGRA: bgra8ToRgba8(src, dst, pixels); break;
+        }
+        };
+    const size_t srcPixelSize = image.layout == RawImage::Layout::BGRA ? 4 : 3;
+    uint8_t* dst = static_cast<uint8_t*>(mapped);
+
+    if (!image.bottomUp)
+        convert(image.pixels, dst, size_t(image.width) * image.height);
+    else
+    {
+        for (uint32_t row = 0; row < image.height; ++row)
+        {
+            const uint8_t* srcRow = image.pixels + size_t(image.height - 1 - row) * image.width * srcPixelSize;
+            convert(srcRow, dst + size_t(row) * image.width * 4, image.width);
+        }
+    }
+
+    vkUnmapMemory(_device, result.stagingMemory); //coherent memory, no flush needed
+
+    result.width = image.width;
+    result.height = image.height;
+    result.failed = false;
+    return result;
+}
+
+void TextureLoader::update()
+{
+    //finalize finished uploads
+    auto it = std::remove_if(_uploads.begin(), _uploads.end(), [this](const Upload& upload) -> bool {
+        if (!_queues.graphics->isComplete(upload.graphicsValue))
+            return false;
+        finishUpload(upload);
+        return true;
+        });
+    _uploads.erase(it, _uploads.end());
+
+    //start uploads for everything the workers have finished, never wait on a busy worker
+    std::vector<Decoded> decoded;
+    {
+        std::unique_lock<std::mutex> lock(_decodedMutex, std::try_to_lock);
+        if (!lock.owns_lock())
+            return;
+        decoded.swap(_decoded);
+    }
+
+    for (const Decoded& d : decoded)
+    {
+        if (d.failed || !startUpload(d))
+        {
+            _entries[d.id].state = TextureState::Failed;
+            if (d.staging != VK_NULL_HANDLE)
+            {
+                vkDestroyBuffer(_device, d.staging, nullptr);
+                memoryTelemetry().free(_device, d.stagingMemory);
+            }
+        }
+    }
+}
+
+bool TextureLoader::startUpload(const Decoded& decoded)
+{
+    Texture& texture = _entries[decoded.id].texture;
+    texture.width = decoded.width;
+    texture.height = decoded.height;
+    texture.mipLevels = _canBlit ? static_cast<uint32_t>(std::bit_width(std::max(decoded.width, decoded.height))) : 1;
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = textureFormat;
+    imageInfo.extent = { decoded.width, decoded.height, 1 };
+    imageInfo.mipLevels = texture.mipLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE; //ownership is transferred explicitly
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (vkCreateImage(_device, &imageInfo, nullptr, &texture.image) != VK_SUCCESS)
+    {
+        texture.image = VK_NULL_HANDLE;
+        return false;
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(_device, texture.image, &requirements);
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(_physicalDevice, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (allocInfo.memoryTypeIndex == UINT32_MAX ||
+        memoryTelemetry().allocate(_device, allocInfo, MemoryCategory::Image, texture.memory) != VK_SUCCESS)
+    {
+        vkDestroyImage(_device, texture.image, nullptr);
+        texture = Texture{};
+        return false;
+    }
+    if (vkBindImageMemory(_device, texture.image, texture.memory, 0) != VK_SUCCESS)
+    {
+        vkDestroyImage(_device, texture.image, nullptr);
+        memoryTelemetry().free(_device, texture.memory);
+        texture = Texture{};
+        return false;
+    }
+
+    Upload upload{};
+    upload.id = decoded.id;
+    upload.staging = decoded.staging;
+    upload.stagingMemory = decoded.stagingMemory;
+
+    VkCommandBufferAllocateInfo cmdInfo{};
+    cmdInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cmdInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cmdInfo.commandBufferCount = 1;
+    cmdInfo.commandPool = _transferPool;
+    VkResult code = vkAllocateCommandBuffers(_device, &cmdInfo, &upload.transferCmd);
+    cmdInfo.commandPool = _graphicsPool;
+    if (code == VK_SUCCESS)
+        code = vkAllocateCommandBuffers(_device, &cmdInfo, &upload.graphicsCmd);
+
+    if (code != VK_SUCCESS)
+    {
+        std::cout << "TextureLoader: cant allocate upload command buffers\n";
+        upload.staging = VK_NULL_HANDLE; //freed by the caller
+        releaseUpload(upload);
+        vkDestroyImage(_device, texture.image, nullptr);
+        memoryTelemetry().free(_device, texture.memory);
+        texture = Texture{};
+        return false;
+    }
+
+    const bool ownershipTransfer = _queues.transfer->family() != _queues.graphics->family();
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.image = texture.image;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = texture.mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    //---- transfer queue: staging -> mip 0
+    vkBeginCommandBuffer(upload.transferCmd, &beginInfo);
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(upload.transferCmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0; //tightly packed
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = { 0, 0, 0 };
+    region.imageExtent = { decoded.width, decoded.height, 1 };
+    vkCmdCopyBufferToImage(upload.transferCmd, upload.staging, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    if (ownershipTransfer)
+    {//release to the graphics family, layout stays TRANSFER_DST for the blits
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        barrier.srcQueueFamilyIndex = _queues.transfer->family();
+        barrier.dstQueueFamilyIndex = _queues.graphics->family();
+        vkCmdPipelineBarrier(upload.transferCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+            0, nullptr, 0, nullptr, 1, &barrier);
+    }
+    vkEndCommandBuffer(upload.transferCmd);
+
+    //---- graphics queue: acquire, blit mip chain, make it shader readable
+    vkBeginCommandBuffer(upload.graphicsCmd, &beginInfo);
+
+    if (ownershipTransfer)
+    {
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.srcQueueFamilyIndex = _queues.transfer->family();
+        barrier.dstQueueFamilyIndex = _queues.graphics->family();
+        vkCmdPipelineBarrier(upload.graphicsCmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+            0, nullptr, 0, nullptr, 1, &barrier);
+    }
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.subresourceRange.levelCount = 1;
+
+    int32_t mipWidth = static_cast<int32_t>(decoded.width);
+    int32_t mipHeight = static_cast<int32_t>(decoded.height);
+    for (uint32_t level = 1; level < texture.mipLevels; ++level)
+    {
+        barrier.subresourceRange.baseMipLevel = level - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier(upload.graphicsCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+            0, nullptr, 0, nullptr, 1, &barrier);
+
+        VkImageBlit blit{};
+        blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1 };
+        blit.srcOffsets[0] = { 0, 0, 0 };
+        blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+        mipWidth = std::max(mipWidth / 2, 1);
+        mipHeight = std::max(mipHeight / 2, 1);
+        blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+        blit.dstOffsets[0] = { 0, 0, 0 };
+        blit.dstOffsets[1] = { mipWidth, mipHeight, 1 };
+        vkCmdBlitImage(upload.graphicsCmd, texture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(upload.graphicsCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+            0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    //last level was only written
+    barrier.subresourceRange.baseMipLevel = texture.mipLevels - 1;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(upload.graphicsCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+        0, nullptr, 0, nullptr, 1, &barrier);
+
+    vkEndCommandBuffer(upload.graphicsCmd);
+
+    //the graphics half waits for the transfer timeline to reach the copy, no per upload semaphore or fence
+    const uint64_t transferValue = _queues.transfer->submit(&upload.transferCmd, 1);
+    upload.graphicsValue = 0;
+    if (transferValue != 0)
+        upload.graphicsValue = _queues.graphics->submit(&upload.graphicsCmd, 1,
+            { _queues.transfer->after(transferValue, VK_PIPELINE_STAGE_TRANSFER_BIT) });
+
+    if (upload.graphicsValue == 0)
+    {//device is most likely lost, the value is never reached so everything is left to shutdown()
+        std::cout << "TextureLoader: upload submit failed\n";
+        _entries[decoded.id].state = TextureState::Failed;
+        upload.graphicsValue = UINT64_MAX;
+    }
+
+    _uploads.push_back(upload);
+    return true;
+}
+
+void TextureLoader::finishUpload(const Upload& upload)
+{
+    Entry& entry = _entries[upload.id];
+    Texture& texture = entry.texture;
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = texture.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = textureFormat;
+    viewInfo.components = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = texture.mipLevels;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(_device, &viewInfo, nullptr, &texture.view) != VK_SUCCESS)
+    {
+        texture.view = VK_NULL_HANDLE;
+        entry.state = TextureState::Failed;
+    }
+    else
+    {
+        entry.state = TextureState::Ready;
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - entry.requested);
+        std::cout << "Texture \"" << entry.path << "\" ready: " << texture.width << "x" << texture.height
+            << ", " << texture.mipLevels << " mips, " << elapsed.count() << " ms\n";
+    }
+
+    releaseUpload(upload);
+}
+
+void TextureLoader::releaseUpload(const Upload& upload)
+{
+    if (upload.staging != VK_NULL_HANDLE)
+    {
+        vkDestroyBuffer(_device, upload.staging, nullptr);
+        memoryTelemetry().free(_device, upload.stagingMemory);
+    }
+    if (upload.transferCmd != VK_NULL_HANDLE)
+        vkFreeCommandBuffers(_device, _transferPool, 1, &upload.transferCmd);
+    if (upload.graphicsCmd != VK_NULL_HANDLE)
+        vkFreeCommandBuffers(_device, _graphicsPool, 1, &upload.graphicsCmd);
+}
+
+void TextureLoader::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(_jobMutex);
+        _stop = true;
+        _jobs.clear();
+    }
+    _jobCv.notify_all();
+    for (std::thread& worker : _workers)
+        if (worker.joinable())
+            worker.join();
+    _workers.clear();
+
+    for (const Upload& upload : _uploads)
+        releaseUpload(upload);
+    _uploads.clear();
+
+    for (const Decoded& d : _decoded)
+    {
+        if (d.staging != VK_NULL_HANDLE)
+        {
+            vkDestroyBuffer(_device, d.staging, nullptr);
+            memoryTelemetry().free(_device, d.stagingMemory);
+        }
+    }
+    _decoded.clear();
+
+    for (Entry& entry : _entries)
+    {
+        if (entry.texture.view != VK_NULL_HANDLE)
+            vkDestroyImageView(_device, entry.texture.view, nullptr);
+        if (entry.texture.image != VK_NULL_HANDLE)
+            vkDestroyImage(_device, entry.texture.image, nullptr);
+        if (entry.texture.memory != VK_NULL_HANDLE)
+            memoryTelemetry().free(_device, entry.texture.memory);
+        entry.texture = Texture{};
+    }
+
+    if (_transferPool != VK_NULL_HANDLE)
+        vkDestroyCommandPool(_device, _transferPool, nullptr);
+    if (_graphicsPool != VK_NULL_HANDLE)
+        vkDestroyCommandPool(_device, _graphicsPool, nullptr);
+    _transferPool = VK_NULL_HANDLE;
+    _graphicsPool = VK_NULL_HANDLE;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "queueTimeline.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Texture
+{
+    VkImage image = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE; //whole mip chain, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL once ready
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mipLevels = 0;
+};
+
+enum class TextureState
+{
+    Loading,
+    Ready,
+    Failed
+};
+
+//loads textures without stalling the render loop:
+//worker threads decode the file and convert it to RGBA8 straight into a staging buffer,
+//the render thread records the copy on the transfer queue and the mip chain blits on the graphics queue
+//and afterwards only compares the graphics timeline against the value the upload signals
+//supported files: binary PPM (P6) and uncompressed 24/32 bit TGA
+//no shader samples the textures yet: --texture and the benchmark exercise decode, conversion, upload and mips only;
+//a consumer needs a sampler binding in the FrameAllocator set layout and a textured shader, Texture::view is what it binds
+class TextureLoader
+{
+public:
+    //may be the same timeline when there is no separate transfer queue
+    struct Queues
+    {
+        QueueTimeline* graphics;
+        QueueTimeline* transfer;
+    };
+
+    //workerCount 0 picks half of the hardware threads
+    TextureLoader(VkPhysicalDevice physicalDevice, VkDevice device, Queues queues, unsigned workerCount = 0);
+    ~TextureLoader();
+
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    //returns the texture id, decoding starts right away; render thread only
+    uint32_t load(const std::string& path);
+
+    TextureState state(uint32_t id) const;
+    //nullptr until the texture is ready
+    const Texture* get(uint32_t id) const;
+
+    //call once per frame on the render thread, starts uploads for decoded images and finalizes finished ones
+    void update();
+
+    //stops the workers and destroys every texture; device must be idle
+    void shutdown();
+
+private:
+    struct Job
+    {
+        uint32_t id;
+        std::string path;
+    };
+
+    //produced by a worker, pixels are already in the staging buffer as RGBA8
+    struct Decoded
+    {
+        uint32_t id;
+        bool failed;
+        uint32_t width;
+        uint32_t height;
+        VkBuffer staging;
+        VkDeviceMemory stagingMemory;
+    };
+
+    struct Upload
+    {
+        uint32_t id;
+        VkBuffer staging;
+        VkDeviceMemory stagingMemory;
+        VkCommandBuffer transferCmd;
+        VkCommandBuffer graphicsCmd;
+        uint64_t graphicsValue; //graphics timeline value signaled once the mip chain is ready
+    };
+
+    struct Entry
+    {
+        std::string path;
+        TextureState state = TextureState::Loading;
+        Texture texture;
+        std::chrono::steady_clock::time_point requested;
+    };
+
+    void workerLoop();
+    Decoded decode(const Job& job) const;
+    bool startUpload(const Decoded& decoded);
+    void finishUpload(const Upload& upload);
+    void releaseUpload(const Upload& upload);
+
+    VkPhysicalDevice _physicalDevice;
+    VkDevice _device;
+    Queues _queues;
+    bool _canBlit = false;
+
+    VkCommandPool _transferPool = VK_NULL_HANDLE;
+    VkCommandPool _graphicsPool = VK_NULL_HANDLE;
+
+    std::deque<Entry> _entries; //render thread only
+    std::vector<Upload> _uploads; //render thread only
+
+    std::mutex _jobMutex;
+    std::condition_variable _jobCv;
+    std::deque<Job> _jobs;
+    std::atomic<bool> _stop{ false }; //set under _jobMutex, also read by workers waiting out memory pressure
+
+    std::mutex _decodedMutex;
+    std::vector<Decoded> _decoded;
+
+    std::vector<std::thread> _workers;
+};
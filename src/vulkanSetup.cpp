@@ -0,0 +1,1018 @@
+#include "vulkanSetup.hpp"
+
+#include "shaderInterface.hpp"
+#include "memoryTelemetry.hpp"
+
+#include <stdexcept>
+#include <set>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <fstream>
+
+#include <iostream>
+#include <sstream>
+#include <cstdlib> //for exit
+
+void exitWithError(const char* error, int code)
+{
+    std::ostringstream errText;
+    errText << error;
+    if (code != 0)
+        errText << "; error code: " << code;
+
+    std::cout << "\nFatal error: " << errText.str() << "\n";
+
+    exit(code != 0 ? code : EXIT_FAILURE); //a regression run must never report success after a fatal error
+    throw std::runtime_error(errText.str());
+}
+
+GLFWwindow* initGLFW(bool headless) {
+    if (headless)
+    {
+#if GLFW_VERSION_MAJOR * 100 + GLFW_VERSION_MINOR >= 304
+        //null platform, surfaces come from VK_EXT_headless_surface so no display server is needed
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#else
+        std::cout << "--headless needs GLFW 3.4 or newer\n";
+        return nullptr;
+#endif
+    }
+
+    if (!glfwInit()) {
+        return nullptr;
+    }
+
+    // Optional: prevent OpenGL context if using Vulkan later
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+
+    //the render thread recreates the swapchain when the framebuffer size changes
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+    if (headless)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    GLFWwindow* window = glfwCreateWindow(800, 600, "Empty GLFW Window", nullptr, nullptr);
+    if (!window) {
+        glfwTerminate();
+        return nullptr;
+    }
+    return window;
+}
+
+class PropList
+{
+    std::vector<const char*> _props;
+public:
+    void addProp(const char *prop) {
+        _props.emplace_back(prop);
+    }
+    void addProps(const char** props, size_t cnt)
+    {
+        for (size_t i = 0; i < cnt; ++i)
+        {
+            _props.emplace_back(props[i]);
+        }
+    }
+    const char** getProps() {
+        return _props.data();
+    }
+    size_t getPropCnt() {
+        return _props.size();
+    }
+};
+
+ static VkBool32 debugCallback(
+    VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
+    VkDebugUtilsMessageTypeFlagsEXT messageType,
+    const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
+    void* /*pUserData*/) {
+
+    bool loaderError = false;
+    if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) {
+        if (messageType & VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT &&
+            strcmp(pCallbackData->pMessageIdName, "Loader Message") == 0)
+        {
+            loaderError = true; // Vulkan loader prijavljuje fatalnu gresku kad ne moze pravilno da ucita neki layer i ako se uopste ne koristi. Ovo je dodano kako bi se te gre�ke ignorisale
+        }
+    }
+
+    std::ostringstream errText;
+    if ((messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT) ||
+        (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT) ||
+        loaderError)
+    {
+        if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT)
+            return VK_FALSE;
+        std::cout << "Vulkan debug layer info: " << pCallbackData->pMessage << "\n";
+        return VK_FALSE;
+    }
+
+
+    errText << "Error severity: " << messageSeverity << "\n";
+    errText << "Error message: " << pCallbackData->pMessage;
+    exitWithError(errText.str().c_str(), pCallbackData->messageIdNumber);
+    return VK_FALSE;
+}
+
+
+ SwapChainSupportDetails querySwapChainSupport(const VkPhysicalDevice &device, const VkSurfaceKHR &surface)
+ {
+     SwapChainSupportDetails details;
+     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
+
+     uint32_t formatCount;
+     vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, nullptr);
+
+     if (formatCount != 0) {
+         details.formats.resize(formatCount);
+         vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, details.formats.data());
+     }
+
+     uint32_t presentModeCount;
+     vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, nullptr);
+
+     if (presentModeCount != 0) {
+         details.presentModes.resize(presentModeCount);
+         vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, details.presentModes.data());
+     }
+
+     return details;
+ }
+
+
+
+ SwapChainProfile getSwapChainProfile(const VkPhysicalDevice& device, const VkSurfaceKHR& surface, int windowWidth, int windowHeight)
+ {
+     SwapChainSupportDetails allOptions = querySwapChainSupport(device, surface);
+     SwapChainProfile profile;
+
+     //vector store colors and formats and tries to choose the color and format with the smallest index possible
+     const std::vector<VkColorSpaceKHR> preferredColorSpace = { VK_COLOR_SPACE_SRGB_NONLINEAR_KHR , VK_COLOR_SPACE_EXTENDED_SRGB_LINEAR_EXT, VK_COLOR_SPACE_HDR10_ST2084_EXT };
+     const std::vector<VkFormat> preferredFormats =
+     { VK_FORMAT_B8G8R8A8_SRGB, VK_FORMAT_R8G8B8A8_SRGB, VK_FORMAT_B8G8R8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R16G16B16A16_SFLOAT,
+       VK_FORMAT_A2B10G10R10_UNORM_PACK32, VK_FORMAT_A2B10G10R10_UNORM_PACK32 };
+
+     if (allOptions.formats.empty() || allOptions.presentModes.empty())
+         exitWithError("getSwapChainProfile called with incompatible device and surface combination");
+     
+     std::vector<VkSurfaceFormatKHR> surfaceFormats;
+     std::vector<VkSurfaceFormatKHR>::iterator surfaceFormatIterator;
+
+     //find preffered colorSpace
+     for (const VkColorSpaceKHR& colorSpace : preferredColorSpace)
+     {
+         surfaceFormatIterator = std::find_if(allOptions.formats.begin(), allOptions.formats.end(), [&colorSpace](VkSurfaceFormatKHR sFormat) {return sFormat.colorSpace == colorSpace; });
+         if (surfaceFormatIterator != allOptions.formats.end())
+             surfaceFormats.push_back(*surfaceFormatIterator);
+     }
+     
+     //if wanted colorSpace not found then every surface format is a valid choice
+     if (surfaceFormats.size() == 0)
+     {
+         surfaceFormats = std::move(allOptions.formats);
+     }
+
+     bool found = false;
+
+     //out of all valid surfaceFormats find the one with prefferd memory layout
+     for (const VkFormat& format : preferredFormats)
+     {
+         surfaceFormatIterator = std::find_if(surfaceFormats.begin(), surfaceFormats.end(), [&format](VkSurfaceFormatKHR sFormat) {return sFormat.format == format; });
+         if (surfaceFormatIterator != surfaceFormats.end()) {
+             found = true;
+             profile.format = *surfaceFormatIterator;
+             break;
+         }
+     }
+
+     
+     //if preffered format was not found pick any
+     if (!found)
+         profile.format = surfaceFormats.at(0);
+
+
+     //sorted from pick first to pick last (same as before)
+     std::vector<VkPresentModeKHR> preferredPresentations =
+     { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+     //VK_PRESENT_MODE_FIFO_KHR is guaranteed to be abiable but other format are listed in case vector is reordered in future implementations
+
+     auto presentationIterator = std::find_first_of(
+         preferredPresentations.begin(), preferredPresentations.end(),
+         allOptions.presentModes.begin(), allOptions.presentModes.end());
+
+     if (presentationIterator == preferredPresentations.end())
+         presentationIterator = allOptions.presentModes.begin();
+
+     profile.presentMode = *presentationIterator;
+
+
+     if (allOptions.capabilities.currentExtent.width !=
+         std::numeric_limits<uint32_t>::max()) {
+         profile.extent = allOptions.capabilities.currentExtent;
+     }
+     else {
+
+         VkExtent2D actualExtent = {
+             static_cast<uint32_t>(windowWidth),
+             static_cast<uint32_t>(windowHeight)
+         };
+         
+         actualExtent.width = std::clamp(actualExtent.width,
+             allOptions.capabilities.minImageExtent.width,
+             allOptions.capabilities.maxImageExtent.width);
+         
+         actualExtent.height = std::clamp(actualExtent.height,
+             allOptions.capabilities.minImageExtent.height,
+             allOptions.capabilities.maxImageExtent.height);
+             
+         profile.extent = actualExtent;
+     }
+
+     if(allOptions.capabilities.maxImageCount != 0)
+        profile.imgCount = std::clamp(allOptions.capabilities.minImageCount + 1,
+            allOptions.capabilities.minImageCount,
+            allOptions.capabilities.maxImageCount);
+        else
+            profile.imgCount = allOptions.capabilities.minImageCount + 1;
+
+     profile.surfaceTransform = allOptions.capabilities.currentTransform;
+     profile.supportedUsage = allOptions.capabilities.supportedUsageFlags;
+
+     return profile;
+ }
+
+ SwapChainProfile getSwapChainProfile(const VkPhysicalDevice& device, const VkSurfaceKHR& surface, GLFWwindow *window)
+ {
+     int width, height;
+     glfwGetFramebufferSize(window, &width, &height);
+     return getSwapChainProfile(device, surface, width, height);
+ }
+
+ //everything the renderer relies on without checking again later
+ static bool isSuitableDevice(VkPhysicalDevice device, const VkSurfaceKHR& surface)
+ {
+     VkPhysicalDeviceProperties deviceProperties;
+     vkGetPhysicalDeviceProperties(device, &deviceProperties);
+
+     //all queue synchronization goes through timeline semaphores
+     VkPhysicalDeviceVulkan12Features features12{};
+     features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+     VkPhysicalDeviceFeatures2 features2{};
+     features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+     features2.pNext = &features12;
+     if (deviceProperties.apiVersion >= VK_API_VERSION_1_2)
+         vkGetPhysicalDeviceFeatures2(device, &features2);
+     if (features12.timelineSemaphore != VK_TRUE)
+         return false;
+
+     uint32_t extensionCount = 0;
+     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+     std::vector<VkExtensionProperties> deviceExtensions(extensionCount);
+     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, deviceExtensions.data());
+
+     //make device that does not have VK_KHR_SWAPCHAIN_EXTENSION_NAME extension unsuitable
+     if (std::find_if(deviceExtensions.begin(), deviceExtensions.end(),
+         [](const VkExtensionProperties& prop)->bool {return strcmp(prop.extensionName, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0; }) == deviceExtensions.end())
+         return false;
+
+     SwapChainSupportDetails swapDet = querySwapChainSupport(device, surface);
+     if (swapDet.presentModes.empty() || swapDet.formats.empty())
+         return false; //swap chain is not capable to present on this surface
+
+     //main() cant run without both
+     const QueueFamily families = getQueueFamily(device, surface);
+     return families.graphics >= 0 && families.presentation >= 0;
+ }
+
+ std::vector<VkPhysicalDevice> suitablePhysicalDevices(VkInstance instance, const VkSurfaceKHR& surface, const std::vector<VkPhysicalDevice>& dissalowedDevices)
+ {
+     uint32_t deviceCount = 0;
+     vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+     std::vector<VkPhysicalDevice> devs(deviceCount);
+     vkEnumeratePhysicalDevices(instance, &deviceCount, devs.data());
+
+     std::vector<VkPhysicalDevice> suitable;
+     for (VkPhysicalDevice dev : devs)
+     {
+         if (std::find(dissalowedDevices.begin(), dissalowedDevices.end(), dev) == dissalowedDevices.end() && isSuitableDevice(dev, surface))
+             suitable.push_back(dev);
+     }
+     return suitable;
+ }
+
+ VkPhysicalDevice pickPhysicalDevice(VkInstance &instance, const VkSurfaceKHR& surface, std::vector<VkPhysicalDevice> dissalowedDevices)
+{
+     uint32_t deviceCount = 0;
+     vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+     if (deviceCount == 0)
+         exitWithError("No Vulkan GPU devices found");
+
+     const std::vector<VkPhysicalDevice> devs = suitablePhysicalDevices(instance, surface, dissalowedDevices);
+
+     VkPhysicalDeviceProperties deviceProperties;
+     VkPhysicalDeviceMemoryProperties memProps;
+     VkPhysicalDevice best = VK_NULL_HANDLE;
+     VkPhysicalDevice cpuFallback = VK_NULL_HANDLE;
+     long long int bestPoints = 0;
+     for (VkPhysicalDevice dev : devs)
+     {
+         vkGetPhysicalDeviceProperties(dev, &deviceProperties);
+         vkGetPhysicalDeviceMemoryProperties(dev, &memProps);
+
+         //a software implementation reports system memory as its heap, it would outscore real GPUs
+         if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU)
+         {
+             if (cpuFallback == VK_NULL_HANDLE)
+                 cpuFallback = dev;
+             continue;
+         }
+
+         long long int points = 1;
+         for (uint32_t j = 0; j < memProps.memoryHeapCount; ++j) {
+             points += memProps.memoryHeaps[j].size / (1024 * 1024); //mb
+         }
+
+         points *= (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) ? 10 : 1;
+         points *= (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU) ? 3 : 1;
+         if (points > bestPoints)
+         {
+             bestPoints = points;
+             best = dev;
+         }
+     }
+
+     if (best == VK_NULL_HANDLE && cpuFallback != VK_NULL_HANDLE)
+     {
+         vkGetPhysicalDeviceProperties(cpuFallback, &deviceProperties);
+         std::cout << "No GPU can render to the surface, falling back to the CPU implementation " << deviceProperties.deviceName << "\n";
+         best = cpuFallback;
+     }
+     return best;
+ }
+
+
+ QueueFamily getQueueFamily(const VkPhysicalDevice& device, const VkSurfaceKHR &surface)
+ {
+     QueueFamily queueInd{};
+     uint32_t cnt;
+     vkGetPhysicalDeviceQueueFamilyProperties(device, &cnt, nullptr);
+     std::vector<VkQueueFamilyProperties> props(cnt);
+     vkGetPhysicalDeviceQueueFamilyProperties(device, &cnt, props.data());
+
+     auto findDedicatedFamily = [&cnt, &props](VkQueueFlagBits required, const std::vector<VkQueueFlagBits>& disallowed) -> int{
+         std::vector<int> foundQueue;
+         for (uint32_t i = 0; i < cnt; ++i)
+         {
+             if (props[i].queueFlags & required)
+             {
+                 for (const auto flag : disallowed) 
+                 {
+                     if (props[i].queueFlags & flag)
+                         goto CONTINUE_LOOP;
+                 }
+                foundQueue.push_back(i);
+             }
+         CONTINUE_LOOP:
+             ;
+         }
+         if (foundQueue.empty())
+             return -1;
+         return *std::max_element(foundQueue.begin(), foundQueue.end(), 
+             [&props](int ind1, int ind2)->bool{return props[ind1].queueCount < props[ind2].queueCount; });
+     };
+
+     //families in avoid are only picked when nothing else has requiredFlag
+     auto findBiggestFamily = [&cnt, &props](VkQueueFlagBits requiredFlag, const std::vector<int>& avoid = {}) -> int {
+         uint32_t max_queues = 0;
+         int index = -1;
+         for (bool skipAvoided : { true, false })
+         {
+             for (uint32_t i = 0; i < cnt; ++i)
+             {
+                 if (skipAvoided && std::find(avoid.begin(), avoid.end(), int(i)) != avoid.end())
+                     continue;
+                 if ((props[i].queueFlags & requiredFlag) && props[i].queueCount > max_queues)
+                 {
+                     max_queues = props[i].queueCount;
+                     index = i;
+                 }
+             }
+             if (index != -1)
+                 break;
+         }
+         return index;
+         };
+
+     //find a family with most queues that has DMA transfer; chosen to be transfer queue
+     {
+         int found = findBiggestFamily(VK_QUEUE_TRANSFER_BIT);
+         if (found != -1)
+             queueInd.transfer = found;
+     }
+
+
+
+     //find dedicated graphics family, if not found then pick the one with most queues
+     {
+         int found = findDedicatedFamily(VK_QUEUE_GRAPHICS_BIT, {VK_QUEUE_COMPUTE_BIT, VK_QUEUE_TRANSFER_BIT});
+         if (found == -1)
+         {//dedicated graphics family not found
+             found = findBiggestFamily(VK_QUEUE_GRAPHICS_BIT, { queueInd.transfer });
+         }
+         if (found != -1)
+             queueInd.graphics = found;
+     }
+
+     //check if graphics queue supports presentation, if not set presentation to the first family that does
+     VkBool32 supported = false;
+     if (queueInd.graphics >= 0)
+        vkGetPhysicalDeviceSurfaceSupportKHR(device, queueInd.graphics, surface, &supported);
+
+     if(supported)
+     {//graphics family supports presentation
+        queueInd.presentation = queueInd.graphics;
+     }
+     else {
+         VkBool32 supported;
+         for (uint32_t i = 0; i < cnt; ++i)
+         {
+             vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &supported);
+             if (supported)
+             {
+                 queueInd.presentation = i;
+                 break;
+             }
+         }
+     }
+
+     //find dedicated compute family, if not found then pick the one with most queues
+     {
+         int found = findDedicatedFamily(VK_QUEUE_COMPUTE_BIT, { VK_QUEUE_GRAPHICS_BIT, VK_QUEUE_TRANSFER_BIT });
+         if (found == -1)
+         {//dedicated compute family not found
+             found = findBiggestFamily(VK_QUEUE_COMPUTE_BIT, { queueInd.graphics, queueInd.transfer });
+         }
+         if (found != -1)
+             queueInd.compute = found;
+     }
+
+     return queueInd;
+ }
+
+VkInstance createInstance(bool validation)
+{
+    VkDebugUtilsMessengerCreateInfoEXT vkDebugCreateInfo{}; // for "VK_EXT_debug_utils" extensions
+    vkDebugCreateInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+    vkDebugCreateInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    vkDebugCreateInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+    vkDebugCreateInfo.pfnUserCallback = debugCallback;
+    vkDebugCreateInfo.pUserData = nullptr;
+
+    VkApplicationInfo appInfo{};
+    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.pApplicationName = "Hello Triangle";
+    appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+    appInfo.pEngineName = "No Engine";
+    appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+    appInfo.apiVersion = VK_API_VERSION_1_2; //timeline semaphores are core in 1.2
+
+
+    VkInstanceCreateInfo vkInfo{};
+    vkInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    vkInfo.pNext = validation ? &vkDebugCreateInfo : nullptr;
+    vkInfo.pApplicationInfo = &appInfo;
+
+    
+
+    PropList extensions;
+    {
+        uint32_t extensions_cnt;
+        const char** extensions_list;
+        extensions_list = glfwGetRequiredInstanceExtensions(&extensions_cnt);
+        extensions.addProps(extensions_list, extensions_cnt);
+    }
+    
+    if (validation)
+        extensions.addProp("VK_EXT_debug_utils");
+
+    {
+        
+        std::vector<VkExtensionProperties> aviableExtensions;
+        uint32_t aviableExtensionsCnt = 0;
+        vkEnumerateInstanceExtensionProperties(nullptr, &aviableExtensionsCnt, nullptr);
+        aviableExtensions.resize(aviableExtensionsCnt);
+
+        vkEnumerateInstanceExtensionProperties(nullptr, &aviableExtensionsCnt, aviableExtensions.data());
+
+        //check if any requested extensions are not aviable
+        const auto requestedExtensions = extensions.getProps();
+        for (int i = 0; i < extensions.getPropCnt(); ++i) {
+            int j = 0;
+            for (; j < aviableExtensions.size(); ++j) {
+                if (std::strcmp(requestedExtensions[i], aviableExtensions[j].extensionName) == 0)
+                    break;
+            }
+            if (j == aviableExtensions.size()) {
+                std::ostringstream error;
+                error << "Extension \"" << requestedExtensions[i] << "\" not found";
+                
+                exitWithError(error.str().c_str(), VK_ERROR_INITIALIZATION_FAILED);
+            }
+        }
+    }
+
+    vkInfo.enabledExtensionCount = (uint32_t)extensions.getPropCnt();
+    vkInfo.ppEnabledExtensionNames = extensions.getProps();
+  
+
+    PropList layers;
+
+    if (validation)
+        layers.addProp("VK_LAYER_KHRONOS_validation");
+
+    {
+        uint32_t aviableLayerCnt;
+        std::vector<VkLayerProperties> aviableLayers;
+        vkEnumerateInstanceLayerProperties(&aviableLayerCnt, nullptr);
+        aviableLayers.resize(aviableLayerCnt);
+        vkEnumerateInstanceLayerProperties(&aviableLayerCnt, aviableLayers.data());
+
+        //check if any requested layers are not aviable
+        const auto requestedLayers = layers.getProps();
+        for (int i = 0; i < layers.getPropCnt(); ++i) {
+            int j = 0;
+            for (; j < aviableLayers.size(); ++j) {
+                if (std::strcmp(requestedLayers[i], aviableLayers[j].layerName) == 0)
+                    break;
+            }
+            if (j == aviableLayers.size()) {
+                std::ostringstream error;
+                error << "Layer \"" << requestedLayers[i] << "\" not found";
+                exitWithError(error.str().c_str(), VK_ERROR_INITIALIZATION_FAILED);
+            }
+        }
+    }
+
+    vkInfo.ppEnabledLayerNames = layers.getProps();
+    vkInfo.enabledLayerCount = (uint32_t)layers.getPropCnt();
+
+    VkInstance vkInstance{};
+    auto code = vkCreateInstance(&vkInfo, nullptr, &vkInstance);
+    if (code != VK_SUCCESS) 
+    {
+        exitWithError("Vulkan init error", code);
+    }
+    return vkInstance;
+}
+
+QueuePlan planQueues(const VkPhysicalDevice& device, const QueueFamily& queueFamily, const QueueConfig& config)
+{
+    uint32_t cnt;
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &cnt, nullptr);
+    std::vector<VkQueueFamilyProperties> props(cnt);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &cnt, props.data());
+
+    QueuePlan plan;
+    auto add = [&plan, &props](int family, const std::vector<float>& priorities) {
+        if (family < 0)
+            return;
+        auto it = std::find_if(plan.begin(), plan.end(), [family](const FamilyQueues& f) {return f.family == uint32_t(family); });
+        if (it == plan.end())
+        {
+            plan.push_back({ uint32_t(family), {} });
+            it = plan.end() - 1;
+        }
+        for (float priority : priorities)
+        {
+            if (it->priorities.size() < props[family].queueCount)
+                it->priorities.push_back(std::clamp(priority, 0.0f, 1.0f));
+        }
+    };
+    //graphics first so it keeps its priority when a shared family runs out of queues
+    add(queueFamily.graphics, config.graphics);
+    add(queueFamily.transfer, config.transfer);
+    add(queueFamily.compute, config.compute);
+    add(queueFamily.presentation, {}); //present goes through the graphics queue when the family is shared
+    for (FamilyQueues& family : plan)
+    {
+        if (family.priorities.empty())
+            family.priorities.push_back(1.0f); //every family in the plan needs at least one queue
+    }
+    return plan;
+}
+
+VkDevice tryCreateLogicalDevice(const VkPhysicalDevice& device, const QueuePlan& plan)
+{
+    std::vector<VkDeviceQueueCreateInfo> queueCreateInfo(plan.size());
+    for (size_t i = 0; i < plan.size(); ++i)
+    {
+        queueCreateInfo[i].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueCreateInfo[i].queueFamilyIndex = plan[i].family;
+        queueCreateInfo[i].queueCount = (uint32_t)plan[i].priorities.size();
+        queueCreateInfo[i].pQueuePriorities = plan[i].priorities.data();
+    }
+
+    VkPhysicalDeviceFeatures deviceFeatures{};
+
+    VkDeviceCreateInfo deviceInfo{};
+    deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceInfo.queueCreateInfoCount = (uint32_t)queueCreateInfo.size();
+    deviceInfo.pQueueCreateInfos = queueCreateInfo.data();
+    deviceInfo.pEnabledFeatures = &deviceFeatures;
+
+    VkPhysicalDeviceVulkan12Features features12{};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.timelineSemaphore = VK_TRUE; //checked by pickPhysicalDevice()
+    deviceInfo.pNext = &features12;
+
+    deviceInfo.enabledLayerCount = 0; //DEPRECATED, IGNORED BY VULKAN
+
+    
+    std::vector<const char*> deviceExtentions{ VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    //VK_KHR_SWAPCHAIN_EXTENSION_NAME checked for avilability by pickPhysicalDevice()
+    if (MemoryTelemetry::supportsBudget(device))
+        deviceExtentions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    deviceInfo.enabledExtensionCount = (uint32_t)deviceExtentions.size();
+    deviceInfo.ppEnabledExtensionNames = deviceExtentions.data();
+    
+
+    VkDevice logicalDevice;
+    if (vkCreateDevice(device, &deviceInfo, nullptr, &logicalDevice) != VK_SUCCESS)
+        return VK_NULL_HANDLE;
+    return logicalDevice;
+}
+
+VkDevice createLogicalDevice(const VkPhysicalDevice& device, const QueuePlan& plan)
+{
+    VkDevice logicalDevice = tryCreateLogicalDevice(device, plan);
+    if (logicalDevice == VK_NULL_HANDLE)
+        exitWithError("Cant create logical device");
+    return logicalDevice;
+}
+
+VkSwapchainKHR createSwapchain(const VkDevice& device, const VkSurfaceKHR& surface, const SwapChainProfile& profile, const QueueFamily& queueFamily,
+    VkImageUsageFlags usage, VkSwapchainKHR oldSwapchain)
+{
+    VkSwapchainCreateInfoKHR swapchainInfo{};
+    swapchainInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+    swapchainInfo.imageArrayLayers = 1;
+    swapchainInfo.imageColorSpace = profile.format.colorSpace;
+    swapchainInfo.imageExtent = profile.extent;
+    swapchainInfo.imageFormat = profile.format.format;
+    swapchainInfo.surface = surface;
+    swapchainInfo.minImageCount = profile.imgCount;
+    swapchainInfo.presentMode = profile.presentMode;
+    swapchainInfo.imageUsage = usage;
+    swapchainInfo.preTransform = profile.surfaceTransform;
+    swapchainInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    swapchainInfo.clipped = VK_TRUE;
+
+    swapchainInfo.oldSwapchain = oldSwapchain;
+
+    uint32_t queueFamilyIndicesUi32[] = { (uint32_t)queueFamily.graphics, (uint32_t)queueFamily.presentation };
+
+    if (queueFamily.graphics == queueFamily.presentation)
+    {
+        swapchainInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+    else 
+    {
+        swapchainInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+        swapchainInfo.queueFamilyIndexCount = 2;
+        swapchainInfo.pQueueFamilyIndices = queueFamilyIndicesUi32;
+    }
+
+    VkSwapchainKHR swapChain;
+
+    {
+        auto code = vkCreateSwapchainKHR(device, &swapchainInfo, nullptr, &swapChain);
+        if (code != VK_SUCCESS)
+            exitWithError("Swapchain creation failed");
+    }
+    return swapChain;
+}
+
+std::vector<VkImageView> createSwapchainImageViews(const VkDevice& device, const std::vector<VkImage>& images, VkFormat format)
+{
+    std::vector<VkImageView> views(images.size());
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.format = format;
+        viewInfo.image = images[i];
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+
+        viewInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+        viewInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+        viewInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+        viewInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        auto code = vkCreateImageView(device, &viewInfo, nullptr, &views[i]);
+        if (code != VK_SUCCESS)
+            exitWithError("failed to create imageView with index ${error_code}", (int)i);
+    }
+    return views;
+}
+
+VkFramebuffer tryCreateFramebuffer(const VkDevice& device, const VkRenderPass& renderPass, VkImageView view, VkExtent2D extent)
+{
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = renderPass;
+    framebufferInfo.attachmentCount = 1;
+    framebufferInfo.pAttachments = &view;
+    framebufferInfo.width = extent.width;
+    framebufferInfo.height = extent.height;
+    framebufferInfo.layers = 1;
+
+    VkFramebuffer framebuffer;
+    if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS)
+        return VK_NULL_HANDLE;
+    return framebuffer;
+}
+
+std::vector<VkFramebuffer> createFramebuffers(const VkDevice& device, const VkRenderPass& renderPass, const std::vector<VkImageView>& views, VkExtent2D extent)
+{
+    std::vector<VkFramebuffer> framebuffers;
+    framebuffers.resize(views.size());
+    for (size_t i = 0; i < views.size(); ++i)
+    {
+        framebuffers[i] = tryCreateFramebuffer(device, renderPass, views[i], extent);
+        if (framebuffers[i] == VK_NULL_HANDLE)
+            exitWithError("failed to create framebuffer!", (int)i);
+    }
+    return framebuffers;
+}
+
+VkRenderPass tryCreateRenderPass(const VkDevice& device, VkFormat format, bool preserveContents, VkImageLayout finalLayout)
+{
+    VkAttachmentDescription colorAttachment{};
+    colorAttachment.format = format;
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+    colorAttachment.initialLayout = preserveContents ? finalLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachment.finalLayout = finalLayout;
+
+
+    VkAttachmentReference colorAttachmentRef{};
+    colorAttachmentRef.attachment = 0;
+    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorAttachmentRef;
+    
+
+    VkSubpassDependency dependency{}; //make sure load operations are done just before frame write
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.dstSubpass = 0;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.srcAccessMask = 0;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    
+    // Create the render pass info structure
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 1;            // Only one attachment (color attachment)
+    renderPassInfo.pAttachments = &colorAttachment; // Pointer to your color attachment description
+    renderPassInfo.subpassCount = 1;                // One subpass
+    renderPassInfo.pSubpasses = &subpass;           // Pointer to your subpass description
+    renderPassInfo.dependencyCount = 1;
+    renderPassInfo.pDependencies = &dependency;
+
+    VkRenderPass renderPass;
+    // Create the render pass
+    if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
+        return VK_NULL_HANDLE;
+    return renderPass;
+}
+
+VkRenderPass createRenderPass(const VkDevice& device, VkFormat format, bool preserveContents, VkImageLayout finalLayout)
+{
+    VkRenderPass renderPass = tryCreateRenderPass(device, format, preserveContents, finalLayout);
+    if (renderPass == VK_NULL_HANDLE)
+        exitWithError("failed to create render pass!");
+    return renderPass;
+}
+
+VkPipelineLayout tryCreatePipelineLayout(const VkDevice& device, const VkDescriptorSetLayout& frameDataLayout)
+{
+    VkPushConstantRange pushRange{};
+    pushRange.stageFlags = drawPushConstantStages;
+    pushRange.offset = 0;
+    pushRange.size = sizeof(DrawPushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &frameDataLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+
+    VkPipelineLayout pipelineLayout;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+        return VK_NULL_HANDLE;
+    return pipelineLayout;
+}
+
+VkPipelineLayout createPipelineLayout(const VkDevice& device, const VkDescriptorSetLayout& frameDataLayout)
+{
+    VkPipelineLayout pipelineLayout = tryCreatePipelineLayout(device, frameDataLayout);
+    if (pipelineLayout == VK_NULL_HANDLE)
+        exitWithError("cant create pipelineLayout");
+    return pipelineLayout;
+}
+
+std::vector<char> readFile(const std::string& filename)
+{
+    // Open the file in binary mode and set the read position to the end (ate)
+    std::ifstream shaderFile(filename, std::ios::ate | std::ios::binary); //filename is allowed to use "/" on windows
+    if (!shaderFile.is_open()) {
+        std::string err = "failed to open file \"";
+        err += filename;
+        err += "\"";
+        exitWithError(err.c_str());
+    }
+
+    // Get the size of the file
+    std::size_t fileSize = static_cast<std::size_t>(shaderFile.tellg());
+    // Allocate a buffer to hold the file contents
+    std::vector<char> buffer(fileSize);
+
+
+    shaderFile.seekg(0);
+    shaderFile.read(buffer.data(), fileSize);
+
+
+    shaderFile.close();
+
+    return buffer;
+}
+
+VkShaderModule createShader(const VkDevice &device, const std::string& filePath) 
+{
+    std::vector<char> code = readFile(filePath);
+
+    //vector properly aligns data to be accessable by uint32_t so access is optimized
+    return createShader(device, reinterpret_cast<const uint32_t*>(code.data()), code.size(), filePath);
+    //its ok to delete vector code now
+}
+
+VkShaderModule tryCreateShader(const VkDevice& device, const uint32_t* code, size_t codeSize)
+{
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.codeSize = codeSize;
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.pCode = code;
+
+    VkShaderModule shader;
+    if (vkCreateShaderModule(device, &createInfo, nullptr, &shader) != VK_SUCCESS)
+        return VK_NULL_HANDLE;
+    return shader;
+}
+
+VkShaderModule createShader(const VkDevice& device, const uint32_t* code, size_t codeSize, const std::string& name)
+{
+    VkShaderModule shader = tryCreateShader(device, code, codeSize);
+    if (shader == VK_NULL_HANDLE) {
+        std::string error = "Cant create shader: ";
+        error += name;
+        exitWithError(error.c_str());
+    }
+
+    return shader;
+}
+
+VkPipeline createGraphicsPipeline(const VkDevice& device, const VkRenderPass& renderPass, const VkPipelineLayout& pipelineLayout,
+    const VkShaderModule& vertexShader, const VkShaderModule& fragmentShader,
+    const std::vector<VkVertexInputBindingDescription>& vertexBindings, const std::vector<VkVertexInputAttributeDescription>& vertexAttributes)
+{
+    VkPipelineShaderStageCreateInfo shaderStages[2]{};
+
+    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].module = vertexShader;
+    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].pName = "main";
+
+    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].module = fragmentShader;
+    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].pName = "main";
+
+    std::vector<VkDynamicState> dynamicStates = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR
+    };
+
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexBindings.size());
+    vertexInputInfo.pVertexBindingDescriptions = vertexBindings.data();
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexAttributes.size());
+    vertexInputInfo.pVertexAttributeDescriptions = vertexAttributes.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.pViewports = nullptr; //dynamic state, set by the command buffer
+    viewportState.scissorCount = 1;
+    viewportState.pScissors = nullptr;
+    
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+    rasterizer.depthBiasEnable = VK_FALSE;
+    rasterizer.depthBiasConstantFactor = 0.0f; // ignored
+    rasterizer.depthBiasClamp = 0.0f;          // ignored
+    rasterizer.depthBiasSlopeFactor = 0.0f;    // ignored
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisampling.minSampleShading = 1.0f; // Optional
+    multisampling.pSampleMask = nullptr; // Optional
+    multisampling.alphaToCoverageEnable = VK_FALSE; // Optional
+    multisampling.alphaToOneEnable = VK_FALSE; // Optional
+
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_TRUE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;                
+    colorBlending.logicOp = VK_LOGIC_OP_COPY;   // ignored 
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+    //ignored since no blend attacment is using constants
+    colorBlending.blendConstants[0] = 0.0f;   // R
+    colorBlending.blendConstants[1] = 0.0f;   // G
+    colorBlending.blendConstants[2] = 0.0f;   // B
+    colorBlending.blendConstants[3] = 0.0f;   // A
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = nullptr; 
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.subpass = 0;
+
+    VkPipeline graphicsPipeline;
+    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+        return VK_NULL_HANDLE;
+    memoryTelemetry().pipelineCreated();
+
+    return graphicsPipeline;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vulkan/vulkan.h>
+
+#include "queuePool.hpp"
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//initialization steps shared by the application and the benchmarks
+//failures are fatal and go through exitWithError unless noted otherwise
+
+//prints error (and code if nonzero) and exits with code, EXIT_FAILURE when code is 0
+void exitWithError(const char* error, int code = 0);
+
+//headless uses the GLFW null platform (GLFW 3.4+), surfaces then come from VK_EXT_headless_surface
+GLFWwindow* initGLFW(bool headless);
+
+ template<typename T>
+ T loadVkFunc(VkInstance instance, const char* name) {
+     static auto func = reinterpret_cast<T>(vkGetInstanceProcAddr(instance, name));
+
+     if (!func) {
+         std::ostringstream errText;
+         errText << "Failed to load Vulkan function: " << name;
+         exitWithError(errText.str().c_str());
+     }
+     return func;
+ }
+
+ struct SwapChainSupportDetails {
+     VkSurfaceCapabilitiesKHR capabilities;
+     std::vector<VkSurfaceFormatKHR> formats;
+     std::vector<VkPresentModeKHR> presentModes;
+ };
+
+ struct SwapChainProfile
+ {
+     VkSurfaceTransformFlagBitsKHR surfaceTransform;
+     int imgCount;
+     VkExtent2D extent;
+     VkSurfaceFormatKHR format;
+     VkPresentModeKHR presentMode;
+     VkImageUsageFlags supportedUsage;
+ };
+
+ struct QueueFamily {
+     int graphics = -1;
+     int compute = -1;
+     int transfer = -1;
+     int presentation = -1;
+ };
+
+SwapChainSupportDetails querySwapChainSupport(const VkPhysicalDevice& device, const VkSurfaceKHR& surface);
+SwapChainProfile getSwapChainProfile(const VkPhysicalDevice& device, const VkSurfaceKHR& surface, int windowWidth, int windowHeight);
+SwapChainProfile getSwapChainProfile(const VkPhysicalDevice& device, const VkSurfaceKHR& surface, GLFWwindow* window);
+//devices that have timeline semaphores, VK_KHR_swapchain and graphics and present queues for surface
+std::vector<VkPhysicalDevice> suitablePhysicalDevices(VkInstance instance, const VkSurfaceKHR& surface, const std::vector<VkPhysicalDevice>& dissalowedDevices = {});
+//ranks the suitable devices by memory and type, CPU implementations (lavapipe, SwiftShader) only when no GPU is suitable
+//returns VK_NULL_HANDLE if no device can present to surface; see pickPhysicalDeviceByBenchmark for measured ranking
+VkPhysicalDevice pickPhysicalDevice(VkInstance& instance, const VkSurfaceKHR& surface, std::vector<VkPhysicalDevice> dissalowedDevices = {});
+QueueFamily getQueueFamily(const VkPhysicalDevice& device, const VkSurfaceKHR& surface);
+
+//validation enables VK_LAYER_KHRONOS_validation and the debug messenger
+VkInstance createInstance(bool validation);
+//queues requested per role, one priority (0..1) per queue
+//roles on the same family get separate queues while the family has enough, the rest is shared through QueuePool
+struct QueueConfig
+{
+    std::vector<float> graphics{ 1.0f };
+    std::vector<float> compute{ 0.5f };
+    std::vector<float> transfer{ 0.5f };
+};
+//queues to create for every distinct family in queueFamily, clamped to the family's queueCount
+QueuePlan planQueues(const VkPhysicalDevice& device, const QueueFamily& queueFamily, const QueueConfig& config = {});
+//creates the queues of plan, VK_KHR_swapchain and timeline semaphores enabled
+VkDevice createLogicalDevice(const VkPhysicalDevice& device, const QueuePlan& plan);
+//oldSwapchain is retired by the new one when recreating after a resize, the caller still destroys it
+VkSwapchainKHR createSwapchain(const VkDevice& device, const VkSurfaceKHR& surface, const SwapChainProfile& profile, const QueueFamily& queueFamily,
+    VkImageUsageFlags usage, VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE);
+std::vector<VkImageView> createSwapchainImageViews(const VkDevice& device, const std::vector<VkImage>& images, VkFormat format);
+std::vector<VkFramebuffer> createFramebuffers(const VkDevice& device, const VkRenderPass& renderPass, const std::vector<VkImageView>& views, VkExtent2D extent);
+//single color attachment cleared on load and left in finalLayout, the swapchain's VK_IMAGE_LAYOUT_PRESENT_SRC_KHR by default
+//preserveContents expects the image in finalLayout so pixels outside the render area are kept
+VkRenderPass createRenderPass(const VkDevice& device, VkFormat format, bool preserveContents = false,
+    VkImageLayout finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+std::vector<char> readFile(const std::string& filename);
+VkShaderModule createShader(const VkDevice& device, const std::string& filePath);
+VkShaderModule createShader(const VkDevice& device, const uint32_t* code, size_t codeSize, const std::string& name);
+//returns VK_NULL_HANDLE on failure so it can also be used by the shader hot reload worker
+//without vertex bindings the vertex shader generates its vertices from gl_VertexIndex
+VkPipeline createGraphicsPipeline(const VkDevice& device, const VkRenderPass& renderPass, const VkPipelineLayout& pipelineLayout,
+    const VkShaderModule& vertexShader, const VkShaderModule& fragmentShader,
+    const std::vector<VkVertexInputBindingDescription>& vertexBindings = {},
+    const std::vector<VkVertexInputAttributeDescription>& vertexAttributes = {});
+
+//set 0 is frameDataLayout (FrameAllocator), plus the DrawPushConstants range
+VkPipelineLayout createPipelineLayout(const VkDevice& device, const VkDescriptorSetLayout& frameDataLayout);
+
+//the same without exiting, VK_NULL_HANDLE on failure; for code that must survive a device that cant run it (device scoring)
+VkDevice tryCreateLogicalDevice(const VkPhysicalDevice& device, const QueuePlan& plan);
+VkFramebuffer tryCreateFramebuffer(const VkDevice& device, const VkRenderPass& renderPass, VkImageView view, VkExtent2D extent);
+VkRenderPass tryCreateRenderPass(const VkDevice& device, VkFormat format, bool preserveContents = false,
+    VkImageLayout finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+VkPipelineLayout tryCreatePipelineLayout(const VkDevice& device, const VkDescriptorSetLayout& frameDataLayout);
+VkShaderModule tryCreateShader(const VkDevice& device, const uint32_t* code, size_t codeSize);
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "memoryTelemetry.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+//helpers shared by the subsystems living outside main.cpp
+
+//returns UINT32_MAX if no memory type has all required properties
+uint32_t findMemoryType(const VkPhysicalDevice& device, uint32_t typeBits, VkMemoryPropertyFlags properties);
+
+//creates a buffer with its own memory allocation, returns false (and leaves both handles null) on failure
+//the memory is tracked by memoryTelemetry() under category, free it with memoryTelemetry().free()
+bool createBuffer(const VkPhysicalDevice& physicalDevice, const VkDevice& device, VkDeviceSize size, VkBufferUsageFlags usage,
+    VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& memory, MemoryCategory category = MemoryCategory::Buffer);
@@ -0,0 +1,62 @@
+#include "meshPacker.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+//packs a Wavefront OBJ into the mapped mesh format: triangles reordered for the post transform cache, vertices in first use
+//order and quantized to 16 bytes (positions snorm16, octahedral normals, unorm16 uvs)
+//usage: MetalOverVulkanMeshPacker input.obj output.mesh [--no-optimize]
+
+int main(int argc, char** argv)
+{
+    std::string input;
+    std::string output;
+    bool optimize = true;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--no-optimize") == 0)
+            optimize = false;
+        else if (input.empty())
+            input = argv[i];
+        else if (output.empty())
+            output = argv[i];
+        else
+            std::cerr << "Unknown argument \"" << argv[i] << "\" ignored\n";
+    }
+    if (input.empty() || output.empty())
+    {
+        std::cerr << "usage: MetalOverVulkanMeshPacker input.obj output.mesh [--no-optimize]\n";
+        return 2;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    MeshData mesh;
+    if (!loadObj(input, mesh))
+        return 1;
+    const uint32_t triangles = static_cast<uint32_t>(mesh.indices.size() / 3);
+    const double sourceAcmr = averageCacheMissRatio(mesh.indices, static_cast<uint32_t>(mesh.vertices.size()));
+    if (optimize)
+    {
+        optimizeVertexCache(mesh.indices, static_cast<uint32_t>(mesh.vertices.size()));
+        optimizeVertexFetch(mesh);
+    }
+    const double packedAcmr = averageCacheMissRatio(mesh.indices, static_cast<uint32_t>(mesh.vertices.size()));
+
+    const PackedMesh packed = packMesh(mesh);
+    if (!writePackedMesh(output, packed))
+        return 1;
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    double positionError, normalError;
+    quantizationError(mesh, packed, positionError, normalError);
+    const uint64_t floatBytes = uint64_t(mesh.vertices.size()) * sizeof(FloatVertex) + mesh.indices.size() * sizeof(uint32_t);
+    const uint64_t packedBytes = packed.header.indexOffset + uint64_t(packed.header.indexCount) * packed.header.indexSize;
+    std::cout << input << " -> " << output << " in " << ms << " ms\n"
+        << "  " << mesh.vertices.size() << " vertices, " << triangles << " triangles, " << packed.header.indexSize * 8 << " bit indices\n"
+        << "  ACMR (16 entry FIFO) " << sourceAcmr << " -> " << packedAcmr << "\n"
+        << "  " << floatBytes << " bytes as float32, " << packedBytes << " bytes packed\n"
+        << "  max position error " << positionError << " of the radius, max normal error " << normalError << " degrees\n";
+    return 0;
+}
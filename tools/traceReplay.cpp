@@ -0,0 +1,497 @@
+#include "vulkanSetup.hpp"
+#include "commandTrace.hpp"
+#include "deviceHandle.hpp"
+#include "frameAllocator.hpp"
+#include "memoryHeap.hpp"
+#include "meshLoader.hpp"
+#include "queueTimeline.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//re-executes a command trace written by MetalOverVulkan --trace: rebuilds its pipelines and buffers on the picked device,
+//renders every frame runs times into an offscreen target of the captured size and format and prints the timings as JSON
+//frames are submitted one at a time and waited for, so every sample sees an idle GPU and the same inputs
+//usage: MetalOverVulkanTraceReplay trace.bin [--runs N] [--windowed] [--out file.json]
+//runs headless by default (GLFW null platform) so traces replay on lavapipe without a display
+
+using Clock = std::chrono::steady_clock;
+
+struct Samples
+{
+    std::vector<double> values;
+
+    double median() const
+    {
+        std::vector<double> sorted = values;
+        std::sort(sorted.begin(), sorted.end());
+        return sorted.empty() ? 0.0 : sorted[sorted.size() / 2];
+    }
+    double min() const { return values.empty() ? 0.0 : *std::min_element(values.begin(), values.end()); }
+    double max() const { return values.empty() ? 0.0 : *std::max_element(values.begin(), values.end()); }
+};
+
+struct ReplayFrame
+{
+    size_t firstRecord = 0; //after BeginFrame
+    size_t endRecord = 0;   //the EndFrame record
+    uint32_t draws = 0;
+    uint32_t skippedDraws = 0; //pipeline or buffers missing from the trace
+    Samples recordUs;
+    Samples gpuUs;
+};
+
+//resources the trace defines, by trace id
+struct ReplayResources
+{
+    std::map<uint32_t, VkPipeline> pipelines;
+    std::map<uint32_t, Mesh> buffers; //any traced buffer, uploaded through the mesh path as one vertex/index buffer
+};
+
+static std::string jsonString(const char* text)
+{
+    std::string out = "\"";
+    for (const char* c = text; *c; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+            out += '\\';
+        out += *c;
+    }
+    return out + "\"";
+}
+
+//records the commands of one frame, frameData must have room for its uniform data
+static void recordFrame(VkCommandBuffer cmd, const CommandTraceReader& trace, ReplayFrame& frame, const ReplayResources& resources,
+    VkRenderPass renderPass, VkFramebuffer framebuffer, VkExtent2D extent, VkPipelineLayout layout, FrameAllocator& frameData)
+{
+    const std::vector<CommandTraceReader::Record>& records = trace.records();
+    bool pipelineKnown = false;
+    bool vertexKnown = true;
+    bool indexKnown = true;
+    frame.draws = 0;
+    frame.skippedDraws = 0;
+    for (size_t i = frame.firstRecord; i < frame.endRecord; ++i)
+    {
+        const CommandTraceReader::Record& record = records[i];
+        bool valid = true;
+        switch (record.op)
+        {
+        case TraceOp::BeginRenderPass:
+        {
+            TraceBeginRenderPass pass;
+            valid = record.read(pass);
+            //the target has the captured size, a trace of a resized window may have areas beyond it
+            pass.renderArea.extent.width = std::min(pass.renderArea.extent.width, extent.width - std::min<uint32_t>(pass.renderArea.offset.x, extent.width));
+            pass.renderArea.extent.height = std::min(pass.renderArea.extent.height, extent.height - std::min<uint32_t>(pass.renderArea.offset.y, extent.height));
+            VkRenderPassBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            beginInfo.renderPass = renderPass;
+            beginInfo.framebuffer = framebuffer;
+            beginInfo.renderArea = pass.renderArea;
+            beginInfo.clearValueCount = 1;
+            beginInfo.pClearValues = &pass.clearColor;
+            if (valid)
+                vkCmdBeginRenderPass(cmd, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+            break;
+        }
+        case TraceOp::EndRenderPass:
+            vkCmdEndRenderPass(cmd);
+            break;
+        case TraceOp::BindPipeline:
+        {
+            uint32_t id;
+            valid = record.read(id);
+            auto found = resources.pipelines.find(id);
+            pipelineKnown = valid && found != resources.pipelines.end();
+            if (pipelineKnown)
+                vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, found->second);
+            break;
+        }
+        case TraceOp::SetViewport:
+        {
+            VkViewport viewport;
+            valid = record.read(viewport);
+            if (valid)
+                vkCmdSetViewport(cmd, 0, 1, &viewport);
+            break;
+        }
+        case TraceOp::SetScissor:
+        {
+            VkRect2D scissor;
+            valid = record.read(scissor);
+            if (valid)
+                vkCmdSetScissor(cmd, 0, 1, &scissor);
+            break;
+        }
+        case TraceOp::BindFrameData:
+        {
+            uint32_t setIndex, bindingCount;
+            const uint8_t* bytes[2];
+            uint32_t sizes[2];
+            valid = CommandTraceReader::readFrameData(record, setIndex, bindingCount, bytes, sizes);
+            uint32_t offsets[2]{};
+            for (uint32_t binding = 0; valid && binding < bindingCount; ++binding)
+            {
+                const FrameAllocator::Allocation allocation = frameData.allocate(std::max(sizes[binding], 1u));
+                if (allocation.data == nullptr)
+                    exitWithError("frame allocator out of space, the trace binds more uniform data per frame than it holds");
+                std::memcpy(allocation.data, bytes[binding], sizes[binding]);
+                offsets[binding] = allocation.offset;
+            }
+            const VkDescriptorSet set = frameData.descriptorSet();
+            if (valid)
+                vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, setIndex, 1, &set, bindingCount, offsets);
+            break;
+        }
+        case TraceOp::BindVertexBuffer:
+        case TraceOp::BindIndexBuffer:
+        {
+            TraceBindBuffer bind;
+            valid = record.read(bind);
+            auto found = resources.buffers.find(bind.buffer);
+            const bool known = valid && found != resources.buffers.end();
+            if (record.op == TraceOp::BindVertexBuffer)
+            {
+                vertexKnown = known;
+                const VkDeviceSize offset = bind.offset;
+                if (known)
+                    vkCmdBindVertexBuffers(cmd, bind.slot, 1, &found->second.buffer, &offset);
+            }
+            else
+            {
+                indexKnown = known;
+                if (known)
+                    vkCmdBindIndexBuffer(cmd, found->second.buffer, bind.offset, static_cast<VkIndexType>(bind.slot));
+            }
+            break;
+        }
+        case TraceOp::PushConstants:
+        {
+            VkShaderStageFlags stages;
+            const uint8_t* bytes;
+            uint32_t size;
+            valid = CommandTraceReader::readPushConstants(record, stages, bytes, size);
+            if (valid)
+                vkCmdPushConstants(cmd, layout, stages, 0, size, bytes);
+            break;
+        }
+        case TraceOp::Draw:
+        {
+            TraceDraw draw;
+            valid = record.read(draw);
+            if (valid && pipelineKnown && vertexKnown)
+            {
+                vkCmdDraw(cmd, draw.vertexCount, draw.instanceCount, draw.firstVertex, draw.firstInstance);
+                ++frame.draws;
+            }
+            else
+                ++frame.skippedDraws;
+            break;
+        }
+        case TraceOp::DrawIndexed:
+        {
+            TraceDrawIndexed draw;
+            valid = record.read(draw);
+            if (valid && pipelineKnown && vertexKnown && indexKnown)
+            {
+                vkCmdDrawIndexed(cmd, draw.indexCount, draw.instanceCount, 0, draw.baseVertex, 0);
+                ++frame.draws;
+            }
+            else
+                ++frame.skippedDraws;
+            break;
+        }
+        default: //definitions were created up front
+            break;
+        }
+        if (!valid)
+            exitWithError("malformed record in the trace");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string tracePath;
+    uint32_t runs = 20;
+    bool headless = true;
+    std::string outPath;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--runs" && i + 1 < argc)
+            runs = std::max(1u, (uint32_t)std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--windowed")
+            headless = false;
+        else if (arg == "--out" && i + 1 < argc)
+            outPath = argv[++i];
+        else if (tracePath.empty())
+            tracePath = arg;
+        else
+            std::cerr << "Unknown argument \"" << arg << "\" ignored\n";
+    }
+    if (tracePath.empty())
+    {
+        std::cerr << "usage: MetalOverVulkanTraceReplay trace.bin [--runs N] [--windowed] [--out file.json]\n";
+        return 2;
+    }
+
+    CommandTraceReader trace;
+    if (!trace.load(tracePath))
+        return 1;
+    const TraceFileHeader& header = trace.header();
+    const VkFormat format = static_cast<VkFormat>(header.colorFormat);
+    const VkExtent2D extent{ header.width, header.height };
+
+    std::vector<ReplayFrame> frames;
+    const std::vector<CommandTraceReader::Record>& records = trace.records();
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        if (records[i].op == TraceOp::BeginFrame)
+        {
+            ReplayFrame frame;
+            frame.firstRecord = i + 1;
+            frame.endRecord = records.size(); //until an EndFrame is found
+            frames.push_back(frame);
+        }
+        else if (records[i].op == TraceOp::EndFrame && !frames.empty())
+            frames.back().endRecord = i;
+    }
+    if (frames.empty())
+        exitWithError("the trace has no frames");
+
+    //same device selection as the application, the surface only takes part in picking the device
+    GLFWwindow* window = initGLFW(headless);
+    if (window == nullptr)
+        exitWithError("glfw cant initialize");
+    VkInstance instance = createInstance(false);
+    VkSurfaceKHR surface;
+    if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS)
+        exitWithError("Error in creating surface");
+    VkPhysicalDevice physicalDevice = pickPhysicalDevice(instance, surface);
+    if (physicalDevice == VK_NULL_HANDLE)
+        exitWithError("No suitable GPU device found");
+    const QueueFamily queueFamily = getQueueFamily(physicalDevice, surface);
+    if (queueFamily.graphics < 0)
+        exitWithError("no graphics queue family");
+
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+    if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT))
+        exitWithError("the traced color format cant be rendered to on this device");
+
+    const QueuePlan queuePlan = planQueues(physicalDevice, queueFamily);
+    VkDevice device = createLogicalDevice(physicalDevice, queuePlan);
+    memoryTelemetry().init(physicalDevice);
+    QueuePool queuePool(device, queuePlan);
+    QueuePool::Queue* queue = queuePool.acquire(queueFamily.graphics);
+    QueueTimeline timeline(device, *queue);
+    if (!timeline.valid())
+        exitWithError("cant create timeline semaphore");
+
+    //one region is enough, every frame is waited for before the next one is recorded
+    FrameAllocator frameData(physicalDevice, device, 1, 4 * 1024 * 1024);
+    if (!frameData.valid())
+        exitWithError("cant create frame allocator");
+    VkPipelineLayout pipelineLayout = createPipelineLayout(device, frameData.setLayout());
+    VkRenderPass renderPass = createRenderPass(device, format, false, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+
+    TransientImages target(physicalDevice, device);
+    TransientImages::Desc targetDesc;
+    targetDesc.info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    targetDesc.info.imageType = VK_IMAGE_TYPE_2D;
+    targetDesc.info.format = format;
+    targetDesc.info.extent = { extent.width, extent.height, 1 };
+    targetDesc.info.mipLevels = 1;
+    targetDesc.info.arrayLayers = 1;
+    targetDesc.info.samples = VK_SAMPLE_COUNT_1_BIT;
+    targetDesc.info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    targetDesc.info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    targetDesc.info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    const uint32_t targetId = target.add(targetDesc);
+    if (!target.build())
+        exitWithError("cant create the replay target");
+    VkImageView targetView;
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = target.image(targetId);
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    if (vkCreateImageView(device, &viewInfo, nullptr, &targetView) != VK_SUCCESS)
+        exitWithError("cant create the replay target view");
+    VkFramebuffer framebuffer = createFramebuffers(device, renderPass, { targetView }, extent)[0];
+
+    //definitions first, so no pipeline or upload lands in a timed frame
+    ReplayResources resources;
+    const auto buildStart = Clock::now();
+    for (const CommandTraceReader::Record& record : records)
+    {
+        if (record.op == TraceOp::DefinePipeline)
+        {
+            uint32_t id;
+            TracePipelineDesc desc;
+            if (!CommandTraceReader::readPipeline(record, id, desc))
+                exitWithError("malformed pipeline in the trace");
+            VkShaderModule vertex = createShader(device, desc.vertexSpirv.data(), desc.vertexSpirv.size() * sizeof(uint32_t), "traced vertex shader");
+            VkShaderModule fragment = createShader(device, desc.fragmentSpirv.data(), desc.fragmentSpirv.size() * sizeof(uint32_t), "traced fragment shader");
+            const VkPipeline pipeline = createGraphicsPipeline(device, renderPass, pipelineLayout, vertex, fragment, desc.bindings, desc.attributes);
+            vkDestroyShaderModule(device, vertex, nullptr);
+            vkDestroyShaderModule(device, fragment, nullptr);
+            if (pipeline == VK_NULL_HANDLE)
+                exitWithError("cant create a traced pipeline");
+            resources.pipelines[id] = pipeline;
+        }
+        else if (record.op == TraceOp::DefineBuffer)
+        {
+            uint32_t id;
+            const uint8_t* contents;
+            uint64_t size;
+            if (!CommandTraceReader::readBuffer(record, id, contents, size) || size == 0)
+                exitWithError("malformed buffer in the trace");
+            Mesh buffer;
+            if (!uploadMesh(physicalDevice, device, timeline, contents, size, contents + size, 0, buffer))
+                exitWithError("cant upload a traced buffer");
+            resources.buffers[id] = buffer;
+        }
+    }
+    const double buildMs = std::chrono::duration<double, std::milli>(Clock::now() - buildStart).count();
+
+    //two timestamps per frame around everything recorded, skipped on queues without timestamp support
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+    const uint32_t timestampBits = families[queueFamily.graphics].timestampValidBits;
+    const uint64_t timestampMask = timestampBits >= 64 ? ~0ull : (1ull << timestampBits) - 1;
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    if (timestampBits > 0)
+    {
+        VkQueryPoolCreateInfo queryInfo{};
+        queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryInfo.queryCount = 2;
+        if (vkCreateQueryPool(device, &queryInfo, nullptr, &queryPool) != VK_SUCCESS)
+            queryPool = VK_NULL_HANDLE;
+    }
+    if (queryPool == VK_NULL_HANDLE)
+        std::cerr << "no timestamps on queue family " << queueFamily.graphics << ", only CPU timings are reported\n";
+
+    VkCommandPool commandPool;
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = timeline.family();
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+        exitWithError("cant create command pool");
+    VkCommandBuffer cmd;
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    if (vkAllocateCommandBuffers(device, &allocInfo, &cmd) != VK_SUCCESS)
+        exitWithError("cant allocate command buffer");
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    //the first run also pays for first pipeline uses, it is not sampled
+    for (uint32_t run = 0; run <= runs; ++run)
+    {
+        for (ReplayFrame& frame : frames)
+        {
+            frameData.beginFrame(0);
+            const auto start = Clock::now();
+            vkResetCommandBuffer(cmd, 0);
+            vkBeginCommandBuffer(cmd, &beginInfo);
+            if (queryPool != VK_NULL_HANDLE)
+            {
+                vkCmdResetQueryPool(cmd, queryPool, 0, 2);
+                vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+            }
+            recordFrame(cmd, trace, frame, resources, renderPass, framebuffer, extent, pipelineLayout, frameData);
+            if (queryPool != VK_NULL_HANDLE)
+                vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1);
+            if (vkEndCommandBuffer(cmd) != VK_SUCCESS)
+                exitWithError("failed to record a replayed frame");
+            const double recordUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+            const uint64_t value = timeline.submit(&cmd, 1);
+            if (value == 0 || !timeline.wait(value))
+                exitWithError("device lost while replaying");
+            if (run == 0)
+                continue;
+            frame.recordUs.values.push_back(recordUs);
+            uint64_t timestamps[2];
+            if (queryPool != VK_NULL_HANDLE &&
+                vkGetQueryPoolResults(device, queryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+                    VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) == VK_SUCCESS)
+                frame.gpuUs.values.push_back(double((timestamps[1] - timestamps[0]) & timestampMask) * properties.limits.timestampPeriod / 1000.0);
+        }
+    }
+
+    std::ostringstream json;
+    json << "{\n";
+    json << "  \"device\": " << jsonString(properties.deviceName) << ",\n";
+    json << "  \"driver_version\": " << properties.driverVersion << ",\n";
+    json << "  \"trace\": " << jsonString(tracePath.c_str()) << ",\n";
+    json << "  \"extent\": [" << extent.width << ", " << extent.height << "],\n";
+    json << "  \"runs\": " << runs << ",\n";
+    json << "  \"build_ms\": " << buildMs << ",\n";
+    json << "  \"frames\": [\n";
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        const ReplayFrame& frame = frames[i];
+        json << "    { \"frame\": " << i << ", \"commands\": " << frame.endRecord - frame.firstRecord << ", \"draws\": " << frame.draws
+            << ", \"skipped_draws\": " << frame.skippedDraws
+            << ", \"cpu_record_us\": { \"median\": " << frame.recordUs.median() << ", \"min\": " << frame.recordUs.min() << ", \"max\": " << frame.recordUs.max() << " }";
+        if (!frame.gpuUs.values.empty())
+            json << ", \"gpu_us\": { \"median\": " << frame.gpuUs.median() << ", \"min\": " << frame.gpuUs.min() << ", \"max\": " << frame.gpuUs.max() << " }";
+        json << " }" << (i + 1 < frames.size() ? ",\n" : "\n");
+        std::cerr << "frame " << i << ": " << frame.draws << " draws, record " << frame.recordUs.median() << " us, GPU "
+            << (frame.gpuUs.values.empty() ? std::string("n/a") : std::to_string(frame.gpuUs.median()) + " us") << " (median of " << runs << ")\n";
+    }
+    json << "  ]\n}\n";
+
+    vkDeviceWaitIdle(device);
+    vkDestroyCommandPool(device, commandPool, nullptr);
+    if (queryPool != VK_NULL_HANDLE)
+        vkDestroyQueryPool(device, queryPool, nullptr);
+    for (auto& [id, buffer] : resources.buffers)
+        destroyMesh(device, buffer);
+    for (auto& [id, pipeline] : resources.pipelines)
+        destroyPipeline(device, pipeline, nullptr);
+    vkDestroyFramebuffer(device, framebuffer, nullptr);
+    vkDestroyImageView(device, targetView, nullptr);
+    target.destroy();
+    vkDestroyRenderPass(device, renderPass, nullptr);
+    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+    frameData.destroy();
+    timeline.destroy();
+    vkDestroyDevice(device, nullptr);
+    vkDestroySurfaceKHR(instance, surface, nullptr);
+    vkDestroyInstance(instance, nullptr);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+
+    if (outPath.empty())
+        std::cout << json.str();
+    else
+    {
+        std::ofstream file(outPath);
+        file << json.str();
+        if (!file)
+            exitWithError("cant write replay output");
+    }
+    return 0;
+}